@@ -0,0 +1,299 @@
+// Copyright (c) Fabrice Robinet
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "GLTF.h"
+#include "GLTF-OpenCOLLADA.h"
+#include "GLTFConverterContext.h"
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#endif
+
+#include "COLLADA2GLTFWriter.h"
+#include "BatchConverter.h"
+
+using namespace std;
+
+namespace GLTF
+{
+    //wall clock time in seconds
+    static double __WallClockTime()
+    {
+#ifdef WIN32
+        LARGE_INTEGER frequency, counter;
+        QueryPerformanceFrequency(&frequency);
+        QueryPerformanceCounter(&counter);
+        return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+        struct timeval tv;
+        gettimeofday(&tv, 0);
+        return (double)tv.tv_sec + ((double)tv.tv_usec * 1e-6);
+#endif
+    }
+    
+    static bool __HasDAEExtension(const std::string& path)
+    {
+        if (path.size() < 4)
+            return false;
+        std::string extension = path.substr(path.size() - 4);
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+        return extension == ".dae";
+    }
+    
+    static bool __IsDirectory(const std::string& path)
+    {
+#ifdef WIN32
+        DWORD attributes = GetFileAttributesA(path.c_str());
+        return (attributes != INVALID_FILE_ATTRIBUTES) && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+#else
+        struct stat status;
+        return (stat(path.c_str(), &status) == 0) && S_ISDIR(status.st_mode);
+#endif
+    }
+    
+    static bool __IsAbsolutePath(const std::string& path)
+    {
+#ifdef WIN32
+        return (path.size() > 1) && ((path[1] == ':') || (path[0] == '\\') || (path[0] == '/'));
+#else
+        return (path.size() > 0) && (path[0] == '/');
+#endif
+    }
+    
+    std::string replacePathExtensionWithJSON(const std::string& inputFile)
+    {
+        COLLADABU::URI inputFileURI(inputFile.c_str());
+        
+        std::string pathDir = inputFileURI.getPathDir();
+        std::string fileBase = inputFileURI.getPathFileBase();
+        
+        return pathDir + fileBase + ".json";
+    }
+    
+    bool convertCOLLADAFile(const GLTFConverterContext &converterContext)
+    {
+        FILE* fd = fopen(converterContext.outputFilePath.c_str(), "w");
+        if (!fd) {
+            printf("WARNING: cannot open %s for writing\n", converterContext.outputFilePath.c_str());
+            return false;
+        }
+        
+        rapidjson::FileStream s(fd);
+        rapidjson::PrettyWriter <rapidjson::FileStream> jsonWriter(s);
+        COLLADA2GLTFWriter* writer = new COLLADA2GLTFWriter(converterContext, &jsonWriter);
+        bool succeeded = writer->write();
+        fclose(fd);
+        delete writer;
+        
+        return succeeded;
+    }
+    
+    //--------------------------------------------------------------------
+    FileConversionJob::FileConversionJob(const GLTFConverterContext &converterContext) :
+    _converterContext(converterContext),
+    _succeeded(false),
+    _duration(0)
+    {
+    }
+    
+    FileConversionJob::~FileConversionJob()
+    {
+    }
+    
+    void FileConversionJob::run()
+    {
+        double start = __WallClockTime();
+        this->_succeeded = convertCOLLADAFile(this->_converterContext);
+        this->_duration = __WallClockTime() - start;
+        
+        printf("[batch] %s %.3fs %s\n", this->_succeeded ? "OK" : "FAILED", this->_duration, this->_converterContext.inputFilePath.c_str());
+    }
+    
+    //--------------------------------------------------------------------
+    BatchConverter::BatchConverter(const GLTFConverterContext &converterContext) :
+    _converterContext(converterContext)
+    {
+    }
+    
+    BatchConverter::~BatchConverter()
+    {
+    }
+    
+    bool BatchConverter::addInput(const std::string& path)
+    {
+        if (__IsDirectory(path))
+            return this->_addDirectory(path);
+        if (__HasDAEExtension(path)) {
+            this->_addFile(path);
+            return true;
+        }
+        return this->_addManifest(path);
+    }
+    
+    void BatchConverter::_addFile(const std::string& filePath)
+    {
+        //the same file may be reached from several inputs, converting it twice would have two jobs writing the same output
+        if (this->_uniqueInputFilePaths.insert(filePath).second)
+            this->_inputFilePaths.push_back(filePath);
+    }
+    
+    bool BatchConverter::_addDirectory(const std::string& directoryPath)
+    {
+        std::vector <std::string> filePaths;
+        std::vector <std::string> directoryPaths;
+        std::string separator = (directoryPath.size() > 0) && (directoryPath[directoryPath.size() - 1] == '/') ? "" : "/";
+        
+#ifdef WIN32
+        WIN32_FIND_DATAA findData;
+        HANDLE findHandle = FindFirstFileA((directoryPath + separator + "*").c_str(), &findData);
+        if (findHandle == INVALID_HANDLE_VALUE) {
+            printf("WARNING: cannot read directory %s\n", directoryPath.c_str());
+            return false;
+        }
+        do {
+            std::string name = findData.cFileName;
+#else
+        DIR* directory = opendir(directoryPath.c_str());
+        if (!directory) {
+            printf("WARNING: cannot read directory %s\n", directoryPath.c_str());
+            return false;
+        }
+        while (struct dirent* entry = readdir(directory)) {
+            std::string name = entry->d_name;
+#endif
+            if ((name == ".") || (name == ".."))
+                continue;
+            std::string path = directoryPath + separator + name;
+            if (__IsDirectory(path)) {
+                directoryPaths.push_back(path);
+            } else if (__HasDAEExtension(name)) {
+                filePaths.push_back(path);
+            }
+#ifdef WIN32
+        } while (FindNextFileA(findHandle, &findData));
+        FindClose(findHandle);
+#else
+        }
+        closedir(directory);
+#endif
+        
+        //directory listings are not ordered, sort them so that files are always converted in the same order
+        std::sort(filePaths.begin(), filePaths.end());
+        std::sort(directoryPaths.begin(), directoryPaths.end());
+        
+        for (size_t i = 0 ; i < filePaths.size() ; i++) {
+            this->_addFile(filePaths[i]);
+        }
+        for (size_t i = 0 ; i < directoryPaths.size() ; i++) {
+            this->_addDirectory(directoryPaths[i]);
+        }
+        
+        return true;
+    }
+    
+    bool BatchConverter::_addManifest(const std::string& manifestPath)
+    {
+        std::ifstream manifest(manifestPath.c_str());
+        if (!manifest.is_open()) {
+            printf("WARNING: cannot read input %s\n", manifestPath.c_str());
+            return false;
+        }
+        
+        size_t separatorIndex = manifestPath.find_last_of("/\\");
+        std::string manifestDirectory = (separatorIndex != string::npos) ? manifestPath.substr(0, separatorIndex + 1) : "";
+        
+        bool succeeded = true;
+        std::string line;
+        while (std::getline(manifest, line)) {
+            size_t first = line.find_first_not_of(" \t\r");
+            if ((first == string::npos) || (line[first] == '#'))
+                continue;
+            size_t last = line.find_last_not_of(" \t\r");
+            std::string path = line.substr(first, last - first + 1);
+            if (!__IsAbsolutePath(path))
+                path = manifestDirectory + path;
+            
+            //manifests are not nested, an entry is either a file or a directory
+            if (__IsDirectory(path)) {
+                succeeded &= this->_addDirectory(path);
+            } else {
+                this->_addFile(path);
+            }
+        }
+        
+        return succeeded;
+    }
+    
+    size_t BatchConverter::getFilesCount()
+    {
+        return this->_inputFilePaths.size();
+    }
+    
+    size_t BatchConverter::run(size_t threadsCount)
+    {
+        size_t filesCount = this->_inputFilePaths.size();
+        if (filesCount == 0)
+            return 0;
+        
+        double start = __WallClockTime();
+        
+        //files are the unit of parallelism, the geometry pool of each conversion only gets the threads left over
+        GLTFConverterContext fileConverterContext = this->_converterContext;
+        fileConverterContext.threadsCount = (filesCount < threadsCount) ? (unsigned int)(threadsCount / filesCount) : 0;
+        
+        std::vector <shared_ptr <FileConversionJob> > jobs;
+        for (size_t i = 0 ; i < filesCount ; i++) {
+            fileConverterContext.inputFilePath = this->_inputFilePaths[i];
+            //computed here rather than by the jobs, this way OpenCOLLADA initializes its URI support on this thread first
+            fileConverterContext.outputFilePath = replacePathExtensionWithJSON(this->_inputFilePaths[i]);
+            jobs.push_back(shared_ptr <FileConversionJob> (new FileConversionJob(fileConverterContext)));
+        }
+        
+        //documents are still parsed one at a time, see __LoadDocument in COLLADA2GLTFWriter.cpp
+        JobScheduler scheduler(std::min(threadsCount, filesCount));
+        for (size_t i = 0 ; i < filesCount ; i++) {
+            scheduler.schedule(jobs[i].get());
+        }
+        scheduler.waitForAllJobs();
+        
+        size_t failedFilesCount = 0;
+        for (size_t i = 0 ; i < filesCount ; i++) {
+            if (!jobs[i]->succeeded()) {
+                printf("[batch] failed: %s\n", jobs[i]->getInputFilePath().c_str());
+                failedFilesCount++;
+            }
+        }
+        
+        printf("[batch] converted %d files out of %d in %.3fs, %d failed\n",
+               (int)(filesCount - failedFilesCount),
+               (int)filesCount,
+               __WallClockTime() - start,
+               (int)failedFilesCount);
+        
+        return failedFilesCount;
+    }
+}
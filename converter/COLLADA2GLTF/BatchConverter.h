@@ -0,0 +1,86 @@
+// Copyright (c) Fabrice Robinet
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __BATCH_CONVERTER_H__
+#define __BATCH_CONVERTER_H__
+
+namespace GLTF
+{
+    //same path as inputFile, with the extension replaced by .json
+    std::string replacePathExtensionWithJSON(const std::string& inputFile);
+    
+    //converts converterContext.inputFilePath into converterContext.outputFilePath, returns false if the conversion failed
+    bool convertCOLLADAFile(const GLTFConverterContext &converterContext);
+    
+    class FileConversionJob : public Job
+    {
+    public:
+        FileConversionJob(const GLTFConverterContext &converterContext);
+        virtual ~FileConversionJob();
+        
+        virtual void run();
+        
+        const std::string& getInputFilePath() { return this->_converterContext.inputFilePath; }
+        bool succeeded() { return this->_succeeded; }
+        double getDuration() { return this->_duration; }
+        
+    private:
+        GLTFConverterContext _converterContext;
+        bool _succeeded;
+        double _duration;
+    };
+    
+    /*
+        Converts many files within a single process, on a bounded pool of threads.
+        Each file is converted by a single thread, with the same options, next to its input like in single file mode.
+     */
+    class BatchConverter
+    {
+    public:
+        BatchConverter(const GLTFConverterContext &converterContext);
+        virtual ~BatchConverter();
+        
+        /*
+            An input can be a .dae file, a directory that is searched recursively for .dae files,
+            or a manifest listing one input per line (blank lines and lines starting with # are ignored, relative paths are relative to the manifest).
+         */
+        bool addInput(const std::string& path);
+        
+        size_t getFilesCount();
+        
+        //prints the status and timing of each file as it completes, then a summary. Returns the count of files that failed.
+        size_t run(size_t threadsCount);
+        
+    private:
+        void _addFile(const std::string& filePath);
+        bool _addDirectory(const std::string& directoryPath);
+        bool _addManifest(const std::string& manifestPath);
+        
+    private:
+        GLTFConverterContext _converterContext;
+        std::vector <std::string> _inputFilePaths;
+        std::set <std::string> _uniqueInputFilePaths;
+    };
+}
+
+#endif
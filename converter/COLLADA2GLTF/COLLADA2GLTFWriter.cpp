@@ -37,10 +37,88 @@ using namespace rapidjson;
 
 namespace GLTF
 {
+    //small meshes are the common case, don't reserve the default segment size for each job
+    static const size_t kMeshConversionSegmentSize = 256 * 1024;
+    //bounds the snapshots and encoded buffers kept in memory, enough to keep 32 threads busy.
+    //it does not depend on the threads count so that jobs get committed at the same points whatever the count is
+    static const size_t kMaxPendingMeshConversionJobs = 64;
+    
+    /*
+     OpenCOLLADA keeps process-wide state in its SAX and URI code, and loading several documents at once (batch mode) has not been tested yet.
+     Documents are parsed one at a time, the conversion of their meshes and the writing of their outputs still run in parallel.
+     */
+#ifndef WIN32
+    static pthread_mutex_t __loadDocumentMutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+    
+    static bool __LoadDocument(COLLADAFW::IWriter *writer, ExtraDataHandler *extraDataHandler, const std::string &inputFilePath)
+    {
+#ifndef WIN32
+        pthread_mutex_lock(&__loadDocumentMutex);
+#endif
+        bool documentLoaded = false;
+        {
+            COLLADASaxFWL::Loader loader;
+            COLLADAFW::Root root(&loader, writer);
+            
+            loader.registerExtraDataCallbackHandler(extraDataHandler);
+            documentLoaded = root.loadDocument(inputFilePath);
+        }
+#ifndef WIN32
+        pthread_mutex_unlock(&__loadDocumentMutex);
+#endif
+        return documentLoaded;
+    }
+    
+    //--------------------------------------------------------------------
+    MeshConversionJob::MeshConversionJob(unsigned int meshUID, COLLADAFW::Mesh* openCOLLADAMesh, const GLTFConverterContext& converterContext, Profiler* profiler) :
+    _meshUID(meshUID),
+    _meshes(new MeshVector),
+    _converterContext(converterContext),
+    _profiler(profiler),
+    _verticesOutputStream(kMeshConversionSegmentSize),
+    _indicesOutputStream(kMeshConversionSegmentSize)
+    {
+        this->_snapshot = createSnapshotFromOpenCOLLADAMesh(openCOLLADAMesh, this->_allPrimitiveIndicesVectors, converterContext);
+    }
+    
+    MeshConversionJob::~MeshConversionJob()
+    {
+    }
+    
+    void MeshConversionJob::run()
+    {
+        //IDs generated here get replaced at commit, they must not shift the IDs of the thread running the job (the loader one when running inline)
+        unsigned int generatedIDCount = GLTFUtils::getGeneratedIDCount();
+        
+        //workers have no profiler of their own, the job records into the one of the conversion
+        Profiler *previousProfiler = Profiler::getCurrentProfiler();
+        Profiler::setCurrentProfiler(this->_profiler);
+        
+        convertMeshSnapshot(this->_snapshot.get(), this->_allPrimitiveIndicesVectors, (*this->_meshes), this->_converterContext);
+        
+        //the snapshot is not needed anymore, release it before the job gets committed
+        this->_snapshot.reset();
+        this->_allPrimitiveIndicesVectors.clear();
+        
+        ProfilerScope profilerScope(MESH_BUFFERS_PHASE);
+        for (size_t i = 0 ; i < this->_meshes->size() ; i++) {
+            if ((*this->_meshes)[i]->getPrimitives().size() > 0) {
+                (*this->_meshes)[i]->writeAllBuffers(this->_verticesOutputStream, this->_indicesOutputStream, this->_converterContext.interleaveAttributes);
+            }
+        }
+        profilerScope.end();
+        
+        Profiler::setCurrentProfiler(previousProfiler);
+        GLTFUtils::setGeneratedIDCount(generatedIDCount);
+    }
+    
     //--------------------------------------------------------------------
 	COLLADA2GLTFWriter::COLLADA2GLTFWriter( const GLTFConverterContext &converterArgs, PrettyWriter <FileStream> *jsonWriter ):
     _converterContext(converterArgs),
-    _visualScene(0)
+    _visualScene(0),
+    _meshConversionScheduler(0),
+    _profiler(0)
 	{
         this->_writer.setWriter(jsonWriter);
 	}
@@ -58,86 +136,105 @@ namespace GLTF
 	//--------------------------------------------------------------------
 	bool COLLADA2GLTFWriter::write()
 	{
-        ifstream inputVertices;
-        ifstream inputIndices;
-        ifstream inputAnimations;
-        ofstream verticesOutputStream;
-        
         this->_extraDataHandler = new ExtraDataHandler();
+        
+        //phases run by this thread, and by the mesh conversion jobs, are recorded into the profiler of this conversion
+        Profiler *previousProfiler = Profiler::getCurrentProfiler();
+        if (this->_converterContext.profile) {
+            this->_profiler = new Profiler();
+            Profiler::setCurrentProfiler(this->_profiler);
+        }
+        
+        //in batch mode a thread converts several files, the IDs of a file must not depend on the files converted before
+        GLTFUtils::setGeneratedIDCount(1);
 
         this->_converterContext.shaderIdToShaderString.clear();
         this->_converterContext._uniqueIDToMeshes.clear();
 
         /*
-         1. We output vertices and indices separatly in 2 different files
-         2. Then output them in a single file
+         Vertices are streamed directly at the beginning of the final .bin file,
+         while indices and animations are kept in memory segments appended after the vertices once parsing is done.
+         This way the shared buffer is assembled in a single pass, without temporary files to write and read back.
          */
-        COLLADABU::URI inputURI(this->_converterContext.inputFilePath.c_str());
         COLLADABU::URI outputURI(this->_converterContext.outputFilePath.c_str());
         
-        std::string sharedVerticesBufferID = inputURI.getPathFileBase() + "vertices" + ".bin";
-        std::string sharedIndicesBufferID = inputURI.getPathFileBase() + "indices" + ".bin";
-        std::string sharedAnimationsBufferID = inputURI.getPathFileBase() + "animations" + ".bin";
         std::string sharedBufferID = outputURI.getPathFileBase() + ".bin";
-        std::string outputVerticesFilePath = outputURI.getPathDir() + sharedVerticesBufferID;
-        std::string outputIndicesFilePath = outputURI.getPathDir() + sharedIndicesBufferID;
-        std::string outputAnimationsFilePath = outputURI.getPathDir() + sharedAnimationsBufferID;
         std::string outputFilePath = outputURI.getPathDir() + sharedBufferID;
         
-        this->_verticesOutputStream.open (outputVerticesFilePath.c_str(), ios::out | ios::ate | ios::binary);
-        this->_indicesOutputStream.open (outputIndicesFilePath.c_str(), ios::out | ios::ate | ios::binary);
-        this->_animationsOutputStream.open (outputAnimationsFilePath.c_str(), ios::out | ios::ate | ios::binary);
-        verticesOutputStream.open (outputFilePath.c_str(), ios::out | ios::ate | ios::binary);
+        this->_verticesOutputStream.open (outputFilePath.c_str(), ios::out | ios::ate | ios::binary);
+        this->_indicesOutputStream.releaseSegments();
+        this->_animationsOutputStream.releaseSegments();
+        
+        //identical vertex or index blobs are written once, the ones already written are read back to confirm hash matches
+        this->_sharedBufferPath = outputFilePath;
+        if (this->_verticesInputStream.is_open())
+            this->_verticesInputStream.close();
+        this->_verticesBlobIndex.reset(&this->_verticesOutputStream, COLLADA2GLTFWriter::readVerticesBlob, this);
+        this->_indicesBlobIndex.reset(&this->_indicesOutputStream, readBlobFromSegmentedStream, &this->_indicesOutputStream);
+        //same for animation parameters, which mostly share their times
+        this->_animationsBlobIndex.reset(&this->_animationsOutputStream, readBlobFromSegmentedStream, &this->_animationsOutputStream);
         
         this->_converterContext.root = shared_ptr <GLTF::JSONObject> (new GLTF::JSONObject());
         this->_converterContext.root->setString("profile", "WebGL 1.0");
         this->_converterContext.root->setString("version", "0.3");
         this->_converterContext.root->setValue("nodes", shared_ptr <GLTF::JSONObject> (new GLTF::JSONObject()));
         
-        COLLADASaxFWL::Loader loader;
-		COLLADAFW::Root root(&loader, this);
-        
-        loader.registerExtraDataCallbackHandler(this->_extraDataHandler);
-		if (!root.loadDocument( this->_converterContext.inputFilePath))
+        //geometries are converted, and images probed, on this pool while the loader keeps parsing, see writeGeometry and writeImage
+        this->_meshConversionScheduler = new JobScheduler(this->_converterContext.threadsCount);
+        
+        ProfilerScope parsingProfilerScope(PARSING_PHASE);
+        bool documentLoaded = __LoadDocument(this, this->_extraDataHandler, this->_converterContext.inputFilePath);
+        parsingProfilerScope.end();
+        
+		if (!documentLoaded || !this->commitAllMeshConversionJobs()) {
+            //deleting the scheduler waits for the jobs still running
+            delete this->_meshConversionScheduler;
+            this->_meshConversionScheduler = 0;
+            this->_meshConversionJobs.clear();
+            this->_imageProbingJobs.clear();
+            Profiler::setCurrentProfiler(previousProfiler);
+            delete this->_profiler;
+            this->_profiler = 0;
 			return false;
+        }
+        this->waitForAllImageProbingJobs();
+        delete this->_meshConversionScheduler;
+        this->_meshConversionScheduler = 0;
+        
+        ProfilerScope bufferAssemblyProfilerScope(BUFFER_ASSEMBLY_PHASE);
+        
+        size_t deduplicatedBytesCount = this->_verticesBlobIndex.getDeduplicatedBytesCount() + this->_indicesBlobIndex.getDeduplicatedBytesCount();
+        if (deduplicatedBytesCount > 0) {
+            printf("[buffers] %d duplicated vertex blobs and %d duplicated index blobs written once, %d bytes saved\n",
+                   (int)this->_verticesBlobIndex.getDeduplicatedBlobsCount(),
+                   (int)this->_indicesBlobIndex.getDeduplicatedBlobsCount(),
+                   (int)deduplicatedBytesCount);
+        }
+        if (this->_animationsBlobIndex.getDeduplicatedBytesCount() > 0) {
+            printf("[buffers] %d duplicated animation parameters written once, %d bytes saved\n",
+                   (int)this->_animationsBlobIndex.getDeduplicatedBlobsCount(),
+                   (int)this->_animationsBlobIndex.getDeduplicatedBytesCount());
+        }
+        if (this->_verticesInputStream.is_open())
+            this->_verticesInputStream.close();
         
+        //animations are read as floats, they have to start on a 4 bytes boundary whatever the width and count of the indices before them
+        if (this->_animationsOutputStream.length() > 0) {
+            padStreamToAlignment(this->_indicesOutputStream, sizeof(float));
+        }
         
-        //reopen .bin files for vertices and indices
-        size_t verticesLength = this->_verticesOutputStream.tellp();
-        size_t indicesLength = this->_indicesOutputStream.tellp();
-        size_t animationsLength = this->_animationsOutputStream.tellp();
+        //indices may be 32 bits
+        padStreamToAlignment(this->_verticesOutputStream, sizeof(unsigned int));
         
-        this->_verticesOutputStream.flush();
-        this->_verticesOutputStream.close();
-        this->_indicesOutputStream.flush();
-        this->_indicesOutputStream.close();
-        this->_animationsOutputStream.flush();
-        this->_animationsOutputStream.close();
-        
-        inputVertices.open(outputVerticesFilePath.c_str(), ios::in | ios::binary);
-        inputIndices.open(outputIndicesFilePath.c_str(), ios::in | ios::binary);
-        inputAnimations.open(outputAnimationsFilePath.c_str(), ios::in | ios::binary);
-        
-        char* bufferIOStream = (char*)malloc(sizeof(char) * verticesLength);
-        inputVertices.read(bufferIOStream, verticesLength);
-        verticesOutputStream.write(bufferIOStream, verticesLength);
-        free(bufferIOStream);
-        bufferIOStream = (char*)malloc(sizeof(char) * indicesLength);
-        inputIndices.read(bufferIOStream, indicesLength);
-        verticesOutputStream.write(bufferIOStream, indicesLength);
-        free(bufferIOStream);
-        bufferIOStream = (char*)malloc(sizeof(char) * animationsLength);
-        inputAnimations.read(bufferIOStream, animationsLength);
-        verticesOutputStream.write(bufferIOStream, animationsLength);
-        free(bufferIOStream);
-        
-        inputVertices.close();
-        inputIndices.close();
-        inputAnimations.close();
-        
-        remove(outputIndicesFilePath.c_str());
-        remove(outputVerticesFilePath.c_str());
-        remove(outputAnimationsFilePath.c_str());
+        size_t verticesLength = static_cast<size_t>(this->_verticesOutputStream.tellp());
+        size_t indicesLength = this->_indicesOutputStream.length();
+        size_t animationsLength = this->_animationsOutputStream.length();
+        
+        this->_indicesOutputStream.writeTo(this->_verticesOutputStream);
+        this->_animationsOutputStream.writeTo(this->_verticesOutputStream);
+        bufferAssemblyProfilerScope.end();
+        
+        ProfilerScope serializationProfilerScope(SERIALIZATION_PHASE);
         
         //---
         
@@ -147,15 +244,26 @@ namespace GLTF
         shared_ptr <GLTFBufferView> indicesBufferView(new GLTFBufferView(sharedBuffer, verticesLength, indicesLength));
         shared_ptr <GLTFBufferView> animationsBufferView(new GLTFBufferView(sharedBuffer, verticesLength + indicesLength, animationsLength));
         
+        if (this->_converterContext.streamJSON) {
+            /*
+             Sections built while parsing (nodes, scenes, techniques...) are cross-referenced until the document is loaded,
+             write them now and release them. The sections below are then written object by object as they get serialized.
+             */
+            this->_writer.startObject();
+            this->_converterContext._uniqueIDToTrackedObject.clear();
+            
+            shared_ptr <GLTF::JSONObject> root = this->_converterContext.root;
+            std::vector <std::string> keys = root->getAllKeys();
+            for (size_t i = 0 ; i < keys.size() ; i++) {
+                this->_writer.writeMember(keys[i], root->getValue(keys[i]).get(), 0);
+                root->removeValue(keys[i]);
+            }
+        }
+        
         // ----
         UniqueIDToMeshes::const_iterator UniqueIDToMeshesIterator;
-        shared_ptr <GLTF::JSONObject> meshesObject(new GLTF::JSONObject());
-        
-        this->_converterContext.root->setValue("meshes", meshesObject);
+        std::vector <shared_ptr <GLTFMesh> > exportedMeshes;
         
-        shared_ptr <GLTF::JSONObject> attributes = this->_converterContext.root->createObjectIfNeeded("attributes");
-        shared_ptr <GLTF::JSONObject> indices = this->_converterContext.root->createObjectIfNeeded("indices");
-
         for (UniqueIDToMeshesIterator = this->_converterContext._uniqueIDToMeshes.begin() ; UniqueIDToMeshesIterator != this->_converterContext._uniqueIDToMeshes.end() ; UniqueIDToMeshesIterator++) {
             //(*it).first;             // the key value (of type Key)
             //(*it).second;            // the mapped value (of type T)
@@ -177,56 +285,70 @@ namespace GLTF
                         if (shouldSkipMesh)
                             continue;
                         
-                        void *buffers[2];
-                        buffers[0] = (void*)verticesBufferView.get();
-                        buffers[1] = (void*)indicesBufferView.get();
-                        
-                        shared_ptr <GLTF::JSONObject> meshObject = serializeMesh(mesh.get(), (void*)buffers);
-
-                        //serialize attributes
-                        vector <GLTF::Semantic> allSemantics = mesh->allSemantics();
-                        for (unsigned int i = 0 ; i < allSemantics.size() ; i++) {
-                            GLTF::Semantic semantic = allSemantics[i];
-                            
-                            GLTF::IndexSetToMeshAttributeHashmap::const_iterator meshAttributeIterator;
-                            GLTF::IndexSetToMeshAttributeHashmap& indexSetToMeshAttribute = mesh->getMeshAttributesForSemantic(semantic);
-                            
-                            //FIXME: consider turn this search into a method for mesh
-                            for (meshAttributeIterator = indexSetToMeshAttribute.begin() ; meshAttributeIterator != indexSetToMeshAttribute.end() ; meshAttributeIterator++) {
-                                //(*it).first;             // the key value (of type Key)
-                                //(*it).second;            // the mapped value (of type T)
-                                shared_ptr <GLTF::GLTFMeshAttribute> meshAttribute = (*meshAttributeIterator).second;
-                                
-                                shared_ptr <GLTF::JSONObject> meshAttributeObject = serializeMeshAttribute(meshAttribute.get(), (void*)buffers);
-                                
-                                attributes->setValue(meshAttribute->getID(), meshAttributeObject);
-                            }
-                        }
-                        
-                        //serialize indices
-                        primitives = mesh->getPrimitives();
-                        unsigned int primitivesCount =  (unsigned int)primitives.size();
-                        for (unsigned int i = 0 ; i < primitivesCount ; i++) {
-                            shared_ptr<GLTF::GLTFPrimitive> primitive = primitives[i];
-                            shared_ptr <GLTF::GLTFIndices> uniqueIndices =  primitive->getUniqueIndices();
-                            
-                            shared_ptr <GLTF::JSONObject> serializedIndices = serializeIndices(uniqueIndices.get(), (void*)buffers);
-                            indices->setValue(uniqueIndices->getID(), serializedIndices);
-                            
-                        }
-
-                        
-                        
-                        meshesObject->setValue(mesh->getID(), meshObject);
+                        exportedMeshes.push_back(mesh);
                     }
                 }
             }
         }
         
-        // ----
-        shared_ptr <GLTF::JSONObject> materialsObject(new GLTF::JSONObject());
+        void *buffers[2];
+        buffers[0] = (void*)verticesBufferView.get();
+        buffers[1] = (void*)indicesBufferView.get();
+        
+        //serialize attributes, meshes split from the same geometry share them
+        std::set <std::string> serializedIDs;
+        this->startSection("attributes");
+        for (size_t j = 0 ; j < exportedMeshes.size() ; j++) {
+            shared_ptr<GLTFMesh> mesh = exportedMeshes[j];
+            
+            vector <GLTF::Semantic> allSemantics = mesh->allSemantics();
+            for (unsigned int i = 0 ; i < allSemantics.size() ; i++) {
+                GLTF::Semantic semantic = allSemantics[i];
+                
+                GLTF::IndexSetToMeshAttributeHashmap::const_iterator meshAttributeIterator;
+                GLTF::IndexSetToMeshAttributeHashmap& indexSetToMeshAttribute = mesh->getMeshAttributesForSemantic(semantic);
+                
+                //FIXME: consider turn this search into a method for mesh
+                for (meshAttributeIterator = indexSetToMeshAttribute.begin() ; meshAttributeIterator != indexSetToMeshAttribute.end() ; meshAttributeIterator++) {
+                    //(*it).first;             // the key value (of type Key)
+                    //(*it).second;            // the mapped value (of type T)
+                    shared_ptr <GLTF::GLTFMeshAttribute> meshAttribute = (*meshAttributeIterator).second;
+                    
+                    if (serializedIDs.insert(meshAttribute->getID()).second) {
+                        this->addToSection(meshAttribute->getID(), serializeMeshAttribute(meshAttribute.get(), (void*)buffers));
+                    }
+                }
+            }
+        }
+        this->endSection();
+        
+        //serialize indices
+        serializedIDs.clear();
+        this->startSection("indices");
+        for (size_t j = 0 ; j < exportedMeshes.size() ; j++) {
+            PrimitiveVector primitives = exportedMeshes[j]->getPrimitives();
+            unsigned int primitivesCount =  (unsigned int)primitives.size();
+            for (unsigned int i = 0 ; i < primitivesCount ; i++) {
+                shared_ptr<GLTF::GLTFPrimitive> primitive = primitives[i];
+                shared_ptr <GLTF::GLTFIndices> uniqueIndices =  primitive->getUniqueIndices();
+                
+                if (serializedIDs.insert(uniqueIndices->getID()).second) {
+                    this->addToSection(uniqueIndices->getID(), serializeIndices(uniqueIndices.get(), (void*)buffers));
+                }
+            }
+        }
+        this->endSection();
+        
+        this->startSection("meshes");
+        for (size_t j = 0 ; j < exportedMeshes.size() ; j++) {
+            shared_ptr<GLTFMesh> mesh = exportedMeshes[j];
+            
+            this->addToSection(mesh->getID(), serializeMesh(mesh.get(), (void*)buffers));
+        }
+        this->endSection();
         
-        this->_converterContext.root->setValue("materials", materialsObject);
+        // ----
+        this->startSection("materials");
         
         UniqueIDToEffect::const_iterator UniqueIDToEffectIterator;
         
@@ -237,15 +359,15 @@ namespace GLTF
             if (effect->getTechniqueID() != "") {
                 shared_ptr <GLTF::JSONObject> effectObject = serializeEffect(effect.get(), 0);
                 //FIXME:HACK: effects are exported as materials
-                materialsObject->setValue(effect->getID(), effectObject);
+                this->addToSection(effect->getID(), effectObject);
             }
         }
+        this->endSection();
         
         // ----
         UniqueIDToAnimation::const_iterator UniqueIDToAnimationsIterator;
-        shared_ptr <GLTF::JSONObject> animationsObject(new GLTF::JSONObject());
         
-        this->_converterContext.root->setValue("animations", animationsObject);
+        this->startSection("animations");
         
         for (UniqueIDToAnimationsIterator = this->_converterContext._uniqueIDToAnimation.begin() ; UniqueIDToAnimationsIterator != this->_converterContext._uniqueIDToAnimation.end() ; UniqueIDToAnimationsIterator++) {
             //(*it).first;             // the key value (of type Key)
@@ -261,35 +383,40 @@ namespace GLTF
             if (animation->channels()->values().size() > 0) {
                 shared_ptr <JSONObject> animationObject = serializeAnimation(animation.get());
             
-                animationsObject->setValue(animation->getID(), animationObject);
+                this->addToSection(animation->getID(), animationObject);
             }
         }
+        this->endSection();
         
-        shared_ptr <JSONObject> buffersObject(new JSONObject());
         shared_ptr <JSONObject> bufferObject = serializeBuffer(sharedBuffer.get(), 0);
         
-        this->_converterContext.root->setValue("buffers", buffersObject);
-        buffersObject->setValue(sharedBufferID, bufferObject);
+        this->startSection("buffers");
+        this->addToSection(sharedBufferID, bufferObject);
+        this->endSection();
         
         //FIXME: below is an acceptable short-cut since in this converter we will always create one buffer view for vertices and one for indices.
         //Fabrice: Other pipeline tools should be built on top of the format manipulate the buffers and end up with a buffer / bufferViews layout that matches the need of a given application for performance. For instance we might want to concatenate a set of geometry together that come from different file and call that a "level" for a game.
-        shared_ptr <JSONObject> bufferViewsObject(new JSONObject());
-        this->_converterContext.root->setValue("bufferViews", bufferViewsObject);
-        
         shared_ptr <JSONObject> bufferViewIndicesObject = serializeBufferView(indicesBufferView.get(), 0);
         shared_ptr <JSONObject> bufferViewVerticesObject = serializeBufferView(verticesBufferView.get(), 0);
         shared_ptr <JSONObject> bufferViewAnimationsObject = serializeBufferView(animationsBufferView.get(), 0);
-        bufferViewsObject->setValue(indicesBufferView->getID(), bufferViewIndicesObject);
-        bufferViewsObject->setValue(verticesBufferView->getID(), bufferViewVerticesObject);
-        if (animationsLength > 0) {
-            bufferViewsObject->setValue(animationsBufferView->getID(), bufferViewAnimationsObject);
-        }
         bufferViewIndicesObject->setString("target", "ELEMENT_ARRAY_BUFFER");
         bufferViewVerticesObject->setString("target", "ARRAY_BUFFER");
         
+        this->startSection("bufferViews");
+        this->addToSection(indicesBufferView->getID(), bufferViewIndicesObject);
+        this->addToSection(verticesBufferView->getID(), bufferViewVerticesObject);
+        if (animationsLength > 0) {
+            this->addToSection(animationsBufferView->getID(), bufferViewAnimationsObject);
+        }
+        this->endSection();
+        
         //---
         
-        this->_converterContext.root->write(&this->_writer);
+        if (this->_converterContext.streamJSON) {
+            this->_writer.endObject();
+        } else {
+            this->_converterContext.root->write(&this->_writer);
+        }
         
         bool sceneFlatteningEnabled = false;
         if (sceneFlatteningEnabled) {
@@ -297,14 +424,40 @@ namespace GLTF
             processSceneFlatteningInfo(&this->_sceneFlatteningInfo);
         }
         
-        verticesOutputStream.flush();
-        verticesOutputStream.close();
+        this->_verticesOutputStream.flush();
+        this->_verticesOutputStream.close();
+        serializationProfilerScope.end();
+        
+        if (this->_profiler) {
+            Profiler::setCurrentProfiler(previousProfiler);
+            this->writeProfileReport(outputURI.getPathDir() + outputURI.getPathFileBase() + ".profile.json");
+            delete this->_profiler;
+            this->_profiler = 0;
+        }
         
         delete this->_extraDataHandler;
         
 		return true;
 	}
     
+    //--------------------------------------------------------------------
+    void COLLADA2GLTFWriter::writeProfileReport(const std::string& reportPath)
+    {
+        FILE* fd = fopen(reportPath.c_str(), "w");
+        if (!fd) {
+            printf("WARNING: cannot open %s for writing\n", reportPath.c_str());
+            return;
+        }
+        
+        rapidjson::FileStream s(fd);
+        rapidjson::PrettyWriter <rapidjson::FileStream> jsonWriter(s);
+        GLTFWriter reportWriter(&jsonWriter);
+        this->_profiler->createReport()->write(&reportWriter);
+        fclose(fd);
+        
+        printf("[profile] %s\n", reportPath.c_str());
+    }
+    
 	//--------------------------------------------------------------------
 	void COLLADA2GLTFWriter::cancel( const std::string& errorMessage )
 	{
@@ -341,6 +494,19 @@ namespace GLTF
         }
     }
     
+    //kept in double precision, the translation brings recentered positions back to their place
+    static shared_ptr <GLTF::JSONArray> __SerializeTranslationMatrix(const std::vector <double> &translation)
+    {
+        shared_ptr <GLTF::JSONArray> array(new GLTF::JSONArray());
+        for (size_t i = 0 ; i < 16; i++)  {
+            double value = ((i % 5) == 0) ? 1 : 0;
+            if ((i >= 12) && ((i - 12) < translation.size()))
+                value = translation[i - 12];
+            array->appendValue(shared_ptr <GLTF::JSONValue> (new GLTF::JSONNumber(value)));
+        }
+        return array;
+    }
+    
     shared_ptr <GLTF::JSONArray> COLLADA2GLTFWriter::serializeMatrix4Array(const COLLADABU::Math::Matrix4 &matrix)
     {
         float m[16];
@@ -372,6 +538,38 @@ namespace GLTF
         return getTransparency(effectCommon)  >= 1;
     }
     
+    /*
+        Top-level sections completed once the document is loaded. They are either added to the root object,
+        or when streaming JSON, written as soon as each of their objects is serialized.
+     */
+    void COLLADA2GLTFWriter::startSection(const std::string& sectionName)
+    {
+        if (this->_converterContext.streamJSON) {
+            this->_writer.writeKey(sectionName);
+            this->_writer.startObject();
+        } else {
+            this->_section = this->_converterContext.root->createObjectIfNeeded(sectionName);
+        }
+    }
+    
+    void COLLADA2GLTFWriter::addToSection(const std::string& objectID, shared_ptr <JSONObject> object)
+    {
+        if (this->_converterContext.streamJSON) {
+            this->_writer.writeMember(objectID, object.get(), 0);
+        } else {
+            this->_section->setValue(objectID, object);
+        }
+    }
+    
+    void COLLADA2GLTFWriter::endSection()
+    {
+        if (this->_converterContext.streamJSON) {
+            this->_writer.endObject();
+        } else {
+            this->_section.reset();
+        }
+    }
+    
     void COLLADA2GLTFWriter::registerObjectWithUniqueUID(std::string objectUID, shared_ptr <JSONObject> obj, shared_ptr <JSONObject> objLib)
     {
         if (this->_converterContext._uniqueIDToTrackedObject.count(objectUID) == 0) {
@@ -386,6 +584,38 @@ namespace GLTF
         }
     }
 
+    static void __SetLevelsOfDetailExtras(shared_ptr <GLTF::JSONObject> nodeObject, std::map <unsigned int, shared_ptr <GLTF::JSONArray> > &levelsOfDetailMeshes, const std::vector <double> &levelsOfDetailRatios)
+    {
+        if (levelsOfDetailMeshes.size() == 0)
+            return;
+        
+        shared_ptr <GLTF::JSONArray> levelsOfDetailArray(new GLTF::JSONArray());
+        std::map <unsigned int, shared_ptr <GLTF::JSONArray> >::const_iterator levelIterator;
+        for (levelIterator = levelsOfDetailMeshes.begin() ; levelIterator != levelsOfDetailMeshes.end() ; levelIterator++) {
+            shared_ptr <GLTF::JSONObject> levelObject(new GLTF::JSONObject());
+            levelObject->setDouble("ratio", levelsOfDetailRatios[(*levelIterator).first - 1]);
+            levelObject->setValue("meshes", (*levelIterator).second);
+            levelsOfDetailArray->appendValue(levelObject);
+        }
+        shared_ptr <GLTF::JSONObject> extrasObject(new GLTF::JSONObject());
+        extrasObject->setValue("levelsOfDetail", levelsOfDetailArray);
+        nodeObject->setValue("extras", extrasObject);
+    }
+    
+    //empty unless the positions of the geometry were recentered, meshes split from it share its positions
+    static std::vector <double> __GetPositionsOrigin(MeshVectorSharedPtr meshes)
+    {
+        for (size_t meshIndex = 0 ; meshIndex < meshes->size() ; meshIndex++) {
+            shared_ptr <GLTFMesh> mesh = (*meshes)[meshIndex];
+            if (!mesh)
+                continue;
+            GLTF::IndexSetToMeshAttributeHashmap& semanticMap = mesh->getMeshAttributesForSemantic(GLTF::POSITION);
+            if (semanticMap.count(0) > 0)
+                return semanticMap[0]->getOrigin();
+        }
+        return std::vector <double> ();
+    }
+    
     bool COLLADA2GLTFWriter::writeNode( const COLLADAFW::Node* node,
                                        shared_ptr <GLTF::JSONObject> nodesObject,
                                        COLLADABU::Math::Matrix4 parentMatrix,
@@ -492,10 +722,14 @@ namespace GLTF
         // save mesh
 		const InstanceGeometryPointerArray& instanceGeometries = node->getInstanceGeometries();
         
+        //recentered geometries are instanced by a child node translated by their origin
+        std::vector <std::string> originNodeIDs;
         unsigned int count = (unsigned int)instanceGeometries.getCount();
         if (count > 0) {
             shared_ptr <GLTF::JSONArray> meshesArray(new GLTF::JSONArray());
             nodeObject->setValue("meshes", meshesArray);
+            //meshes of each level of detail, they are not rendered with the node, viewers swap them in for its meshes
+            std::map <unsigned int, shared_ptr <GLTF::JSONArray> > levelsOfDetailMeshes;
             
             for (unsigned int i = 0 ; i < count; i++) {
                 InstanceGeometry* instanceGeometry = instanceGeometries[i];
@@ -510,6 +744,21 @@ namespace GLTF
                 
                 if (meshes)
                 {
+                    std::vector <double> origin = __GetPositionsOrigin(meshes);
+                    shared_ptr <GLTF::JSONArray> instanceMeshesArray = meshesArray;
+                    std::map <unsigned int, shared_ptr <GLTF::JSONArray> > originLevelsOfDetailMeshes;
+                    std::map <unsigned int, shared_ptr <GLTF::JSONArray> > *instanceLevelsOfDetailMeshes = &levelsOfDetailMeshes;
+                    shared_ptr <GLTF::JSONObject> originNodeObject;
+                    if (origin.size() > 0) {
+                        originNodeObject = shared_ptr <GLTF::JSONObject> (new GLTF::JSONObject());
+                        originNodeObject->setString("name", node->getName());
+                        originNodeObject->setValue("matrix", __SerializeTranslationMatrix(origin));
+                        instanceMeshesArray = shared_ptr <GLTF::JSONArray> (new GLTF::JSONArray());
+                        originNodeObject->setValue("meshes", instanceMeshesArray);
+                        originNodeObject->setValue("children", shared_ptr <GLTF::JSONArray> (new GLTF::JSONArray()));
+                        instanceLevelsOfDetailMeshes = &originLevelsOfDetailMeshes;
+                    }
+                    
                     for (size_t meshIndex = 0 ; meshIndex < meshes->size() ; meshIndex++) {
                         shared_ptr <GLTFMesh> mesh = (*meshes)[meshIndex];
                         
@@ -517,12 +766,18 @@ namespace GLTF
                             continue;
                         }
                         
-                        if (sceneFlatteningInfo) {
+                        if (sceneFlatteningInfo && (mesh->getLevelOfDetail() == 0)) {
                             GLTF::IndexSetToMeshAttributeHashmap& semanticMap = mesh->getMeshAttributesForSemantic(GLTF::POSITION);
                             shared_ptr <GLTF::GLTFMeshAttribute> vertexMeshAttribute = semanticMap[0];
                             
-                            BBOX vertexBBOX(COLLADABU::Math::Vector3(vertexMeshAttribute->getMin()),
-                                            COLLADABU::Math::Vector3(vertexMeshAttribute->getMax()));
+                            double vertexMin[3], vertexMax[3];
+                            for (size_t k = 0 ; k < 3 ; k++) {
+                                double offset = (k < origin.size()) ? origin[k] : 0;
+                                vertexMin[k] = vertexMeshAttribute->getMin()[k] + offset;
+                                vertexMax[k] = vertexMeshAttribute->getMax()[k] + offset;
+                            }
+                            BBOX vertexBBOX(COLLADABU::Math::Vector3(vertexMin),
+                                            COLLADABU::Math::Vector3(vertexMax));
                             vertexBBOX.transform(worldMatrix);
                             
                             sceneFlatteningInfo->sceneBBOX.merge(&vertexBBOX);
@@ -592,6 +847,7 @@ namespace GLTF
                                 }
                                 
                                 //generate shaders if needed
+                                ProfilerScope profilerScope(SHADERS_PHASE);
                                 const std::string& techniqueID = GLTF::getReferenceTechniqueID(effect->getLightingModel(),
                                                                                                effect->getValues(),
                                                                                                techniqueExtras,
@@ -607,19 +863,40 @@ namespace GLTF
                         }
 
 
-                        meshesArray->appendValue(shared_ptr <GLTF::JSONString> (new GLTF::JSONString(mesh->getID())));
+                        if (mesh->getLevelOfDetail() != 0) {
+                            shared_ptr <GLTF::JSONArray> &levelMeshesArray = (*instanceLevelsOfDetailMeshes)[mesh->getLevelOfDetail()];
+                            if (!levelMeshesArray)
+                                levelMeshesArray = shared_ptr <GLTF::JSONArray> (new GLTF::JSONArray());
+                            levelMeshesArray->appendValue(shared_ptr <GLTF::JSONString> (new GLTF::JSONString(mesh->getID())));
+                            continue;
+                        }
+                        
+                        instanceMeshesArray->appendValue(shared_ptr <GLTF::JSONString> (new GLTF::JSONString(mesh->getID())));
                         if (sceneFlatteningInfo) {
                             shared_ptr <MeshFlatteningInfo> meshFlatteningInfo(new MeshFlatteningInfo(meshUID, parentMatrix));
                             sceneFlatteningInfo->allMeshes.push_back(meshFlatteningInfo);
                         }
                     }
+                    
+                    if (originNodeObject) {
+                        __SetLevelsOfDetailExtras(originNodeObject, originLevelsOfDetailMeshes, this->_converterContext.levelsOfDetailRatios);
+                        std::string originNodeID = nodeUID + "_instance_" + GLTFUtils::toString(i);
+                        registerObjectWithUniqueUID(originNodeID, originNodeObject, nodesObject);
+                        originNodeIDs.push_back(originNodeID);
+                    }
                 }
             }
+            
+            __SetLevelsOfDetailExtras(nodeObject, levelsOfDetailMeshes, this->_converterContext.levelsOfDetailRatios);
         }
         
         shared_ptr <GLTF::JSONArray> childrenArray(new GLTF::JSONArray());
         nodeObject->setValue("children", childrenArray);
         
+        for (size_t i = 0 ; i < originNodeIDs.size() ; i++)  {
+            childrenArray->appendValue(shared_ptr <GLTF::JSONString> (new GLTF::JSONString(originNodeIDs[i])));
+        }
+        
         count = (unsigned int)nodes.getCount();
         
         for (unsigned int i = 0 ; i < count ; i++)  {
@@ -673,6 +950,14 @@ namespace GLTF
     
     bool COLLADA2GLTFWriter::writeVisualScene( const COLLADAFW::VisualScene* visualScene )
 	{
+        ProfilerScope profilerScope(NODES_PHASE);
+        
+        //nodes bind materials to the primitives of the meshes they instance, so all meshes have to be available
+        if (!this->commitAllMeshConversionJobs())
+            return false;
+        //and the techniques of these materials depend on whether their images have alpha
+        this->waitForAllImageProbingJobs();
+        
         //FIXME: only one visual scene assumed/handled
         shared_ptr <GLTF::JSONObject> scenesObject(new GLTF::JSONObject());
         shared_ptr <GLTF::JSONObject> sceneObject(new GLTF::JSONObject());
@@ -717,8 +1002,13 @@ namespace GLTF
 	//--------------------------------------------------------------------
 	bool COLLADA2GLTFWriter::writeLibraryNodes( const COLLADAFW::LibraryNodes* libraryNodes )
 	{
+        ProfilerScope profilerScope(NODES_PHASE);
+        
         const NodePointerArray& nodes = libraryNodes->getNodes();
         
+        if (!this->commitAllMeshConversionJobs())
+            return false;
+        
         shared_ptr <GLTF::JSONObject> nodesObject = static_pointer_cast <GLTF::JSONObject> (this->_converterContext.root->getValue("nodes"));
         
         size_t count = nodes.getCount();
@@ -733,29 +1023,116 @@ namespace GLTF
 	}
     
 	//--------------------------------------------------------------------
+    /*
+        Jobs are committed in the order they were scheduled, and only from writeGeometry (when too many are in flight)
+        or before the nodes get written. This keeps the buffer layout and the generated IDs independent of the threads count and scheduling.
+     */
+    bool COLLADA2GLTFWriter::commitNextMeshConversionJob()
+    {
+        ProfilerScope profilerScope(BUFFER_ASSEMBLY_PHASE);
+        
+        shared_ptr <MeshConversionJob> job = this->_meshConversionJobs.front();
+        this->_meshConversionJobs.pop_front();
+        
+        this->_meshConversionScheduler->waitForJob(job.get());
+        
+        //the job wrote its buffers at the beginning of its own streams, they are moved to the shared ones blob by blob, skipping the ones already there
+        MeshVectorSharedPtr meshes = job->getMeshes();
+        if (!appendMeshesBuffers(*meshes,
+                                 job->getVerticesOutputStream(),
+                                 job->getIndicesOutputStream(),
+                                 this->_verticesBlobIndex,
+                                 this->_indicesBlobIndex)) {
+            //their offsets would point at the wrong bytes of the shared buffer
+            printf("ERROR: the buffers of a converted geometry could not be read back, the conversion is aborted\n");
+            return false;
+        }
+        
+        std::set <GLTFMeshAttribute*> committedMeshAttributes;
+        for (size_t i = 0 ; i < meshes->size() ; i++) {
+            shared_ptr <GLTFMesh> mesh = (*meshes)[i];
+            PrimitiveVector primitives = mesh->getPrimitives();
+            if (primitives.size() == 0)
+                continue;
+            
+            //IDs generated on a worker thread are not unique, give the serialized objects their final IDs
+            shared_ptr <MeshAttributeVector> allMeshAttributes = mesh->meshAttributes();
+            for (size_t j = 0 ; j < allMeshAttributes->size() ; j++) {
+                GLTFMeshAttribute* meshAttribute = (*allMeshAttributes)[j].get();
+                if (committedMeshAttributes.count(meshAttribute) != 0)
+                    continue;
+                committedMeshAttributes.insert(meshAttribute);
+                
+                meshAttribute->setID(GLTFUtils::generateIDForType("attribute"));
+            }
+            
+            for (size_t j = 0 ; j < primitives.size() ; j++) {
+                shared_ptr <GLTFIndices> uniqueIndices = primitives[j]->getUniqueIndices();
+                
+                uniqueIndices->setID(GLTFUtils::generateIDForType("indices"));
+            }
+        }
+        
+        this->_converterContext._uniqueIDToMeshes[job->getUID()] = meshes;
+        return true;
+    }
+    
+    //BlobReaderFunc reading back the vertices already written to the shared buffer
+    bool COLLADA2GLTFWriter::readVerticesBlob(size_t offset, unsigned char *data, size_t length, void *context)
+    {
+        COLLADA2GLTFWriter *writer = (COLLADA2GLTFWriter*)context;
+        writer->_verticesOutputStream.flush();
+        if (!writer->_verticesInputStream.is_open()) {
+            writer->_verticesInputStream.open(writer->_sharedBufferPath.c_str(), ios::in | ios::binary);
+        }
+        writer->_verticesInputStream.clear();
+        writer->_verticesInputStream.seekg(offset);
+        writer->_verticesInputStream.read((char*)data, length);
+        return writer->_verticesInputStream.good();
+    }
+    
+    bool COLLADA2GLTFWriter::commitAllMeshConversionJobs()
+    {
+        while (this->_meshConversionJobs.size() > 0) {
+            if (!this->commitNextMeshConversionJob())
+                return false;
+        }
+        return true;
+    }
+    
+    void COLLADA2GLTFWriter::waitForAllImageProbingJobs()
+    {
+        while (this->_imageProbingJobs.size() > 0) {
+            this->_meshConversionScheduler->waitForJob(this->_imageProbingJobs.front().get());
+            this->_imageProbingJobs.pop_front();
+        }
+    }
+    
     bool COLLADA2GLTFWriter::writeGeometry( const COLLADAFW::Geometry* geometry )
 	{
+        ProfilerScope profilerScope(GEOMETRIES_PHASE);
+        
         switch (geometry->getType()) {
             case Geometry::GEO_TYPE_MESH:
             {
                 const COLLADAFW::Mesh* mesh = (COLLADAFW::Mesh*)geometry;
                 unsigned int meshID = (unsigned int)geometry->getUniqueId().getObjectId();
-                MeshVectorSharedPtr meshes;
                 
                 if (this->_converterContext._uniqueIDToMeshes.count(meshID) == 0) {
-                    meshes =  shared_ptr<MeshVector> (new MeshVector);
+                    //OpenCOLLADA releases the mesh when we return, the job takes a snapshot of what it needs right away
+                    shared_ptr <MeshConversionJob> job(new MeshConversionJob(meshID, (COLLADAFW::Mesh*)mesh, this->_converterContext, this->_profiler));
+                    Profiler::count(GEOMETRIES_COUNTER, 1);
                     
-                    convertOpenCOLLADAMesh((COLLADAFW::Mesh*)mesh, (*meshes));
+                    //reserve the entry until the job gets committed
+                    this->_converterContext._uniqueIDToMeshes[meshID] = MeshVectorSharedPtr();
                     
-                    if (meshes->size()) {
-                        for (size_t i = 0 ; i < meshes->size() ; i++) {
-                            if ((*meshes)[i]->getPrimitives().size() > 0) {
-                                (*meshes)[i]->writeAllBuffers(this->_verticesOutputStream, this->_indicesOutputStream);
-                            }
-                        }
-                    }
+                    this->_meshConversionJobs.push_back(job);
+                    this->_meshConversionScheduler->schedule(job.get());
                     
-                    this->_converterContext._uniqueIDToMeshes[meshID] = meshes;
+                    while (this->_meshConversionJobs.size() > kMaxPendingMeshConversionJobs) {
+                        if (!this->commitNextMeshConversionJob())
+                            return false;
+                    }
                 }
             }
                 break;
@@ -773,6 +1150,8 @@ namespace GLTF
 	//--------------------------------------------------------------------
 	bool COLLADA2GLTFWriter::writeMaterial( const COLLADAFW::Material* material )
 	{
+        ProfilerScope profilerScope(MATERIALS_PHASE);
+        
         const UniqueId& effectUID = material->getInstantiatedEffect();
 		unsigned int materialID = (unsigned int)material->getUniqueId().getObjectId();
         this->_converterContext._materialUIDToName[materialID] = material->getName();
@@ -887,6 +1266,8 @@ namespace GLTF
     
     bool COLLADA2GLTFWriter::writeEffect( const COLLADAFW::Effect* effect )
 	{
+        ProfilerScope profilerScope(MATERIALS_PHASE);
+        
         const COLLADAFW::CommonEffectPointerArray& commonEffects = effect->getCommonEffects();
         
         if (commonEffects.getCount() > 0) {
@@ -1042,6 +1423,8 @@ namespace GLTF
 	//--------------------------------------------------------------------
 	bool COLLADA2GLTFWriter::writeImage( const COLLADAFW::Image* openCOLLADAImage )
 	{
+        Profiler::count(IMAGES_COUNTER, 1);
+        
         shared_ptr <GLTF::JSONObject> images = this->_converterContext.root->createObjectIfNeeded("images");
         shared_ptr <GLTF::JSONObject> image(new GLTF::JSONObject());
         
@@ -1063,6 +1446,13 @@ namespace GLTF
         image->setString("path", relPathFile);
         
         this->_converterContext._imageIdToImagePath[uniqueIdWithType("image",openCOLLADAImage->getUniqueId()) ] = relPathFile;
+        
+        //techniques only need the metadata once the visual scene gets written, images are probed concurrently until then
+        COLLADABU::URI inputURI(this->_converterContext.inputFilePath.c_str());
+        shared_ptr <ImageProbingJob> job(new ImageProbingJob(inputURI.getPathDir() + relPathFile, this->_profiler));
+        this->_imageProbingJobs.push_back(job);
+        this->_meshConversionScheduler->schedule(job.get());
+        
         return true;
 	}
     
@@ -1075,6 +1465,9 @@ namespace GLTF
 	//--------------------------------------------------------------------
 	bool COLLADA2GLTFWriter::writeAnimation( const COLLADAFW::Animation* animation )
 	{
+        ProfilerScope profilerScope(ANIMATIONS_PHASE);
+        Profiler::count(ANIMATIONS_COUNTER, 1);
+        
         shared_ptr <GLTFAnimation> cvtAnimation = convertOpenCOLLADAAnimationToGLTFAnimation(animation);
         
         this->_converterContext._uniqueIDToAnimation[animation->getUniqueId().getObjectId()] = cvtAnimation;
@@ -1085,6 +1478,8 @@ namespace GLTF
 	//--------------------------------------------------------------------
 	bool COLLADA2GLTFWriter::writeAnimationList( const COLLADAFW::AnimationList* animationList )
 	{
+        ProfilerScope profilerScope(ANIMATIONS_PHASE);
+        
         const COLLADAFW::AnimationList::AnimationBindings &animationBindings = animationList->getAnimationBindings();
         
         AnimatedTargetsSharedPtr animatedTargets = this->_converterContext._uniqueIDToAnimatedTargets[animationList->getUniqueId().getObjectId()];
@@ -1092,7 +1487,7 @@ namespace GLTF
         for (size_t i = 0 ; i < animationBindings.getCount() ; i++) {
             shared_ptr <GLTFAnimation> cvtAnimation = this->_converterContext._uniqueIDToAnimation[animationBindings[i].animation.getObjectId()];
             const COLLADAFW::AnimationList::AnimationClass animationClass = animationBindings[i].animationClass;
-            if (!GLTF::writeAnimation(cvtAnimation, animationClass, animatedTargets, this->_animationsOutputStream, this->_converterContext)) {
+            if (!GLTF::writeAnimation(cvtAnimation, animationClass, animatedTargets, this->_animationsBlobIndex, this->_converterContext)) {
                 this->_converterContext._uniqueIDToAnimation.erase(this->_converterContext._uniqueIDToAnimation.find(animationBindings[i].animation.getObjectId()));
             }
         }
@@ -34,6 +34,11 @@
 #include "shaders/commonProfileShaders.h"
 #include "helpers/geometryHelpers.h"
 #include "helpers/mathHelpers.h"
+#include "helpers/vertexCacheHelpers.h"
+#include "helpers/jobScheduler.h"
+#include "helpers/blobIndex.h"
+#include "helpers/profiler.h"
+#include "helpers/imageHelpers.h"
 #include "convert/animationConverter.h"
 #include "convert/meshConverter.h"
 
@@ -68,6 +73,39 @@ namespace GLTF
         MeshFlatteningInfoVector allMeshes;
     } SceneFlatteningInfo;
     
+    // -- Geometry conversion
+    
+    /*
+        Converts a mesh snapshot and encodes its buffers in streams of its own, so that it can run on any thread.
+        Byte offsets and IDs are finalized when the writer commits the job.
+     */
+    class MeshConversionJob : public Job
+    {
+    public:
+        MeshConversionJob(unsigned int meshUID, COLLADAFW::Mesh* openCOLLADAMesh, const GLTFConverterContext& converterContext, Profiler* profiler);
+        virtual ~MeshConversionJob();
+        
+        virtual void run();
+        
+        unsigned int getUID() { return this->_meshUID; }
+        MeshVectorSharedPtr getMeshes() { return this->_meshes; }
+        GLTFSegmentedOutputStream& getVerticesOutputStream() { return this->_verticesOutputStream; }
+        GLTFSegmentedOutputStream& getIndicesOutputStream() { return this->_indicesOutputStream; }
+        
+    private:
+        unsigned int _meshUID;
+        shared_ptr <GLTFMesh> _snapshot;
+        std::vector< shared_ptr<IndicesVector> > _allPrimitiveIndicesVectors;
+        MeshVectorSharedPtr _meshes;
+        const GLTFConverterContext& _converterContext;
+        Profiler *_profiler;
+        GLTFSegmentedOutputStream _verticesOutputStream;
+        GLTFSegmentedOutputStream _indicesOutputStream;
+    };
+    
+    typedef std::list < shared_ptr <MeshConversionJob> > MeshConversionJobList;
+    typedef std::list < shared_ptr <ImageProbingJob> > ImageProbingJobList;
+    
     //-- OpenCOLLADA -> JSON writer implementation
     
 	class COLLADA2GLTFWriter : public COLLADAFW::IWriter
@@ -171,6 +209,15 @@ namespace GLTF
         void handleEffectSlot(const COLLADAFW::EffectCommon* commonProfile,
                               std::string slotName,
                               shared_ptr <GLTFEffect> cvtEffect);
+        bool commitNextMeshConversionJob();
+        bool commitAllMeshConversionJobs();
+        void waitForAllImageProbingJobs();
+        void writeProfileReport(const std::string& reportPath);
+        static bool readVerticesBlob(size_t offset, unsigned char *data, size_t length, void *context);
+        
+        void startSection(const std::string& sectionName);
+        void addToSection(const std::string& objectID, shared_ptr <JSONObject> object);
+        void endSection();
         
 	private:
         GLTF::GLTFConverterContext _converterContext;
@@ -179,8 +226,18 @@ namespace GLTF
         SceneFlatteningInfo _sceneFlatteningInfo;
         GLTF::ExtraDataHandler *_extraDataHandler;
         std::ofstream _verticesOutputStream;
-        std::ofstream _indicesOutputStream;
-        std::ofstream _animationsOutputStream;
+        std::ifstream _verticesInputStream;
+        std::string _sharedBufferPath;
+        GLTF::BlobIndex _verticesBlobIndex;
+        GLTF::BlobIndex _indicesBlobIndex;
+        GLTF::BlobIndex _animationsBlobIndex;
+        GLTF::GLTFSegmentedOutputStream _indicesOutputStream;
+        GLTF::GLTFSegmentedOutputStream _animationsOutputStream;
+        GLTF::JobScheduler *_meshConversionScheduler;
+        GLTF::Profiler *_profiler;
+        MeshConversionJobList _meshConversionJobs;
+        ImageProbingJobList _imageProbingJobs;
+        shared_ptr <GLTF::JSONObject> _section;
 	};
 } 
 
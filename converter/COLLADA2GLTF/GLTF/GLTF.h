@@ -61,6 +61,7 @@
 #include "JSONArray.h"
 #include "GLTFUtils.h"
 #include "GLTFBuffer.h"
+#include "GLTFOutputStream.h"
 #include "GLTFMeshAttribute.h"
 #include "GLTFIndices.h"
 #include "GLTFEffect.h"
@@ -33,11 +33,11 @@ namespace GLTF
     
     //-- GLTFAnimation::Parameter
     
-    GLTFAnimation::Parameter::Parameter() {
+    GLTFAnimation::Parameter::Parameter() : _componentType(FLOAT) {
         this->_id = GLTFUtils::generateIDForType("parameter");
     }
 
-    GLTFAnimation::Parameter::Parameter(std::string id) {
+    GLTFAnimation::Parameter::Parameter(std::string id) : _componentType(FLOAT) {
         this->_id = id;
     }
     
@@ -84,6 +84,27 @@ namespace GLTF
     void GLTFAnimation::Parameter::setCount(size_t count) {
         this->_count = count;
     }
+    
+    void GLTFAnimation::Parameter::setComponentType(ComponentType componentType) {
+        this->_componentType = componentType;
+    }
+    
+    ComponentType GLTFAnimation::Parameter::getComponentType() {
+        return this->_componentType;
+    }
+    
+    void GLTFAnimation::Parameter::setDecodeTransform(const double *decodeOffset, const double *decodeScale, size_t componentsCount) {
+        this->_decodeOffset.assign(decodeOffset, decodeOffset + componentsCount);
+        this->_decodeScale.assign(decodeScale, decodeScale + componentsCount);
+    }
+    
+    const std::vector <double>& GLTFAnimation::Parameter::getDecodeOffset() {
+        return this->_decodeOffset;
+    }
+    
+    const std::vector <double>& GLTFAnimation::Parameter::getDecodeScale() {
+        return this->_decodeScale;
+    }
 
 
     //-- GLTFAnimation
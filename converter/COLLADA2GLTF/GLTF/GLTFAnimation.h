@@ -57,6 +57,18 @@ namespace GLTF
 
             size_t getByteOffset();
             void setByteOffset(size_t byteOffset);
+            
+            /*
+                Quantized parameters hold shorts read as normalized values in [-1, 1],
+                each component is then decoded as decodeOffset + (decodeScale * value).
+                Their type remains the one of the decoded values (FLOAT_VEC3...), the component type tells how they are stored.
+             */
+            void setComponentType(ComponentType componentType);
+            ComponentType getComponentType();
+            
+            void setDecodeTransform(const double *decodeOffset, const double *decodeScale, size_t componentsCount);
+            const std::vector <double>& getDecodeOffset();
+            const std::vector <double>& getDecodeScale();
         private:
             Parameter();
         private:
@@ -64,7 +76,10 @@ namespace GLTF
             std::string _type;
             size_t _byteOffset;
             size_t _count;
+            ComponentType _componentType;
             shared_ptr <GLTFBufferView> _bufferView;
+            std::vector <double> _decodeOffset;
+            std::vector <double> _decodeScale;
         };
         
         GLTFAnimation();
@@ -32,6 +32,18 @@ using namespace std;
 namespace GLTF 
 {        
 
+    size_t getIndexByteLength(ComponentType componentType)
+    {
+        switch (componentType) {
+            case UNSIGNED_BYTE:
+                return sizeof(unsigned char);
+            case UNSIGNED_INT:
+                return sizeof(unsigned int);
+            default:
+                return sizeof(unsigned short);
+        }
+    }
+    
     void GLTFIndices::_indicesCommonInit() 
     {
         this->_ID = GLTFUtils::generateIDForType("indices");
@@ -44,6 +56,7 @@ namespace GLTF
     GLTFIndices::GLTFIndices(shared_ptr <GLTFBufferView> bufferView,
                              size_t count):
     _count(count),
+    _componentType(UNSIGNED_SHORT),
     _byteOffset(0),
     _bufferView(bufferView)
     {
@@ -59,6 +72,21 @@ namespace GLTF
         return this->_ID;
     }
     
+    void GLTFIndices::setID(const std::string& ID)
+    {
+        this->_ID = ID;
+    }
+    
+    
+    ComponentType GLTFIndices::getComponentType()
+    {
+        return this->_componentType;
+    }
+    
+    void GLTFIndices::setComponentType(ComponentType componentType)
+    {
+        this->_componentType = componentType;
+    }
     
     size_t GLTFIndices::getCount()
     {
@@ -29,7 +29,9 @@
 
 namespace GLTF 
 {
-    //we should specify in indices the type. SHORT or BYTE
+    //size in bytes of an index serialized as componentType
+    size_t getIndexByteLength(ComponentType componentType);
+    
     class GLTFIndices {
     private:
         GLTFIndices();
@@ -48,9 +50,15 @@ namespace GLTF
         size_t getByteOffset();
         
         const std::string& getID();
+        void setID(const std::string& ID);
 
+        //type of the serialized indices (UNSIGNED_BYTE, UNSIGNED_SHORT or UNSIGNED_INT), indices are kept as unsigned int until they get written
+        ComponentType getComponentType();
+        void setComponentType(ComponentType componentType);
+        
     private:
         size_t _count;
+        ComponentType _componentType;
         size_t _byteOffset;
         shared_ptr <GLTFBufferView> _bufferView;
         std::string _ID;
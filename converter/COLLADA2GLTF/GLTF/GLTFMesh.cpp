@@ -33,7 +33,8 @@ using namespace std;
 
 namespace GLTF
 {
-    GLTFMesh::GLTFMesh()
+    GLTFMesh::GLTFMesh() :
+    _levelOfDetail(0)
     {
     }
     
@@ -47,6 +48,7 @@ namespace GLTF
         this->_semanticToMeshAttributes = mesh._semanticToMeshAttributes;
         this->_ID = mesh._ID;
         this->_name = mesh._name;
+        this->_levelOfDetail = mesh._levelOfDetail;
     }
     
     shared_ptr <MeshAttributeVector> GLTFMesh::meshAttributes()
@@ -130,8 +132,84 @@ namespace GLTF
     {
         return this->_primitives;
     }
+    
+    unsigned int GLTFMesh::getLevelOfDetail()
+    {
+        return this->_levelOfDetail;
+    }
+    
+    void GLTFMesh::setLevelOfDetail(unsigned int levelOfDetail)
+    {
+        this->_levelOfDetail = levelOfDetail;
+    }
         
-    bool GLTFMesh::writeAllBuffers(std::ofstream& verticesOutputStream, std::ofstream& indicesOutputStream)
+    template <typename T>
+    static void* __CreateTypedIndices(const unsigned int* indices, size_t indicesCount)
+    {
+        T* typedIndices = (T*)calloc(indicesCount, sizeof(T));
+        for (size_t i = 0 ; i < indicesCount ; i++) {
+            typedIndices[i] = (T)indices[i];
+        }
+        return typedIndices;
+    }
+    
+    //interleaved vertices are copied to the stream by chunks, instead of allocating the whole block
+    static const size_t kInterleavingChunkVerticesCount = 4096;
+    
+    /*
+        Writes the attributes vertex by vertex, each attribute being aligned on 4 bytes within a vertex, and sets their byteOffset and byteStride.
+        Returns false without writing anything if the attributes don't all have the same count of vertices.
+     */
+    static bool __WriteInterleavedMeshAttributes(MeshAttributeVector &meshAttributes, std::ostream& verticesOutputStream)
+    {
+        size_t attributesCount = meshAttributes.size();
+        if (attributesCount == 0)
+            return false;
+        
+        size_t verticesCount = meshAttributes[0]->getCount();
+        std::vector <size_t> offsetsInVertex(attributesCount);
+        std::vector <size_t> vertexAttributeByteLengths(attributesCount);
+        size_t byteStride = 0;
+        for (size_t j = 0 ; j < attributesCount ; j++) {
+            if ((meshAttributes[j]->getCount() != verticesCount) || !meshAttributes[j]->getBufferView())
+                return false;
+            vertexAttributeByteLengths[j] = meshAttributes[j]->getVertexAttributeByteLength();
+            offsetsInVertex[j] = byteStride;
+            byteStride += (vertexAttributeByteLengths[j] + 3) & ~(size_t)3;
+        }
+        
+        padStreamToAlignment(verticesOutputStream, sizeof(float));
+        size_t byteOffset = static_cast<size_t>(verticesOutputStream.tellp());
+        
+        std::vector <const unsigned char*> sourceData(attributesCount);
+        for (size_t j = 0 ; j < attributesCount ; j++) {
+            sourceData[j] = (const unsigned char*)meshAttributes[j]->getBufferView()->getBufferDataByApplyingOffset();
+        }
+        
+        unsigned char *chunk = (unsigned char*)calloc(kInterleavingChunkVerticesCount, byteStride);
+        for (size_t first = 0 ; first < verticesCount ; first += kInterleavingChunkVerticesCount) {
+            size_t chunkVerticesCount = std::min(kInterleavingChunkVerticesCount, verticesCount - first);
+            for (size_t j = 0 ; j < attributesCount ; j++) {
+                size_t sourceByteStride = meshAttributes[j]->getByteStride();
+                const unsigned char *source = sourceData[j] + (first * sourceByteStride);
+                unsigned char *target = chunk + offsetsInVertex[j];
+                for (size_t i = 0 ; i < chunkVerticesCount ; i++) {
+                    memcpy(target + (i * byteStride), source + (i * sourceByteStride), vertexAttributeByteLengths[j]);
+                }
+            }
+            verticesOutputStream.write((const char*)chunk, chunkVerticesCount * byteStride);
+        }
+        free(chunk);
+        
+        for (size_t j = 0 ; j < attributesCount ; j++) {
+            meshAttributes[j]->setByteOffset(byteOffset + offsetsInVertex[j]);
+            meshAttributes[j]->setByteStride(byteStride);
+        }
+        
+        return true;
+    }
+    
+    bool GLTFMesh::writeAllBuffers(std::ostream& verticesOutputStream, std::ostream& indicesOutputStream, bool interleaveAttributes)
     {
         typedef map<std::string , shared_ptr<GLTF::GLTFBuffer> > IDToBufferDef;
         IDToBufferDef IDToBuffer;
@@ -147,7 +225,7 @@ namespace GLTF
             shared_ptr <GLTF::GLTFIndices> uniqueIndices = primitive->getUniqueIndices();
             
             /*
-                Convert the indices to unsigned short and write the blob 
+                Convert the indices to their serialized type and write the blob
              */
             unsigned int indicesCount = (unsigned int)uniqueIndices->getCount();
             
@@ -159,19 +237,55 @@ namespace GLTF
             if (indicesCount <= 0) {
                 // FIXME: report error
             } else {
-                size_t indicesLength = sizeof(unsigned short) * indicesCount;
-                unsigned short* ushortIndices = (unsigned short*)calloc(indicesLength, 1);
-                for (unsigned int idx = 0 ; idx < indicesCount ; idx++) {
-                    ushortIndices[idx] = (unsigned short)uniqueIndicesBuffer[idx];
+                size_t indexByteLength = getIndexByteLength(uniqueIndices->getComponentType());
+                size_t indicesLength = indexByteLength * indicesCount;
+                void* typedIndices = 0;
+                
+                switch (uniqueIndices->getComponentType()) {
+                    case UNSIGNED_BYTE:
+                        typedIndices = __CreateTypedIndices<unsigned char>(uniqueIndicesBuffer, indicesCount);
+                        break;
+                    case UNSIGNED_INT:
+                        typedIndices = __CreateTypedIndices<unsigned int>(uniqueIndicesBuffer, indicesCount);
+                        break;
+                    default:
+                        typedIndices = __CreateTypedIndices<unsigned short>(uniqueIndicesBuffer, indicesCount);
+                        break;
                 }
-                    
+                
+                //primitives of different types share the stream, typed arrays can only be created at a multiple of their element size
+                padStreamToAlignment(indicesOutputStream, indexByteLength);
+                
                 uniqueIndices->setByteOffset(static_cast<size_t>(indicesOutputStream.tellp()));
-                indicesOutputStream.write((const char*)ushortIndices, indicesLength);
+                indicesOutputStream.write((const char*)typedIndices, indicesLength);
                 
                 //now that we wrote to the stream we can release the buffer.
                 uniqueIndices->setBufferView(dummyBuffer);
                 
-                free(ushortIndices);
+                free(typedIndices);
+            }
+        }
+        
+        //levels of detail share the attributes of their mesh, they are only written once
+        for (unsigned int j = 0 ; j < allMeshAttributes->size() ; ) {
+            shared_ptr <GLTFBufferView> bufferView = (*allMeshAttributes)[j]->getBufferView();
+            if (bufferView && !bufferView->getBuffer()) {
+                allMeshAttributes->erase(allMeshAttributes->begin() + j);
+            } else {
+                j++;
+            }
+        }
+        
+        if (interleaveAttributes) {
+            for (unsigned int j = 0 ; j < allMeshAttributes->size() ; j++) {
+                (*allMeshAttributes)[j]->computeMinMax();
+            }
+            if (__WriteInterleavedMeshAttributes(*allMeshAttributes, verticesOutputStream)) {
+                //now that we wrote to the stream we can release the buffers.
+                for (unsigned int j = 0 ; j < allMeshAttributes->size() ; j++) {
+                    (*allMeshAttributes)[j]->setBufferView(dummyBuffer);
+                }
+                return true;
             }
         }
         
@@ -190,6 +304,9 @@ namespace GLTF
                 // for this, add a type to buffers , and check this type in setBuffer , then call computeMinMax
                 meshAttribute->computeMinMax();
                 
+                //quantized attributes may not end on a 4 bytes boundary, float ones written after them have to
+                padStreamToAlignment(verticesOutputStream, sizeof(float));
+                
                 meshAttribute->setByteOffset(static_cast<size_t>(verticesOutputStream.tellp()));
                 verticesOutputStream.write((const char*)(buffer->getData()), buffer->getByteLength());
 
@@ -59,13 +59,19 @@ namespace GLTF
         void setName(std::string name);
         
         PrimitiveVector const getPrimitives();
+        
+        //0 for the mesh itself, then 1 for its first simplified level of detail, and so on
+        unsigned int getLevelOfDetail();
+        void setLevelOfDetail(unsigned int levelOfDetail);
 
-        bool writeAllBuffers(std::ofstream& verticesOutputStream, std::ofstream& indicesOutputStream);
+        //when interleaveAttributes is true, the attributes of the mesh are written as a single block with one vertex after the other
+        bool writeAllBuffers(std::ostream& verticesOutputStream, std::ostream& indicesOutputStream, bool interleaveAttributes = false);
         
     private:
         PrimitiveVector _primitives;
         SemanticToMeshAttributeHashmap _semanticToMeshAttributes;
         std::string _ID, _name;
+        unsigned int _levelOfDetail;
     };    
 
 }
@@ -25,6 +25,7 @@
 // THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "GLTF.h"
+#include "../helpers/boundsHelpers.h"
 
 using namespace rapidjson;
 using namespace std::tr1;
@@ -37,7 +38,7 @@ namespace GLTF
         this->_ID = GLTFUtils::generateIDForType("attribute");
     }
     
-    GLTFMeshAttribute::GLTFMeshAttribute(): _min(0), _max(0) 
+    GLTFMeshAttribute::GLTFMeshAttribute(): _min(0), _max(0), _normalized(false), _octahedralEncoding(false)
     {
         this->setComponentType(NOT_AN_ELEMENT_TYPE);
         this->setByteStride(0);
@@ -48,7 +49,12 @@ namespace GLTF
     }
         
     GLTFMeshAttribute::GLTFMeshAttribute(GLTFMeshAttribute* meshAttribute): 
-    _bufferView(meshAttribute->getBufferView()), _min(0), _max(0)
+    _bufferView(meshAttribute->getBufferView()), _min(0), _max(0),
+    _normalized(meshAttribute->getNormalized()),
+    _octahedralEncoding(meshAttribute->getOctahedralEncoding()),
+    _decodeOffset(meshAttribute->getDecodeOffset()),
+    _decodeScale(meshAttribute->getDecodeScale()),
+    _origin(meshAttribute->getOrigin())
     {
         assert(meshAttribute);
         
@@ -130,10 +136,61 @@ namespace GLTF
         this->_count = count;
     }
  
+    void GLTFMeshAttribute::setNormalized(bool normalized)
+    {
+        this->_normalized = normalized;
+    }
+    
+    bool GLTFMeshAttribute::getNormalized()
+    {
+        return this->_normalized;
+    }
+    
+    void GLTFMeshAttribute::setDecodeTransform(const double *decodeOffset, const double *decodeScale, size_t componentsCount)
+    {
+        this->_decodeOffset.assign(decodeOffset, decodeOffset + componentsCount);
+        this->_decodeScale.assign(decodeScale, decodeScale + componentsCount);
+    }
+    
+    const std::vector <double>& GLTFMeshAttribute::getDecodeOffset()
+    {
+        return this->_decodeOffset;
+    }
+    
+    const std::vector <double>& GLTFMeshAttribute::getDecodeScale()
+    {
+        return this->_decodeScale;
+    }
+    
+    void GLTFMeshAttribute::setOctahedralEncoding(bool octahedralEncoding)
+    {
+        this->_octahedralEncoding = octahedralEncoding;
+    }
+    
+    bool GLTFMeshAttribute::getOctahedralEncoding()
+    {
+        return this->_octahedralEncoding;
+    }
+    
+    void GLTFMeshAttribute::setOrigin(const double *origin, size_t componentsCount)
+    {
+        this->_origin.assign(origin, origin + componentsCount);
+    }
+    
+    const std::vector <double>& GLTFMeshAttribute::getOrigin()
+    {
+        return this->_origin;
+    }
+    
     const std::string& GLTFMeshAttribute::getID()
     {
         return this->_ID;
     }
+    
+    void GLTFMeshAttribute::setID(const std::string& ID)
+    {
+        this->_ID = ID;
+    }
         
     size_t GLTFMeshAttribute::getVertexAttributeByteLength()
     {
@@ -200,6 +257,28 @@ namespace GLTF
         }
     }
     
+    //bounds of integer attributes (quantized ones), float ones go through computeFloatBounds
+    class __MinMaxVisitor {
+    public:
+        __MinMaxVisitor(double *min, double *max) : _min(min), _max(max) {}
+        
+        template <typename T, size_t N>
+        void operator()(T (&vector)[N], size_t index)
+        {
+            for (size_t j = 0 ; j < N ; j++) {
+                double value = (double)vector[j];
+                if (value < this->_min[j])
+                    this->_min[j] = value;
+                if (value > this->_max[j])
+                    this->_max[j] = value;
+            }
+        }
+        
+    private:
+        double *_min;
+        double *_max;
+    };
+    
     void GLTFMeshAttribute::computeMinMax() 
     {
         //size_t byteStride = this->getByteStride();
@@ -224,6 +303,27 @@ namespace GLTF
             this->_max[i] = -DBL_MAX;
         }
         
+        //float vectors go through the SIMD kernels instead of one applier call per vertex
+        if ((this->getComponentType() == GLTF::FLOAT) && (componentsPerAttribute >= 1) && (componentsPerAttribute <= 4)) {
+            if (this->_count > 0) {
+                unsigned char* bufferData = (unsigned char*)this->getBufferView()->getBufferDataByApplyingOffset();
+                float min[4], max[4];
+                computeFloatBounds(bufferData, this->_count, componentsPerAttribute, this->getByteStride(), min, max);
+                for (size_t i = 0 ; i < componentsPerAttribute ; i++) {
+                    //only NaN values for this component, keep the bounds untouched like the applier does
+                    if (min[i] > max[i])
+                        continue;
+                    this->_min[i] = min[i];
+                    this->_max[i] = max[i];
+                }
+            }
+            return;
+        }
+        
+        __MinMaxVisitor minMaxVisitor(this->_min, this->_max);
+        if (this->visit(minMaxVisitor))
+            return;
+        
         apply(__ComputeMinMax, &minMaxApplierInfo);
     }
     
@@ -255,7 +355,8 @@ namespace GLTF
         //FIXME: simplified version 
         //FIXME: at the moment our ComponentType does not support Mat. We will probably have to add it for Skinning
         //OpenGL ES2.0 supports GL_FLOAT, GL_FLOAT_VEC2, GL_FLOAT_VEC3, GL_FLOAT_VEC4, GL_FLOAT_MAT2, GL_FLOAT_MAT3, or GL_FLOAT_MAT4
-        return GLTFUtils::getStringForGLType(this->_componentType) + "_VEC" + GLTFUtils::toString(this->_componentsPerAttribute);
+        //quantized attributes are typed after their decoded values, their component type tells how they are stored
+        return GLTFUtils::getStringForGLType(GLTF::FLOAT) + "_VEC" + GLTFUtils::toString(this->_componentsPerAttribute);
     }
 
 }
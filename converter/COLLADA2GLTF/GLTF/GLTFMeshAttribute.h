@@ -65,7 +65,7 @@ namespace GLTF
         void setComponentType(ComponentType type);
         ComponentType getComponentType();
         
-        //return a string that represents the GL Type,by taking into account componentType and componentsPerAttribute
+        //return a string that represents the GL Type of the decoded values, by taking into account componentsPerAttribute
         std::string getGLType();
         
         void setByteOffset(size_t offset);
@@ -74,9 +74,80 @@ namespace GLTF
         void setCount(size_t length);
         size_t getCount();
         
+        /*
+            Quantized attributes hold integers read as normalized values by WebGL (in [-1, 1] when signed, [0, 1] otherwise).
+            Each component is then decoded as decodeOffset + (decodeScale * value).
+            Octahedral attributes hold 2 components, decoded this way then unfolded from the octahedron into a unit vector.
+         */
+        void setNormalized(bool normalized);
+        bool getNormalized();
+        
+        void setDecodeTransform(const double *decodeOffset, const double *decodeScale, size_t componentsCount);
+        const std::vector <double>& getDecodeOffset();
+        const std::vector <double>& getDecodeScale();
+        
+        void setOctahedralEncoding(bool octahedralEncoding);
+        bool getOctahedralEncoding();
+        
+        /*
+            Recentered positions are stored relative to their origin, which is not written with the attribute.
+            Nodes instancing the mesh translate it back by this origin instead.
+         */
+        void setOrigin(const double *origin, size_t componentsCount);
+        const std::vector <double>& getOrigin();
+        
         void apply(GLTFMeshAttributeApplierFunc applierFunc, void* context);
         
+        /*
+            Calls visitor(T (&vector)[N], size_t index) for each vector of the attribute.
+            Unlike apply, the component type and count are known at compile time so the visitor can be inlined,
+            and packed attributes are walked as a contiguous array. T and N must match the layout of the attribute.
+         */
+        template <typename T, size_t N, class Visitor>
+        void forEach(Visitor &visitor)
+        {
+            assert((this->_componentsPerAttribute == N) && (this->getVertexAttributeByteLength() == sizeof(T) * N));
+            
+            unsigned char *bufferData = (unsigned char*)this->_bufferView->getBufferDataByApplyingOffset();
+            size_t count = this->_count;
+            if (this->_byteStride == sizeof(T) * N) {
+                T (*vectors)[N] = (T (*)[N])bufferData;
+                for (size_t i = 0 ; i < count ; i++) {
+                    visitor(vectors[i], i);
+                }
+            } else {
+                size_t byteStride = this->_byteStride;
+                for (size_t i = 0 ; i < count ; i++) {
+                    visitor(*(T (*)[N])(bufferData + (i * byteStride)), i);
+                }
+            }
+        }
+        
+        //calls forEach specialized for the layout of the attribute, returns false if there is none (more than 4 components)
+        template <class Visitor>
+        bool visit(Visitor &visitor)
+        {
+            switch (this->_componentType) {
+                case GLTF::BYTE:
+                    return this->_visitWithComponentType<signed char>(visitor);
+                case GLTF::UNSIGNED_BYTE:
+                    return this->_visitWithComponentType<unsigned char>(visitor);
+                case GLTF::SHORT:
+                    return this->_visitWithComponentType<short>(visitor);
+                case GLTF::UNSIGNED_SHORT:
+                    return this->_visitWithComponentType<unsigned short>(visitor);
+                case GLTF::FIXED:
+                    return this->_visitWithComponentType<int>(visitor);
+                case GLTF::FLOAT:
+                    return this->_visitWithComponentType<float>(visitor);
+                default:
+                    break;
+            }
+            return false;
+        }
+        
         const std::string& getID();
+        void setID(const std::string& ID);
         
         void computeMinMax();
         
@@ -86,6 +157,29 @@ namespace GLTF
         const double* getMax();
         
         bool matchesLayout(GLTFMeshAttribute* meshAttribute);
+        
+    private:
+        template <typename T, class Visitor>
+        bool _visitWithComponentType(Visitor &visitor)
+        {
+            switch (this->_componentsPerAttribute) {
+                case 1:
+                    this->forEach<T, 1>(visitor);
+                    return true;
+                case 2:
+                    this->forEach<T, 2>(visitor);
+                    return true;
+                case 3:
+                    this->forEach<T, 3>(visitor);
+                    return true;
+                case 4:
+                    this->forEach<T, 4>(visitor);
+                    return true;
+                default:
+                    break;
+            }
+            return false;
+        }
 
     private:
         shared_ptr <GLTFBufferView> _bufferView;
@@ -97,6 +191,11 @@ namespace GLTF
         std::string         _ID;
         double              *_min;
         double              *_max;
+        bool                _normalized;
+        bool                _octahedralEncoding;
+        std::vector <double> _decodeOffset;
+        std::vector <double> _decodeScale;
+        std::vector <double> _origin;
     };
 
 }
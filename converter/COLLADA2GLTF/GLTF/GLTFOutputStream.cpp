@@ -0,0 +1,196 @@
+// Copyright (c) 2012, Motorola Mobility, Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of the Motorola Mobility, Inc. nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "GLTF.h"
+
+using namespace std;
+
+namespace GLTF 
+{
+    //large enough to keep the segments count low, small enough not to waste memory for small assets
+    static const size_t kDefaultSegmentSize = 4 * 1024 * 1024;
+    
+    GLTFSegmentedStreamBuffer::GLTFSegmentedStreamBuffer(size_t segmentSize):
+    _segmentSize(segmentSize > 0 ? segmentSize : kDefaultSegmentSize)
+    {
+        this->setp(0, 0);
+    }
+    
+    GLTFSegmentedStreamBuffer::~GLTFSegmentedStreamBuffer()
+    {
+        this->releaseSegments();
+    }
+    
+    bool GLTFSegmentedStreamBuffer::_appendSegment()
+    {
+        char* segment = (char*)malloc(this->_segmentSize);
+        if (!segment) {
+            // FIXME: report error
+            return false;
+        }
+        this->_segments.push_back(segment);
+        this->setp(segment, segment + this->_segmentSize);
+        return true;
+    }
+    
+    size_t GLTFSegmentedStreamBuffer::length()
+    {
+        size_t segmentsCount = this->_segments.size();
+        if (segmentsCount == 0)
+            return 0;
+        //all segments but the last one are full
+        return ((segmentsCount - 1) * this->_segmentSize) + (this->pptr() - this->pbase());
+    }
+    
+    GLTFSegmentedStreamBuffer::int_type GLTFSegmentedStreamBuffer::overflow(int_type c)
+    {
+        if (traits_type::eq_int_type(c, traits_type::eof()))
+            return traits_type::not_eof(c);
+        
+        if (!this->_appendSegment())
+            return traits_type::eof();
+        
+        *this->pptr() = traits_type::to_char_type(c);
+        this->pbump(1);
+        return c;
+    }
+    
+    std::streamsize GLTFSegmentedStreamBuffer::xsputn(const char* s, std::streamsize n)
+    {
+        std::streamsize written = 0;
+        while (written < n) {
+            if (this->pptr() == this->epptr()) {
+                if (!this->_appendSegment())
+                    break;
+            }
+            std::streamsize available = this->epptr() - this->pptr();
+            std::streamsize chunk = (n - written) < available ? (n - written) : available;
+            memcpy(this->pptr(), s + written, (size_t)chunk);
+            //pbump takes an int, chunk is bounded by the segment size
+            this->pbump((int)chunk);
+            written += chunk;
+        }
+        return written;
+    }
+    
+    //only the query of the current position is supported, that's what tellp() relies on.
+    GLTFSegmentedStreamBuffer::pos_type GLTFSegmentedStreamBuffer::seekoff(off_type off, std::ios_base::seekdir way, std::ios_base::openmode which)
+    {
+        if ((off == 0) && (way == std::ios_base::cur) && (which & std::ios_base::out)) {
+            return pos_type(off_type(this->length()));
+        }
+        return pos_type(off_type(-1));
+    }
+    
+    bool GLTFSegmentedStreamBuffer::writeTo(std::ostream& outputStream)
+    {
+        size_t segmentsCount = this->_segments.size();
+        for (size_t i = 0 ; i < segmentsCount ; i++) {
+            size_t segmentLength = (i == segmentsCount - 1) ? (size_t)(this->pptr() - this->pbase()) : this->_segmentSize;
+            outputStream.write(this->_segments[i], segmentLength);
+            free(this->_segments[i]);
+            this->_segments[i] = 0;
+        }
+        this->_segments.clear();
+        this->setp(0, 0);
+        
+        return outputStream.good();
+    }
+    
+    bool GLTFSegmentedStreamBuffer::read(size_t offset, char* data, size_t length)
+    {
+        if (offset + length > this->length())
+            return false;
+        
+        while (length > 0) {
+            size_t segmentIndex = offset / this->_segmentSize;
+            size_t offsetInSegment = offset % this->_segmentSize;
+            size_t chunk = std::min(length, this->_segmentSize - offsetInSegment);
+            memcpy(data, this->_segments[segmentIndex] + offsetInSegment, chunk);
+            data += chunk;
+            offset += chunk;
+            length -= chunk;
+        }
+        return true;
+    }
+    
+    void GLTFSegmentedStreamBuffer::releaseSegments()
+    {
+        for (size_t i = 0 ; i < this->_segments.size() ; i++) {
+            free(this->_segments[i]);
+        }
+        this->_segments.clear();
+        this->setp(0, 0);
+    }
+    
+    //--- GLTFSegmentedOutputStream
+    
+    GLTFSegmentedOutputStream::GLTFSegmentedOutputStream():
+    std::ostream(0),
+    _streamBuffer(kDefaultSegmentSize)
+    {
+        this->rdbuf(&this->_streamBuffer);
+    }
+    
+    GLTFSegmentedOutputStream::GLTFSegmentedOutputStream(size_t segmentSize):
+    std::ostream(0),
+    _streamBuffer(segmentSize)
+    {
+        this->rdbuf(&this->_streamBuffer);
+    }
+    
+    GLTFSegmentedOutputStream::~GLTFSegmentedOutputStream()
+    {
+    }
+    
+    size_t GLTFSegmentedOutputStream::length()
+    {
+        return this->_streamBuffer.length();
+    }
+    
+    bool GLTFSegmentedOutputStream::writeTo(std::ostream& outputStream)
+    {
+        return this->_streamBuffer.writeTo(outputStream);
+    }
+    
+    bool GLTFSegmentedOutputStream::read(size_t offset, char* data, size_t length)
+    {
+        return this->_streamBuffer.read(offset, data, length);
+    }
+    
+    void GLTFSegmentedOutputStream::releaseSegments()
+    {
+        this->_streamBuffer.releaseSegments();
+    }
+    
+    void padStreamToAlignment(std::ostream& outputStream, size_t alignment)
+    {
+        static const char padding[8] = { 0 };
+        size_t remainder = static_cast<size_t>(outputStream.tellp()) % alignment;
+        if (remainder != 0)
+            outputStream.write(padding, alignment - remainder);
+    }
+}
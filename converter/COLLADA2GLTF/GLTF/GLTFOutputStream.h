@@ -0,0 +1,92 @@
+// Copyright (c) 2012, Motorola Mobility, Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of the Motorola Mobility, Inc. nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __GLTF_OUTPUTSTREAM_H__
+#define __GLTF_OUTPUTSTREAM_H__
+
+/*
+    GLTFSegmentedStreamBuffer keeps everything written to it in memory, in a list of fixed size segments.
+    Appending never moves bytes already written (unlike a growing contiguous buffer) and the content can be
+    forwarded to another stream segment by segment, releasing each one as soon as it has been copied.
+ 
+    GLTFSegmentedOutputStream is the std::ostream counterpart, it lets the code producing blobs keep using
+    write() / tellp() to record byte offsets, without going through a temporary file.
+ */
+
+namespace GLTF 
+{
+    class GLTFSegmentedStreamBuffer : public std::streambuf {
+    private:
+        GLTFSegmentedStreamBuffer(const GLTFSegmentedStreamBuffer&);
+        GLTFSegmentedStreamBuffer& operator=(const GLTFSegmentedStreamBuffer&);
+    public:
+        GLTFSegmentedStreamBuffer(size_t segmentSize);
+        virtual ~GLTFSegmentedStreamBuffer();
+        
+        size_t length();
+        bool writeTo(std::ostream& outputStream);
+        bool read(size_t offset, char* data, size_t length);
+        void releaseSegments();
+        
+    protected:
+        virtual int_type overflow(int_type c);
+        virtual std::streamsize xsputn(const char* s, std::streamsize n);
+        virtual pos_type seekoff(off_type off, std::ios_base::seekdir way, std::ios_base::openmode which);
+        
+    private:
+        bool _appendSegment();
+        
+    private:
+        size_t _segmentSize;
+        std::vector <char*> _segments;
+    };
+    
+    class GLTFSegmentedOutputStream : public std::ostream {
+    private:
+        GLTFSegmentedOutputStream(const GLTFSegmentedOutputStream&);
+        GLTFSegmentedOutputStream& operator=(const GLTFSegmentedOutputStream&);
+    public:
+        GLTFSegmentedOutputStream();
+        GLTFSegmentedOutputStream(size_t segmentSize);
+        virtual ~GLTFSegmentedOutputStream();
+        
+        size_t length();
+        
+        //copy the whole content to outputStream, segments are released as they are written
+        bool writeTo(std::ostream& outputStream);
+        //copy length bytes written at offset to data, returns false if they are not all in the stream
+        bool read(size_t offset, char* data, size_t length);
+        void releaseSegments();
+        
+    private:
+        GLTFSegmentedStreamBuffer _streamBuffer;
+    };
+    
+    //writes zeros until the position of outputStream is a multiple of alignment (at most 8)
+    void padStreamToAlignment(std::ostream& outputStream, size_t alignment);
+}
+
+#endif
@@ -26,7 +26,28 @@
 
 #include "GLTF.h"
 
+#ifdef WIN32
+#define GLTF_THREAD_LOCAL __declspec(thread)
+#else
+#define GLTF_THREAD_LOCAL __thread
+#endif
+
 namespace GLTF 
 {
-
+    static GLTF_THREAD_LOCAL unsigned int generatedIDCount = 1;
+    
+    unsigned int GLTFUtils::nextGeneratedIDCount()
+    {
+        return generatedIDCount++;
+    }
+    
+    unsigned int GLTFUtils::getGeneratedIDCount()
+    {
+        return generatedIDCount;
+    }
+    
+    void GLTFUtils::setGeneratedIDCount(unsigned int count)
+    {
+        generatedIDCount = count;
+    }
 }
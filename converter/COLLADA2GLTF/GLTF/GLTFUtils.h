@@ -56,14 +56,21 @@ namespace GLTF
             return true;
         }
         
+        /*
+            The IDs counter is per thread, so that the IDs generated by the loader thread don't depend on the scheduling of the geometry workers.
+            IDs generated on the workers are only unique within that thread, objects that get serialized are renamed when their mesh is committed.
+         */
+        static unsigned int nextGeneratedIDCount();
+        static unsigned int getGeneratedIDCount();
+        static void setGeneratedIDCount(unsigned int generatedIDCount);
+        
         static std::string generateIDForType(const char* typeCStr, const char* suffix = 0)
         {   
-            static unsigned int generatedIDCount = 1;
             char separator = '_';
             
             std::string type(typeCStr);
             type +=  separator; // FIXME: should probably not generate a "-" for a JSON output
-            type += GLTFUtils::toString(generatedIDCount++);
+            type += GLTFUtils::toString(GLTFUtils::nextGeneratedIDCount());
             if (suffix) {
                 type +=  separator;
                 type += suffix;
@@ -75,6 +82,8 @@ namespace GLTF
         static std::string getStringForGLType(int componentType)
         {
             switch (componentType) {
+                case GLTF::BYTE:
+                    return "BYTE";
                 case GLTF::UNSIGNED_BYTE:
                     return "UNSIGNED_BYTE";
                 case GLTF::SHORT:
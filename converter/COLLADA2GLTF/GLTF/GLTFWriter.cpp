@@ -121,6 +121,9 @@ namespace GLTF
         //meshAttributeObject->setUnsignedInt32("componentsPerAttribute", (unsigned int)meshAttribute->getComponentsPerAttribute());
         meshAttributeObject->setUnsignedInt32("count", (unsigned int)meshAttribute->getCount());
         meshAttributeObject->setString("type", meshAttribute->getGLType());
+        if (meshAttribute->getComponentType() != GLTF::FLOAT) {
+            meshAttributeObject->setString("componentType", GLTFUtils::getStringForGLType(meshAttribute->getComponentType()));
+        }
         
         void** buffers = (void**)context;
         GLTFBufferView *bufferView = context ? (GLTFBufferView*)buffers[0] : meshAttribute->getBufferView().get();
@@ -145,6 +148,30 @@ namespace GLTF
             }
         }
         
+        if (meshAttribute->getNormalized()) {
+            meshAttributeObject->setBool("normalized", true);
+        }
+        
+        const std::vector <double>& decodeOffset = meshAttribute->getDecodeOffset();
+        const std::vector <double>& decodeScale = meshAttribute->getDecodeScale();
+        if ((decodeScale.size() > 0) || meshAttribute->getOctahedralEncoding()) {
+            shared_ptr <GLTF::JSONObject> decodeObject(new GLTF::JSONObject());
+            meshAttributeObject->setValue("decode", decodeObject);
+            
+            if (meshAttribute->getOctahedralEncoding()) {
+                decodeObject->setString("encoding", "OCTAHEDRAL");
+            }
+            
+            shared_ptr <GLTF::JSONArray> offsetArray(new GLTF::JSONArray());
+            shared_ptr <GLTF::JSONArray> scaleArray(new GLTF::JSONArray());
+            decodeObject->setValue("offset", offsetArray);
+            decodeObject->setValue("scale", scaleArray);
+            for (size_t i = 0 ; i < decodeScale.size() ; i++) {
+                offsetArray->appendValue(shared_ptr <GLTF::JSONNumber> (new GLTF::JSONNumber(decodeOffset[i])));
+                scaleArray->appendValue(shared_ptr <GLTF::JSONNumber> (new GLTF::JSONNumber(decodeScale[i])));
+            }
+        }
+        
         return meshAttributeObject;
     }
     
@@ -156,7 +183,7 @@ namespace GLTF
         
         GLTFBufferView *bufferView = context ? (GLTFBufferView*)buffers[1] : indices->getBufferView().get();
         
-        indicesObject->setString("type", GLTFUtils::getStringForGLType(GLTF::UNSIGNED_SHORT));
+        indicesObject->setString("type", GLTFUtils::getStringForGLType(indices->getComponentType()));
         indicesObject->setString("bufferView", bufferView->getID());
         indicesObject->setUnsignedInt32("byteOffset", (unsigned int)indices->getByteOffset());
         indicesObject->setUnsignedInt32("count", (unsigned int)indices->getCount());
@@ -225,9 +252,28 @@ namespace GLTF
         
         animationParameterObject->setString("bufferView", animationParameter->getBufferView()->getID());
         animationParameterObject->setString("type", animationParameter->getType());
+        if (animationParameter->getComponentType() != GLTF::FLOAT) {
+            animationParameterObject->setString("componentType", GLTFUtils::getStringForGLType(animationParameter->getComponentType()));
+        }
         animationParameterObject->setUnsignedInt32("byteOffset", animationParameter->getByteOffset());
         animationParameterObject->setUnsignedInt32("count", animationParameter->getCount());
         
+        const std::vector <double>& decodeOffset = animationParameter->getDecodeOffset();
+        const std::vector <double>& decodeScale = animationParameter->getDecodeScale();
+        if (decodeScale.size() > 0) {
+            shared_ptr <GLTF::JSONObject> decodeObject(new GLTF::JSONObject());
+            shared_ptr <GLTF::JSONArray> offsetArray(new GLTF::JSONArray());
+            shared_ptr <GLTF::JSONArray> scaleArray(new GLTF::JSONArray());
+            animationParameterObject->setBool("normalized", true);
+            animationParameterObject->setValue("decode", decodeObject);
+            decodeObject->setValue("offset", offsetArray);
+            decodeObject->setValue("scale", scaleArray);
+            for (size_t i = 0 ; i < decodeScale.size() ; i++) {
+                offsetArray->appendValue(shared_ptr <GLTF::JSONNumber> (new GLTF::JSONNumber(decodeOffset[i])));
+                scaleArray->appendValue(shared_ptr <GLTF::JSONNumber> (new GLTF::JSONNumber(decodeScale[i])));
+            }
+        }
+        
         return animationParameterObject;
     }
 
@@ -281,7 +327,7 @@ namespace GLTF
     {
         this->_writer->StartArray();
         
-        vector <shared_ptr <JSONValue> > values = array->values();
+        const vector <shared_ptr <JSONValue> >& values = array->values();
         size_t count = values.size();
         for (size_t i = 0 ; i < count ; i++) {
             values[i]->write(this, context);
@@ -362,5 +408,28 @@ namespace GLTF
                 break;
         }
     }
+    
+    //streaming
+    void GLTFWriter::startObject()
+    {
+        this->_writer->StartObject();
+    }
+    
+    void GLTFWriter::endObject()
+    {
+        this->_writer->EndObject();
+    }
+    
+    void GLTFWriter::writeKey(const std::string& key)
+    {
+        this->_writer->String(key.c_str());
+    }
+    
+    void GLTFWriter::writeMember(const std::string& key, JSONValue* value, void *context)
+    {
+        this->writeKey(key);
+        if (value)
+            value->write(this, context);
+    }
         
 }
@@ -58,6 +58,12 @@ namespace GLTF
         void writeNumber(JSONNumber* number, void *context);
         void writeString(JSONString* str, void *context);        
         void write(JSONValue* value, void *context);
+        
+        //streaming, writes a document member by member instead of walking a complete JSONObject
+        void startObject();
+        void endObject();
+        void writeKey(const std::string& key);
+        void writeMember(const std::string& key, JSONValue* value, void *context);
 
     private:
 
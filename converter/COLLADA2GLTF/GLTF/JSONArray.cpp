@@ -47,7 +47,7 @@ namespace GLTF
         writer->writeArray(this, context);
     }
     
-    vector <shared_ptr <JSONValue> > JSONArray::values()
+    const vector <shared_ptr <JSONValue> >& JSONArray::values()
     {
         return this->_values;
     }
@@ -36,37 +36,32 @@ namespace GLTF
     JSONValue(GLTF::NUMBER),
     _type(UNSIGNED_INT32)        
     {
-        this->_value = malloc(sizeof(unsigned int));
-        memcpy(this->_value, &value, sizeof(unsigned int));
+        this->_value._unsignedInt32 = value;
     }
     
     JSONNumber::JSONNumber(int value):
     JSONValue(GLTF::NUMBER),
     _type(INT32)        
     {
-        this->_value = malloc(sizeof(int));
-        memcpy(this->_value, &value, sizeof(int));
+        this->_value._int32 = value;
     }
     
     JSONNumber::JSONNumber(double value):
     JSONValue(GLTF::NUMBER),
     _type(DOUBLE)        
     {
-        this->_value = malloc(sizeof(double));
-        memcpy(this->_value, &value, sizeof(double));
+        this->_value._double = value;
     }
 
     JSONNumber::JSONNumber(bool value):
     JSONValue(GLTF::NUMBER),
     _type(BOOL)        
     {
-        this->_value = malloc(sizeof(bool));
-        memcpy(this->_value, &value, sizeof(bool));
+        this->_value._bool = value;
     }
     
     JSONNumber::~JSONNumber() 
     {
-        free(this->_value);
     }
     
     void JSONNumber::write(GLTFWriter* writer, void* context)
@@ -77,28 +72,28 @@ namespace GLTF
     unsigned int JSONNumber::getUnsignedInt32() {
         unsigned int value = 0;
         if (this->_type == UNSIGNED_INT32)
-            memcpy(&value, this->_value, sizeof(unsigned int));
+            value = this->_value._unsignedInt32;
         return value;
     }        
     
     int JSONNumber::getInt32() {
         int value = 0;
         if (this->_type == INT32)
-            memcpy(&value, this->_value, sizeof(int));
+            value = this->_value._int32;
         return value;
     }        
     
     double JSONNumber::getDouble() {
         double value = 0;
         if (this->_type == DOUBLE)
-            memcpy(&value, this->_value, sizeof(double));
+            value = this->_value._double;
         return value;
     }      
 
     bool JSONNumber::getBool() {
         bool value = 0;
         if (this->_type == BOOL)
-            memcpy(&value, this->_value, sizeof(bool));
+            value = this->_value._bool;
         return value;
     }      
 
@@ -60,7 +60,13 @@ namespace GLTF
         JSONNumber::JSONNumberType getType();
 
     private:
-        void* _value;
+        //numbers are stored inline, a scene holds a lot of them (matrices, vectors, counts...)
+        union {
+            unsigned int _unsignedInt32;
+            int _int32;
+            double _double;
+            bool _bool;
+        } _value;
         JSONNumberType _type;
     };
 
@@ -46,6 +46,74 @@ namespace GLTF
     {
     }        
     
+    //objects with fewer members are searched linearly, most objects in a document only have a few
+    static const size_t kMinMembersCountForIndex = 16;
+    
+    //FNV-1a
+    static unsigned int __HashKey(const std::string &key)
+    {
+        unsigned int hash = 2166136261U;
+        size_t length = key.length();
+        for (size_t i = 0 ; i < length ; i++) {
+            hash ^= (unsigned char)key[i];
+            hash *= 16777619U;
+        }
+        return hash;
+    }
+    
+    //returns the count of members when the key is not found
+    size_t JSONObject::_indexOfMember(const std::string &key)
+    {
+        size_t membersCount = this->_members.size();
+        if (this->_index.empty()) {
+            for (size_t i = 0 ; i < membersCount ; i++) {
+                if (this->_members[i].first == key)
+                    return i;
+            }
+            return membersCount;
+        }
+        
+        size_t mask = this->_index.size() - 1;
+        size_t slot = __HashKey(key) & mask;
+        while (this->_index[slot] != 0) {
+            size_t memberIndex = this->_index[slot] - 1;
+            if (this->_members[memberIndex].first == key)
+                return memberIndex;
+            slot = (slot + 1) & mask;
+        }
+        return membersCount;
+    }
+    
+    //slots hold the index of the member + 1, 0 marks an empty slot
+    void JSONObject::_indexMember(size_t memberIndex)
+    {
+        size_t mask = this->_index.size() - 1;
+        size_t slot = __HashKey(this->_members[memberIndex].first) & mask;
+        while (this->_index[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        this->_index[slot] = (unsigned int)(memberIndex + 1);
+    }
+    
+    void JSONObject::_rebuildIndex()
+    {
+        size_t membersCount = this->_members.size();
+        if (membersCount < kMinMembersCountForIndex) {
+            this->_index.clear();
+            return;
+        }
+        
+        //keep the load factor under 1/2
+        size_t slotsCount = kMinMembersCountForIndex * 2;
+        while (slotsCount < membersCount * 4)
+            slotsCount *= 2;
+        
+        this->_index.assign(slotsCount, 0);
+        for (size_t i = 0 ; i < membersCount ; i++) {
+            this->_indexMember(i);
+        }
+    }
+    
     shared_ptr <GLTF::JSONObject> JSONObject::createObjectIfNeeded(const std::string& key) {
         shared_ptr <GLTF::JSONObject> outObject;
         if (!contains(key)) {
@@ -59,26 +127,80 @@ namespace GLTF
     
     void JSONObject::setValue(const std::string &key, shared_ptr <JSONValue> value)
     {
-        this->_keyToJSONValue[key] = value;
+        size_t memberIndex = this->_indexOfMember(key);
+        if (memberIndex < this->_members.size()) {
+            this->_members[memberIndex].second = value;
+            return;
+        }
+        
+        this->_members.push_back(JSONMember(key, value));
+        if (this->_index.empty() || (this->_members.size() * 2 > this->_index.size())) {
+            this->_rebuildIndex();
+        } else {
+            this->_indexMember(memberIndex);
+        }
+    }
+    
+    //returns the slot of the index referencing the member, the member must be indexed
+    size_t JSONObject::_slotOfMember(size_t memberIndex)
+    {
+        size_t mask = this->_index.size() - 1;
+        size_t slot = __HashKey(this->_members[memberIndex].first) & mask;
+        while (this->_index[slot] != (unsigned int)(memberIndex + 1)) {
+            slot = (slot + 1) & mask;
+        }
+        return slot;
     }
     
+    //empties the slot and shifts back the following entries of its cluster so that probing still finds them
+    void JSONObject::_unindexSlot(size_t slot)
+    {
+        size_t mask = this->_index.size() - 1;
+        size_t hole = slot;
+        size_t next = (hole + 1) & mask;
+        while (this->_index[next] != 0) {
+            size_t idealSlot = __HashKey(this->_members[this->_index[next] - 1].first) & mask;
+            if (((next - idealSlot) & mask) >= ((next - hole) & mask)) {
+                this->_index[hole] = this->_index[next];
+                hole = next;
+            }
+            next = (next + 1) & mask;
+        }
+        this->_index[hole] = 0;
+    }
+    
+    //members are written sorted by key, so the last member can take the place of the removed one
     void JSONObject::removeValue(const std::string &key)
     {
-        this->_keyToJSONValue.erase(key);
+        size_t memberIndex = this->_indexOfMember(key);
+        if (memberIndex >= this->_members.size())
+            return;
+        
+        size_t lastMemberIndex = this->_members.size() - 1;
+        
+        if (!this->_index.empty()) {
+            this->_unindexSlot(this->_slotOfMember(memberIndex));
+            if (memberIndex != lastMemberIndex)
+                this->_index[this->_slotOfMember(lastMemberIndex)] = (unsigned int)(memberIndex + 1);
+        }
+        if (memberIndex != lastMemberIndex)
+            this->_members[memberIndex] = this->_members[lastMemberIndex];
+        this->_members.pop_back();
     }
 
     
     shared_ptr <JSONValue> JSONObject::getValue(std::string key)
     {
-        return this->_keyToJSONValue[key];
+        size_t memberIndex = this->_indexOfMember(key);
+        if (memberIndex < this->_members.size())
+            return this->_members[memberIndex].second;
+        return shared_ptr <JSONValue> ();
     }
     
     shared_ptr <JSONObject> JSONObject::getObject(std::string key)
     {
-        shared_ptr <JSONValue> value = this->_keyToJSONValue[key];
-        return static_pointer_cast <JSONObject> (value);
+        return static_pointer_cast <JSONObject> (this->getValue(key));
     }
-
     void JSONObject::setUnsignedInt32(const std::string &key, unsigned int value)
     {
         this->setValue(key, shared_ptr <JSONNumber> (new JSONNumber((unsigned int)value)));
@@ -150,35 +272,33 @@ namespace GLTF
         return "";
     }
     
+    //keys are sorted, this is the order objects get written in
     vector <std::string> JSONObject::getAllKeys()
     {
         vector <std::string> allKeys;
-            
-        KeyToJSONValue::const_iterator KeyToJSONValueIterator;
         
-        for (KeyToJSONValueIterator = this->_keyToJSONValue.begin() ; KeyToJSONValueIterator != this->_keyToJSONValue.end() ; KeyToJSONValueIterator++) {
-                //(*it).first;             // the key value (of type Key)
-                //(*it).second;            // the mapped value (of type T)
-                //allKeys.push_back((*KeyToJSONValueIterator).first);
-                std::string key = (*KeyToJSONValueIterator).first;
-                allKeys.push_back(key);
+        size_t membersCount = this->_members.size();
+        allKeys.reserve(membersCount);
+        for (size_t i = 0 ; i < membersCount ; i++) {
+            allKeys.push_back(this->_members[i].first);
         }
+        std::sort(allKeys.begin(), allKeys.end());
         
         return allKeys;
     }
     
     bool JSONObject::contains(const std::string &key)
     {
-        return this->_keyToJSONValue.count(key) > 0;
+        return this->_indexOfMember(key) < this->_members.size();
     }
     
     bool JSONObject::isEmpty() 
     {
-        return this->_keyToJSONValue.empty();
+        return this->_members.empty();
     }
     
     size_t JSONObject::getKeysCount() {
-        return this->_keyToJSONValue.size();
+        return this->_members.size();
     }
 
 }
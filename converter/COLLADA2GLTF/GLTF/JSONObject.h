@@ -29,7 +29,8 @@
 
 namespace GLTF 
 {    
-    typedef std::map<std::string , shared_ptr <JSONValue> > KeyToJSONValue;
+    typedef std::pair<std::string , shared_ptr <JSONValue> > JSONMember;
+    typedef std::vector <JSONMember> JSONMemberVector;
     
     class JSONObject : public JSONValue {
     protected:
@@ -73,7 +74,16 @@ namespace GLTF
         bool isEmpty();
         
     private:
-        KeyToJSONValue _keyToJSONValue;
+        size_t _indexOfMember(const std::string &key);
+        void _indexMember(size_t memberIndex);
+        size_t _slotOfMember(size_t memberIndex);
+        void _unindexSlot(size_t slot);
+        void _rebuildIndex();
+        
+    private:
+        //members are kept in insertion order, except that removing one moves the last member in its place. Large objects (nodes, attributes...) also get a hash index to find them
+        JSONMemberVector _members;
+        std::vector <unsigned int> _index;
     };
 
 }
@@ -16,6 +16,7 @@ namespace GLTF
     typedef std::map<unsigned int /* openCOLLADA uniqueID from AnimationList*/, AnimatedTargetsSharedPtr > UniqueIDToAnimatedTargets;
     typedef std::map<std::string  , std::string > ImageIdToImagePath;
     typedef std::map<std::string , shared_ptr<JSONObject> > UniqueIDToTrackedObject;
+    typedef std::map<std::string , std::string > TechniqueHashToTechniqueID;
 
     //TODO: cleanup
     //For now, GLTFConverterContext is just struct, but it is growing and may become eventually a class
@@ -26,6 +27,31 @@ namespace GLTF
         bool invertTransparency;
         bool exportAnimations;
         bool exportPassDetails;
+        bool optimizeVertexCache;
+        unsigned int threadsCount;
+        bool streamJSON;
+        //16: meshes get split to fit unsigned short indices. 32: meshes are never split. In both cases each primitive gets the narrowest index type
+        unsigned int maxIndicesWidth;
+        //bits of quantized attributes, 0 keeps them as floats
+        unsigned int positionQuantizationBits;
+        unsigned int normalQuantizationBits;
+        unsigned int texcoordQuantizationBits;
+        bool interleaveAttributes;
+        //double precision positions are recentered around their centroid before being narrowed to floats, nodes instancing them are translated back by it
+        bool recenterDoublePositions;
+        //ratios of triangles (0 to 1, decreasing) of the levels of detail simplified from each mesh, none if empty
+        std::vector <double> levelsOfDetailRatios;
+        //bits of quantized animation outputs, 0 keeps them as floats
+        unsigned int animationQuantizationBits;
+        //animation keys that linear interpolation reproduces within these tolerances are dropped: distances for translations and scales, radians for rotations
+        bool reduceKeyframes;
+        double translationTolerance;
+        double rotationTolerance;
+        double scaleTolerance;
+        //writes the time and memory spent per phase next to the output, as .profile.json
+        bool profile;
+        //directory where generated techniques persist across conversions, their shaders are then named after their content. None if empty
+        std::string techniqueCacheDirectory;
         
         //TODO: add options here
         shared_ptr <GLTF::JSONObject> root;
@@ -38,6 +64,7 @@ namespace GLTF
         UniqueIDToAnimation _uniqueIDToAnimation;
         UniqueIDToAnimatedTargets _uniqueIDToAnimatedTargets;
         UniqueIDToTrackedObject _uniqueIDToTrackedObject;
+        TechniqueHashToTechniqueID _techniqueHashToTechniqueID;
 
     } GLTFConverterContext;
 
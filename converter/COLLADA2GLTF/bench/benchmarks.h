@@ -0,0 +1,60 @@
+// Copyright (c) Fabrice Robinet
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef __BENCHMARKS_H__
+#define __BENCHMARKS_H__
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+namespace GLTF
+{
+    //wall clock time in seconds
+    static inline double benchmarkTime()
+    {
+#ifdef WIN32
+        LARGE_INTEGER frequency, counter;
+        QueryPerformanceFrequency(&frequency);
+        QueryPerformanceCounter(&counter);
+        return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+        struct timeval tv;
+        gettimeofday(&tv, 0);
+        return (double)tv.tv_sec + ((double)tv.tv_usec * 1e-6);
+#endif
+    }
+    
+    //each benchmark returns false if the implementations being compared do not produce the same results
+    bool runWeldingBenchmark(size_t cornersCount);
+    bool runBoundsBenchmark(size_t verticesCount);
+    bool runDecompositionBenchmark(size_t keysCount);
+    
+    //times each phase of the geometry pipeline on synthetic meshes, up to the given scale, and writes the results as JSON to outputPath
+    bool runPipelineBenchmark(size_t maximumCornersCount, unsigned int maximumStreamsCount, const char *outputPath);
+}
+
+#endif
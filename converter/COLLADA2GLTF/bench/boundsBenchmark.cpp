@@ -0,0 +1,167 @@
+// Copyright (c) Fabrice Robinet
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+
+#include "GLTF.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <float.h>
+#include "../helpers/boundsHelpers.h"
+#include "benchmarks.h"
+
+using namespace std::tr1;
+using namespace std;
+
+namespace GLTF
+{
+    //Reference implementation: the applier GLTFMeshAttribute::computeMinMax used before the SIMD kernels, called once per vertex.
+    typedef struct {
+        double *min, *max;
+    } __ReferenceMinMaxApplierInfo;
+    
+    static void __ReferenceComputeMinMax(void *value,
+                                         ComponentType type,
+                                         size_t componentsPerAttribute,
+                                         size_t index,
+                                         size_t vertexAttributeByteSize,
+                                         void *context) {
+        __ReferenceMinMaxApplierInfo *applierInfo = (__ReferenceMinMaxApplierInfo*)context;
+        float* vector = (float*)value;
+        for (size_t j = 0 ; j < componentsPerAttribute ; j++) {
+            float value = vector[j];
+            if (value < applierInfo->min[j]) {
+                applierInfo->min[j] = value;
+            }
+            if (value > applierInfo->max[j]) {
+                applierInfo->max[j] = value;
+            }
+        }
+    }
+    
+    static const char* __BoundsKernelName(BoundsKernel kernel)
+    {
+        switch (kernel) {
+            case SSE_BOUNDS_KERNEL:
+                return "SSE";
+            case AVX2_BOUNDS_KERNEL:
+                return "AVX2";
+            default:
+                break;
+        }
+        return "scalar";
+    }
+    
+    static bool __CompareBounds(GLTFMeshAttribute *meshAttribute, const char *label)
+    {
+        size_t componentsPerAttribute = meshAttribute->getComponentsPerAttribute();
+        double referenceMin[4], referenceMax[4];
+        __ReferenceMinMaxApplierInfo applierInfo;
+        applierInfo.min = referenceMin;
+        applierInfo.max = referenceMax;
+        for (size_t j = 0 ; j < componentsPerAttribute ; j++) {
+            referenceMin[j] = DBL_MAX;
+            referenceMax[j] = -DBL_MAX;
+        }
+        
+        double start = benchmarkTime();
+        meshAttribute->apply(__ReferenceComputeMinMax, &applierInfo);
+        double referenceTime = benchmarkTime() - start;
+        
+        printf("[bounds] %s vertices:%d\n", label, (int)meshAttribute->getCount());
+        printf("[bounds]   applier per vertex: %.3fs\n", referenceTime);
+        
+        bool identical = true;
+        const unsigned char *data = (const unsigned char*)meshAttribute->getBufferView()->getBufferDataByApplyingOffset();
+        for (int kernel = SCALAR_BOUNDS_KERNEL ; kernel <= AVX2_BOUNDS_KERNEL ; kernel++) {
+            if (!isBoundsKernelSupported((BoundsKernel)kernel))
+                continue;
+            
+            float min[4], max[4];
+            start = benchmarkTime();
+            computeFloatBounds(data, meshAttribute->getCount(), componentsPerAttribute, meshAttribute->getByteStride(), min, max, (BoundsKernel)kernel);
+            double kernelTime = benchmarkTime() - start;
+            
+            bool kernelIdentical = true;
+            for (size_t j = 0 ; j < componentsPerAttribute ; j++) {
+                kernelIdentical &= (min[j] == referenceMin[j]) && (max[j] == referenceMax[j]);
+            }
+            identical &= kernelIdentical;
+            
+            printf("[bounds]   %s kernel: %.3fs (x%.2f)%s\n", __BoundsKernelName((BoundsKernel)kernel), kernelTime,
+                   kernelTime > 0 ? referenceTime / kernelTime : 0, kernelIdentical ? "" : " MISMATCH");
+        }
+        
+        //computeMinMax goes through the preferred kernel
+        start = benchmarkTime();
+        meshAttribute->computeMinMax();
+        double computeMinMaxTime = benchmarkTime() - start;
+        for (size_t j = 0 ; j < componentsPerAttribute ; j++) {
+            identical &= (meshAttribute->getMin()[j] == referenceMin[j]) && (meshAttribute->getMax()[j] == referenceMax[j]);
+        }
+        printf("[bounds]   computeMinMax (%s): %.3fs\n", __BoundsKernelName(getPreferredBoundsKernel()), computeMinMaxTime);
+        
+        if (!identical)
+            printf("ERROR: bounds differ\n");
+        
+        return identical;
+    }
+    
+    bool runBoundsBenchmark(size_t verticesCount)
+    {
+        //interleaved layout: position, normal and texcoord in 32 bytes
+        const size_t interleavedByteStride = 8 * sizeof(float);
+        size_t valuesCount = verticesCount * 8;
+        float *values = (float*)malloc(valuesCount * sizeof(float));
+        
+        //fixed seed LCG, with a NaN every 4099 values that every implementation must ignore
+        unsigned long long seed = 0x2545F4914F6CDD1DULL;
+        float nan = 0;
+        nan = nan / nan;
+        for (size_t i = 0 ; i < valuesCount ; i++) {
+            seed = (seed * 6364136223846793005ULL) + 1442695040888963407ULL;
+            values[i] = ((i % 4099) == 4098) ? nan : ((float)(seed >> 40) / (float)(1 << 24)) * 2000.f - 1000.f;
+        }
+        
+        shared_ptr <GLTFBufferView> bufferView = createBufferViewWithAllocatedBuffer(values, 0, valuesCount * sizeof(float), true);
+        
+        bool succeeded = true;
+        for (size_t componentsPerAttribute = 1 ; componentsPerAttribute <= 4 ; componentsPerAttribute++) {
+            GLTFMeshAttribute meshAttribute;
+            meshAttribute.setBufferView(bufferView);
+            meshAttribute.setComponentType(GLTF::FLOAT);
+            meshAttribute.setComponentsPerAttribute(componentsPerAttribute);
+            meshAttribute.setCount(verticesCount);
+            
+            std::string components = "VEC" + GLTFUtils::toString(componentsPerAttribute);
+            
+            meshAttribute.setByteStride(componentsPerAttribute * sizeof(float));
+            succeeded &= __CompareBounds(&meshAttribute, (components + " packed").c_str());
+            
+            meshAttribute.setByteStride(interleavedByteStride);
+            succeeded &= __CompareBounds(&meshAttribute, (components + " interleaved").c_str());
+        }
+        
+        return succeeded;
+    }
+}
@@ -0,0 +1,336 @@
+// Copyright (c) Fabrice Robinet
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "GLTF.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "../helpers/decompositionHelpers.h"
+#include "benchmarks.h"
+
+using namespace std::tr1;
+using namespace std;
+
+namespace GLTF
+{
+    /*
+        Reference implementation: __DecomposeMatrices of the animation converter, called once per key.
+        It can't be linked without OpenCOLLADA, so its steps are mirrored here in double precision: the matrix is copied
+        and transposed, decomposed to an axis angle by way of a quaternion, then both keys are converted back to quaternions
+        to check the hemisphere and the current one converted again to an axis angle if it has to be flipped.
+     */
+    typedef struct {
+        double x, y, z, w;
+    } __ReferenceQuaternion;
+    
+    static void __ReferenceFromAngleAxis(double angle, const double *axis, __ReferenceQuaternion *quaternion)
+    {
+        double halfAngle = 0.5 * angle;
+        double s = sin(halfAngle);
+        quaternion->w = cos(halfAngle);
+        quaternion->x = s * axis[0];
+        quaternion->y = s * axis[1];
+        quaternion->z = s * axis[2];
+    }
+    
+    static void __ReferenceToAngleAxis(const __ReferenceQuaternion& quaternion, double *angle, double *axis)
+    {
+        double squaredLength = quaternion.x * quaternion.x + quaternion.y * quaternion.y + quaternion.z * quaternion.z;
+        if (squaredLength > 0) {
+            *angle = 2. * acos(quaternion.w);
+            double inverseLength = 1. / sqrt(squaredLength);
+            axis[0] = quaternion.x * inverseLength;
+            axis[1] = quaternion.y * inverseLength;
+            axis[2] = quaternion.z * inverseLength;
+        } else {
+            *angle = 0;
+            axis[0] = 1;
+            axis[1] = 0;
+            axis[2] = 0;
+        }
+    }
+    
+    static void __ReferenceFromRotationMatrix(double r[3][3], __ReferenceQuaternion *quaternion)
+    {
+        double trace = r[0][0] + r[1][1] + r[2][2];
+        if (trace > 0) {
+            double root = sqrt(trace + 1.);
+            quaternion->w = 0.5 * root;
+            root = 0.5 / root;
+            quaternion->x = (r[2][1] - r[1][2]) * root;
+            quaternion->y = (r[0][2] - r[2][0]) * root;
+            quaternion->z = (r[1][0] - r[0][1]) * root;
+        } else {
+            static const size_t next[3] = { 1, 2, 0 };
+            size_t i = 0;
+            if (r[1][1] > r[0][0])
+                i = 1;
+            if (r[2][2] > r[i][i])
+                i = 2;
+            size_t j = next[i];
+            size_t k = next[j];
+            double root = sqrt(r[i][i] - r[j][j] - r[k][k] + 1.);
+            double *components[3] = { &quaternion->x, &quaternion->y, &quaternion->z };
+            *components[i] = 0.5 * root;
+            root = 0.5 / root;
+            quaternion->w = (r[k][j] - r[j][k]) * root;
+            *components[j] = (r[j][i] + r[i][j]) * root;
+            *components[k] = (r[k][i] + r[i][k]) * root;
+        }
+    }
+    
+    static void __ReferenceDecomposeMatrix(const float *m, float *translation, float *rotation, float *scale)
+    {
+        double matrix[4][4], transposed[4][4];
+        for (size_t i = 0 ; i < 4 ; i++) {
+            for (size_t j = 0 ; j < 4 ; j++) {
+                matrix[i][j] = m[(i * 4) + j];
+            }
+        }
+        for (size_t i = 0 ; i < 4 ; i++) {
+            for (size_t j = 0 ; j < 4 ; j++) {
+                transposed[i][j] = matrix[j][i];
+            }
+        }
+        
+        double rows[3][3], scales[3];
+        for (size_t i = 0 ; i < 3 ; i++) {
+            translation[i] = (float)transposed[3][i];
+            for (size_t j = 0 ; j < 3 ; j++) {
+                rows[i][j] = transposed[i][j];
+            }
+            scales[i] = sqrt(rows[i][0] * rows[i][0] + rows[i][1] * rows[i][1] + rows[i][2] * rows[i][2]);
+            for (size_t j = 0 ; j < 3 ; j++) {
+                rows[i][j] /= scales[i];
+            }
+        }
+        double determinant = rows[0][0] * (rows[1][1] * rows[2][2] - rows[1][2] * rows[2][1]) +
+                             rows[0][1] * (rows[1][2] * rows[2][0] - rows[1][0] * rows[2][2]) +
+                             rows[0][2] * (rows[1][0] * rows[2][1] - rows[1][1] * rows[2][0]);
+        if (determinant < 0) {
+            for (size_t i = 0 ; i < 3 ; i++) {
+                scales[i] = -scales[i];
+                for (size_t j = 0 ; j < 3 ; j++) {
+                    rows[i][j] = -rows[i][j];
+                }
+            }
+        }
+        
+        double rotationMatrix[3][3];
+        for (size_t i = 0 ; i < 3 ; i++) {
+            for (size_t j = 0 ; j < 3 ; j++) {
+                rotationMatrix[i][j] = rows[j][i];
+            }
+        }
+        __ReferenceQuaternion quaternion;
+        __ReferenceFromRotationMatrix(rotationMatrix, &quaternion);
+        double angle, axis[3];
+        __ReferenceToAngleAxis(quaternion, &angle, axis);
+        
+        for (size_t i = 0 ; i < 3 ; i++) {
+            rotation[i] = (float)axis[i];
+            scale[i] = (float)scales[i];
+        }
+        rotation[3] = (float)angle;
+    }
+    
+    static void __ReferenceDecomposeMatrices(const float *matrices, size_t count, float *translations, float *rotations, float *scales)
+    {
+        float *previousRotation = 0;
+        for (size_t i = 0 ; i < count ; i++) {
+            float *rotation = rotations + (i * 4);
+            __ReferenceDecomposeMatrix(matrices + (i * 16), translations + (i * 3), rotation, scales + (i * 3));
+            
+            if (previousRotation) {
+                double axis1[3] = { previousRotation[0], previousRotation[1], previousRotation[2] };
+                double axis2[3] = { rotation[0], rotation[1], rotation[2] };
+                __ReferenceQuaternion key1, key2;
+                __ReferenceFromAngleAxis(previousRotation[3], axis1, &key1);
+                __ReferenceFromAngleAxis(rotation[3], axis2, &key2);
+                double cosHalfTheta = key1.x * key2.x + key1.y * key2.y + key1.z * key2.z + key1.w * key2.w;
+                if (cosHalfTheta < 0) {
+                    key2.x = -key2.x;
+                    key2.y = -key2.y;
+                    key2.z = -key2.z;
+                    key2.w = -key2.w;
+                    double angle;
+                    __ReferenceToAngleAxis(key2, &angle, axis2);
+                    rotation[0] = (float)axis2[0];
+                    rotation[1] = (float)axis2[1];
+                    rotation[2] = (float)axis2[2];
+                    rotation[3] = (float)angle;
+                    __ReferenceFromAngleAxis(rotation[3], axis2, &key2);
+                    cosHalfTheta = key1.x * key2.x + key1.y * key2.y + key1.z * key2.z + key1.w * key2.w;
+                    if (cosHalfTheta < 0) {
+                        rotation[3] += (float)(2 * 3.14159265359);
+                    }
+                }
+            }
+            previousRotation = rotation;
+        }
+    }
+    
+    static const char* __DecompositionKernelName(DecompositionKernel kernel)
+    {
+        return (kernel == SSE2_DECOMPOSITION_KERNEL) ? "SSE2" : "scalar";
+    }
+    
+    //angle between the rotations of two axis angles
+    static double __AxisAnglesDistance(const float *a, const float *b)
+    {
+        double qa[4], qb[4];
+        const float *axisAngles[2] = { a, b };
+        double *quaternions[2] = { qa, qb };
+        for (size_t i = 0 ; i < 2 ; i++) {
+            //axes are unit vectors within single precision only, an epsilon on the dot product is a large angle
+            double axisLength = sqrt((double)axisAngles[i][0] * axisAngles[i][0] + (double)axisAngles[i][1] * axisAngles[i][1] + (double)axisAngles[i][2] * axisAngles[i][2]);
+            double axis[3] = { axisAngles[i][0] / axisLength, axisAngles[i][1] / axisLength, axisAngles[i][2] / axisLength };
+            __ReferenceQuaternion quaternion;
+            __ReferenceFromAngleAxis(axisAngles[i][3], axis, &quaternion);
+            quaternions[i][0] = quaternion.x;
+            quaternions[i][1] = quaternion.y;
+            quaternions[i][2] = quaternion.z;
+            quaternions[i][3] = quaternion.w;
+        }
+        double cosHalfAngle = fabs(qa[0] * qb[0] + qa[1] * qb[1] + qa[2] * qb[2] + qa[3] * qb[3]);
+        return 2. * acos(std::min(cosHalfAngle, 1.));
+    }
+    
+    /*
+        Synthetic baked skeletal animation: bones rotating around a slowly drifting axis, with non uniform scales
+        and translations varying smoothly from key to key. One bone in 16 is mirrored, with a negative scale.
+     */
+    static void __GenerateMatrices(float *matrices, size_t count)
+    {
+        const size_t keysPerBone = 1000;
+        for (size_t i = 0 ; i < count ; i++) {
+            size_t bone = i / keysPerBone;
+            double time = (double)(i % keysPerBone) / 30.;
+            double axis[3] = { sin(time * 0.3 + bone), cos(time * 0.2 + bone * 0.7), 0.5 + 0.3 * sin(time + bone) };
+            double axisLength = sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+            double angle = fmod(time * (1. + bone % 5), 2 * 3.14159265359);
+            double s = sin(angle), c = cos(angle), t = 1. - c;
+            double x = axis[0] / axisLength, y = axis[1] / axisLength, z = axis[2] / axisLength;
+            double r[3][3] = {
+                { t * x * x + c,     t * x * y - s * z, t * x * z + s * y },
+                { t * x * y + s * z, t * y * y + c,     t * y * z - s * x },
+                { t * x * z - s * y, t * y * z + s * x, t * z * z + c     }
+            };
+            double scale[3] = { 1. + 0.2 * sin(time), 1.5, 0.8 + 0.1 * cos(time * 2.) };
+            if ((bone % 16) == 15)
+                scale[0] = -scale[0];
+            double translation[3] = { sin(time) * 10., bone * 0.5, cos(time * 0.5) * 3. };
+            
+            float *m = matrices + (i * 16);
+            for (size_t row = 0 ; row < 3 ; row++) {
+                for (size_t column = 0 ; column < 3 ; column++) {
+                    m[(row * 4) + column] = (float)(r[row][column] * scale[column]);
+                }
+                m[(row * 4) + 3] = (float)translation[row];
+            }
+            m[12] = m[13] = m[14] = 0;
+            m[15] = 1;
+        }
+    }
+    
+    bool runDecompositionBenchmark(size_t keysCount)
+    {
+        float *matrices = (float*)malloc(keysCount * 16 * sizeof(float));
+        __GenerateMatrices(matrices, keysCount);
+        
+        float *referenceTranslations = (float*)malloc(keysCount * 3 * sizeof(float));
+        float *referenceRotations = (float*)malloc(keysCount * 4 * sizeof(float));
+        float *referenceScales = (float*)malloc(keysCount * 3 * sizeof(float));
+        float *translations = (float*)malloc(keysCount * 3 * sizeof(float));
+        float *rotations = (float*)malloc(keysCount * 4 * sizeof(float));
+        float *scales = (float*)malloc(keysCount * 3 * sizeof(float));
+        float *scalarRotations = (float*)malloc(keysCount * 4 * sizeof(float));
+        
+        double start = benchmarkTime();
+        __ReferenceDecomposeMatrices(matrices, keysCount, referenceTranslations, referenceRotations, referenceScales);
+        double referenceTime = benchmarkTime() - start;
+        
+        printf("[decomposition] keys:%d\n", (int)keysCount);
+        printf("[decomposition]   per key, axis angles: %.3fs\n", referenceTime);
+        
+        bool succeeded = true;
+        for (int kernel = SCALAR_DECOMPOSITION_KERNEL ; kernel <= SSE2_DECOMPOSITION_KERNEL ; kernel++) {
+            if (!isDecompositionKernelSupported((DecompositionKernel)kernel))
+                continue;
+            
+            start = benchmarkTime();
+            decomposeMatrices(matrices, keysCount, translations, rotations, scales, (DecompositionKernel)kernel);
+            double kernelTime = benchmarkTime() - start;
+            
+            //the short path is taken from every key to the next
+            bool continuous = true;
+            for (size_t i = 1 ; i < keysCount ; i++) {
+                const float *a = rotations + ((i - 1) * 4), *b = rotations + (i * 4);
+                continuous &= ((a[0] * b[0]) + (a[1] * b[1]) + (a[2] * b[2]) + (a[3] * b[3])) >= 0;
+            }
+            //kernels give the same results
+            bool identical = true;
+            if (kernel == SCALAR_DECOMPOSITION_KERNEL) {
+                memcpy(scalarRotations, rotations, keysCount * 4 * sizeof(float));
+            } else {
+                identical = memcmp(scalarRotations, rotations, keysCount * 4 * sizeof(float)) == 0;
+            }
+            
+            start = benchmarkTime();
+            quaternionsToAxisAngles(rotations, keysCount, rotations);
+            double conversionTime = benchmarkTime() - start;
+            
+            //and the same transforms as the reference, within single precision
+            double maxRotationError = 0, maxScaleError = 0;
+            bool sameTranslations = memcmp(referenceTranslations, translations, keysCount * 3 * sizeof(float)) == 0;
+            for (size_t i = 0 ; i < keysCount ; i++) {
+                maxRotationError = std::max(maxRotationError, __AxisAnglesDistance(referenceRotations + (i * 4), rotations + (i * 4)));
+                for (size_t j = 0 ; j < 3 ; j++) {
+                    maxScaleError = std::max(maxScaleError, (double)fabs(referenceScales[(i * 3) + j] - scales[(i * 3) + j]));
+                }
+            }
+            bool matches = continuous && identical && sameTranslations && (maxRotationError < 1e-5) && (maxScaleError < 1e-4);
+            succeeded &= matches;
+            
+            printf("[decomposition]   %s kernel, quaternions: %.3fs (x%.2f), to axis angles: %.3fs, max rotation error:%g rad, max scale error:%g%s\n",
+                   __DecompositionKernelName((DecompositionKernel)kernel), kernelTime,
+                   kernelTime > 0 ? referenceTime / kernelTime : 0, conversionTime,
+                   maxRotationError, maxScaleError, matches ? "" : " MISMATCH");
+        }
+        
+        if (!succeeded)
+            printf("ERROR: decompositions differ\n");
+        
+        free(matrices);
+        free(referenceTranslations);
+        free(referenceRotations);
+        free(referenceScales);
+        free(translations);
+        free(rotations);
+        free(scales);
+        free(scalarRotations);
+        
+        return succeeded;
+    }
+}
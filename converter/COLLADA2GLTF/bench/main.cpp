@@ -0,0 +1,57 @@
+// Copyright (c) Fabrice Robinet
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "GLTF.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include "benchmarks.h"
+
+int main (int argc, char * const argv[]) {
+    std::string benchmark = (argc > 1) ? argv[1] : "all";
+    bool succeeded = true;
+    
+    if ((benchmark == "all") || (benchmark == "welding")) {
+        size_t cornersCount = (argc > 2) ? (size_t)atol(argv[2]) : 10000000;
+        succeeded &= GLTF::runWeldingBenchmark(cornersCount);
+    }
+    
+    if ((benchmark == "all") || (benchmark == "bounds")) {
+        size_t verticesCount = (argc > 2) ? (size_t)atol(argv[2]) : 4000000;
+        succeeded &= GLTF::runBoundsBenchmark(verticesCount);
+    }
+    
+    if ((benchmark == "all") || (benchmark == "decomposition")) {
+        size_t keysCount = (argc > 2) ? (size_t)atol(argv[2]) : 1000000;
+        succeeded &= GLTF::runDecompositionBenchmark(keysCount);
+    }
+    
+    //collada2gltf_bench pipeline [maximum corners count] [maximum streams count] [output JSON path]
+    if ((benchmark == "all") || (benchmark == "pipeline")) {
+        size_t maximumCornersCount = (argc > 2) ? (size_t)atol(argv[2]) : 1000000;
+        unsigned int maximumStreamsCount = (argc > 3) ? (unsigned int)atoi(argv[3]) : 8;
+        succeeded &= GLTF::runPipelineBenchmark(maximumCornersCount, maximumStreamsCount, (argc > 4) ? argv[4] : "pipeline.json");
+    }
+    
+    return succeeded ? 0 : 1;
+}
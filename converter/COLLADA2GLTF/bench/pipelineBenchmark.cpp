@@ -0,0 +1,399 @@
+// Copyright (c) Fabrice Robinet
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+
+#include "GLTF.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include "../helpers/geometryHelpers.h"
+#include "benchmarks.h"
+
+using namespace std::tr1;
+using namespace std;
+
+namespace GLTF
+{
+    /*
+        Synthetic meshes for the geometry pipeline: a grid of quads given as a polylist, with up to 8 attribute streams indexed separately
+        as in COLLADA. Every stream but positions has seams (rows or columns where its index differs on each side) so that welding and
+        splitting have the same kind of work to do as with exported models.
+     */
+    #define PIPELINE_MAX_STREAMS_COUNT 8
+    
+    typedef struct {
+        Semantic semantic;
+        unsigned int indexSet;
+        size_t componentsPerAttribute;
+    } __PipelineStream;
+    
+    static const __PipelineStream kPipelineStreams[PIPELINE_MAX_STREAMS_COUNT] = {
+        { POSITION, 0, 3 },
+        { NORMAL, 0, 3 },
+        { TEXCOORD, 0, 2 },
+        { COLOR, 0, 4 },
+        { TEXCOORD, 1, 2 },
+        { TEXCOORD, 2, 2 },
+        { TEXCOORD, 3, 2 },
+        { TEXCOORD, 4, 2 }
+    };
+    
+    //scales run by the sweep, bounded by the maximum count of corners given on the command line
+    static const size_t kPipelineCornersCounts[] = { 1000, 10000, 100000, 1000000, 10000000, 50000000 };
+    static const unsigned int kPipelineStreamsCounts[] = { 1, 2, 4, 8 };
+    
+    //small scales are repeated until they run for about this many corners, times are averaged over the iterations
+    static const size_t kPipelineMinimumCornersPerPhase = 2000000;
+    
+    typedef struct {
+        size_t cornersCount;
+        unsigned int streamsCount;
+        size_t iterationsCount;
+        size_t verticesCount;
+        size_t meshesCount;
+        size_t writtenBytesCount;
+        double triangulationTime;
+        double planTriangulationTime;
+        double unificationTime;
+        double splitTime;
+        double minMaxTime;
+        double writeTime;
+    } __PipelineResult;
+    
+    typedef struct {
+        unsigned int streamsCount;
+        size_t polygonsCount;
+        unsigned int *verticesCount;
+        unsigned int *polylists[PIPELINE_MAX_STREAMS_COUNT];
+        size_t attributesCount;
+    } __Polylist;
+    
+    //quads of a square grid, the index of stream s is shifted by a whole grid on one side of its seams
+    static void __BuildPolylist(size_t cornersCount, unsigned int streamsCount, __Polylist *polylist)
+    {
+        size_t quadsCount = std::max(cornersCount / 6, (size_t)1);
+        size_t width = 1;
+        while (width * width < quadsCount)
+            width++;
+        size_t rowLength = width + 1;
+        size_t gridVerticesCount = rowLength * (((quadsCount + width - 1) / width) + 1);
+        
+        polylist->streamsCount = streamsCount;
+        polylist->polygonsCount = quadsCount;
+        polylist->attributesCount = gridVerticesCount * 2;
+        polylist->verticesCount = (unsigned int*)malloc(quadsCount * sizeof(unsigned int));
+        for (unsigned int s = 0 ; s < streamsCount ; s++) {
+            polylist->polylists[s] = (unsigned int*)malloc(quadsCount * 4 * sizeof(unsigned int));
+        }
+        
+        for (size_t q = 0 ; q < quadsCount ; q++) {
+            size_t x = q % width;
+            size_t y = q / width;
+            unsigned int a = (unsigned int)((y * rowLength) + x);
+            unsigned int quad[4] = { a, a + 1, (unsigned int)(a + rowLength + 1), (unsigned int)(a + rowLength) };
+            
+            polylist->verticesCount[q] = 4;
+            for (unsigned int s = 0 ; s < streamsCount ; s++) {
+                //odd streams have a seam every few rows, even ones every few columns, further apart as s grows
+                size_t period = (size_t)8 << (s / 2);
+                for (size_t k = 0 ; k < 4 ; k++) {
+                    unsigned int vertex = quad[k];
+                    size_t vertexRow = vertex / rowLength;
+                    size_t vertexColumn = vertex % rowLength;
+                    bool seam = (s & 1) ? (((vertexRow % period) == 0) && (vertexRow != y)) : (((vertexColumn % period) == 0) && (vertexColumn != x));
+                    polylist->polylists[s][(q * 4) + k] = ((s != 0) && seam) ? (unsigned int)(vertex + gridVerticesCount) : vertex;
+                }
+            }
+        }
+    }
+    
+    static void __FreePolylist(__Polylist *polylist)
+    {
+        free(polylist->verticesCount);
+        for (unsigned int s = 0 ; s < polylist->streamsCount ; s++) {
+            free(polylist->polylists[s]);
+        }
+    }
+    
+    static shared_ptr <GLTFMeshAttribute> __CreateMeshAttribute(size_t count, size_t componentsPerAttribute, unsigned int stream)
+    {
+        size_t valuesCount = count * componentsPerAttribute;
+        float *values = (float*)malloc(valuesCount * sizeof(float));
+        for (size_t i = 0 ; i < valuesCount ; i++) {
+            values[i] = (float)((i * (stream + 7)) % 1021) * 0.01f;
+        }
+        
+        shared_ptr <GLTFMeshAttribute> meshAttribute(new GLTFMeshAttribute());
+        meshAttribute->setBufferView(createBufferViewWithAllocatedBuffer(values, 0, valuesCount * sizeof(float), true));
+        meshAttribute->setComponentType(GLTF::FLOAT);
+        meshAttribute->setComponentsPerAttribute(componentsPerAttribute);
+        meshAttribute->setByteStride(componentsPerAttribute * sizeof(float));
+        meshAttribute->setCount(count);
+        return meshAttribute;
+    }
+    
+    //fan triangulation of a single index stream, as meshConverter used to do for each stream before TriangulationPlan, faces with less than 3 vertices are skipped
+    static unsigned int* __CreateTrianglesFromPolylist(unsigned int *verticesCount, unsigned int *polylist, unsigned int count, unsigned int *triangulatedIndicesCount)
+    {
+        unsigned int indicesCount = 0;
+        for (unsigned int i = 0 ; i < count ; i++) {
+            if (verticesCount[i] >= 3)
+                indicesCount += (verticesCount[i] - 2) * 3;
+        }
+        
+        if (triangulatedIndicesCount) {
+            *triangulatedIndicesCount = indicesCount;
+        }
+        
+        unsigned int *triangleIndices = (unsigned int*)malloc(sizeof(unsigned int) * indicesCount);
+        unsigned int offsetDestination = 0;
+        
+        for (unsigned int i = 0 ; i < count ; i++) {
+            if (verticesCount[i] >= 3) {
+                unsigned int trianglesCount = verticesCount[i] - 2;
+                unsigned int firstIndex = polylist[0];
+                unsigned int offsetSource = 1;
+                
+                for (unsigned k = 0 ; k < trianglesCount ; k++) {
+                    triangleIndices[offsetDestination] = firstIndex;
+                    triangleIndices[offsetDestination + 1] = polylist[offsetSource];
+                    triangleIndices[offsetDestination + 2] = polylist[offsetSource + 1];
+                    offsetSource += 1;
+                    offsetDestination += 3;
+                }
+            }
+            
+            polylist += verticesCount[i];
+        }
+        
+        return triangleIndices;
+    }
+    
+    static size_t __IterationsCount(size_t cornersCount)
+    {
+        return std::max(kPipelineMinimumCornersPerPhase / std::max(cornersCount, (size_t)1), (size_t)1);
+    }
+    
+    static void __RunPipeline(size_t cornersCount, unsigned int streamsCount, __PipelineResult *result)
+    {
+        __Polylist polylist;
+        __BuildPolylist(cornersCount, streamsCount, &polylist);
+        
+        size_t iterationsCount = __IterationsCount(cornersCount);
+        memset(result, 0, sizeof(__PipelineResult));
+        result->streamsCount = streamsCount;
+        result->iterationsCount = iterationsCount;
+        
+        //__CreateTrianglesFromPolylist once per stream, as meshConverter used to do
+        unsigned int *triangles[PIPELINE_MAX_STREAMS_COUNT];
+        unsigned int trianglesIndicesCount = 0;
+        for (size_t iteration = 0 ; iteration < iterationsCount ; iteration++) {
+            double start = benchmarkTime();
+            for (unsigned int s = 0 ; s < streamsCount ; s++) {
+                triangles[s] = __CreateTrianglesFromPolylist(polylist.verticesCount, polylist.polylists[s], (unsigned int)polylist.polygonsCount, &trianglesIndicesCount);
+            }
+            result->triangulationTime += benchmarkTime() - start;
+            for (unsigned int s = 0 ; s < streamsCount ; s++) {
+                free(triangles[s]);
+            }
+        }
+        
+        //a single plan gathering all the streams together, as meshConverter does
+        const unsigned int *polylists[PIPELINE_MAX_STREAMS_COUNT];
+        unsigned int initialIndices[PIPELINE_MAX_STREAMS_COUNT];
+        for (unsigned int s = 0 ; s < streamsCount ; s++) {
+            polylists[s] = polylist.polylists[s];
+            initialIndices[s] = 0;
+        }
+        for (size_t iteration = 0 ; iteration < iterationsCount ; iteration++) {
+            double start = benchmarkTime();
+            TriangulationPlan triangulationPlan(polylist.verticesCount, (unsigned int)polylist.polygonsCount);
+            for (unsigned int s = 0 ; s < streamsCount ; s++) {
+                triangles[s] = (unsigned int*)malloc(sizeof(unsigned int) * triangulationPlan.getIndicesCount());
+            }
+            triangulationPlan.gatherIndices(polylists, initialIndices, streamsCount, triangles);
+            result->planTriangulationTime += benchmarkTime() - start;
+            if (iteration + 1 < iterationsCount) {
+                for (unsigned int s = 0 ; s < streamsCount ; s++) {
+                    free(triangles[s]);
+                }
+            }
+        }
+        result->cornersCount = trianglesIndicesCount;
+        size_t attributesCount = polylist.attributesCount;
+        __FreePolylist(&polylist);
+        
+        shared_ptr <GLTFMesh> sourceMesh(new GLTFMesh());
+        sourceMesh->setID("bench");
+        shared_ptr <GLTFPrimitive> primitive(new GLTFPrimitive());
+        primitive->setType("TRIANGLES");
+        shared_ptr <IndicesVector> indicesVector(new IndicesVector());
+        for (unsigned int s = 0 ; s < streamsCount ; s++) {
+            const __PipelineStream& stream = kPipelineStreams[s];
+            IndexSetToMeshAttributeHashmap& meshAttributes = sourceMesh->getMeshAttributesForSemantic(stream.semantic);
+            meshAttributes[stream.indexSet] = __CreateMeshAttribute(attributesCount, stream.componentsPerAttribute, s);
+            
+            primitive->appendVertexAttribute(shared_ptr <JSONVertexAttribute>(new JSONVertexAttribute(stream.semantic, stream.indexSet)));
+            shared_ptr <GLTFBufferView> indicesBufferView = createBufferViewWithAllocatedBuffer(triangles[s], 0, trianglesIndicesCount * sizeof(unsigned int), true);
+            indicesVector->push_back(shared_ptr <GLTFIndices> (new GLTFIndices(indicesBufferView, trianglesIndicesCount)));
+        }
+        sourceMesh->appendPrimitive(primitive);
+        std::vector< shared_ptr<IndicesVector> > allPrimitiveIndicesVectors;
+        allPrimitiveIndicesVectors.push_back(indicesVector);
+        
+        //IDs are generated along the way, restore their count so that every iteration does the same work
+        unsigned int generatedIDCount = GLTFUtils::getGeneratedIDCount();
+        
+        shared_ptr <GLTFMesh> unifiedMesh;
+        for (size_t iteration = 0 ; iteration < iterationsCount ; iteration++) {
+            unifiedMesh.reset();
+            GLTFUtils::setGeneratedIDCount(generatedIDCount);
+            double start = benchmarkTime();
+            unifiedMesh = createUnifiedIndexesMeshFromMesh(sourceMesh.get(), allPrimitiveIndicesVectors);
+            result->unificationTime += benchmarkTime() - start;
+        }
+        result->verticesCount = unifiedMesh->getMeshAttributesForSemantic(POSITION)[0]->getCount();
+        
+        MeshVector meshes;
+        for (size_t iteration = 0 ; iteration < iterationsCount ; iteration++) {
+            meshes.clear();
+            double start = benchmarkTime();
+            if (!createMeshesWithMaximumIndicesCountFromMeshIfNeeded(unifiedMesh.get(), 65535, meshes))
+                meshes.push_back(unifiedMesh);
+            result->splitTime += benchmarkTime() - start;
+        }
+        result->meshesCount = meshes.size();
+        
+        for (size_t iteration = 0 ; iteration < iterationsCount ; iteration++) {
+            double start = benchmarkTime();
+            for (size_t i = 0 ; i < meshes.size() ; i++) {
+                shared_ptr <MeshAttributeVector> meshAttributes = meshes[i]->meshAttributes();
+                for (size_t j = 0 ; j < meshAttributes->size() ; j++) {
+                    (*meshAttributes)[j]->computeMinMax();
+                }
+            }
+            result->minMaxTime += benchmarkTime() - start;
+        }
+        
+        //writeAllBuffers releases the buffers it writes, further iterations need meshes built again
+        for (size_t iteration = 0 ; iteration < iterationsCount ; iteration++) {
+            if (iteration > 0) {
+                GLTFUtils::setGeneratedIDCount(generatedIDCount);
+                unifiedMesh = createUnifiedIndexesMeshFromMesh(sourceMesh.get(), allPrimitiveIndicesVectors);
+                meshes.clear();
+                if (!createMeshesWithMaximumIndicesCountFromMeshIfNeeded(unifiedMesh.get(), 65535, meshes))
+                    meshes.push_back(unifiedMesh);
+            }
+            GLTFSegmentedOutputStream verticesOutputStream;
+            GLTFSegmentedOutputStream indicesOutputStream;
+            double start = benchmarkTime();
+            for (size_t i = 0 ; i < meshes.size() ; i++) {
+                meshes[i]->writeAllBuffers(verticesOutputStream, indicesOutputStream);
+            }
+            result->writeTime += benchmarkTime() - start;
+            result->writtenBytesCount = verticesOutputStream.length() + indicesOutputStream.length();
+        }
+        
+        GLTFUtils::setGeneratedIDCount(generatedIDCount);
+        
+        result->triangulationTime /= iterationsCount;
+        result->planTriangulationTime /= iterationsCount;
+        result->unificationTime /= iterationsCount;
+        result->splitTime /= iterationsCount;
+        result->minMaxTime /= iterationsCount;
+        result->writeTime /= iterationsCount;
+    }
+    
+    static void __WritePipelinePhase(FILE *output, const char *name, double time, size_t cornersCount, bool last)
+    {
+        fprintf(output, "        \"%s\": { \"seconds\": %.6f, \"nsPerCorner\": %.3f }%s\n",
+                name, time, cornersCount > 0 ? (time * 1e9) / (double)cornersCount : 0, last ? "" : ",");
+    }
+    
+    static void __WritePipelineResult(FILE *output, const __PipelineResult& result, bool last)
+    {
+        fprintf(output, "    {\n");
+        fprintf(output, "      \"corners\": %lu,\n", (unsigned long)result.cornersCount);
+        fprintf(output, "      \"streams\": %u,\n", result.streamsCount);
+        fprintf(output, "      \"iterations\": %lu,\n", (unsigned long)result.iterationsCount);
+        fprintf(output, "      \"vertices\": %lu,\n", (unsigned long)result.verticesCount);
+        fprintf(output, "      \"meshes\": %lu,\n", (unsigned long)result.meshesCount);
+        fprintf(output, "      \"writtenBytes\": %lu,\n", (unsigned long)result.writtenBytesCount);
+        fprintf(output, "      \"phases\": {\n");
+        __WritePipelinePhase(output, "createTrianglesFromPolylist", result.triangulationTime, result.cornersCount, false);
+        __WritePipelinePhase(output, "TriangulationPlan", result.planTriangulationTime, result.cornersCount, false);
+        __WritePipelinePhase(output, "createUnifiedIndexesMeshFromMesh", result.unificationTime, result.cornersCount, false);
+        __WritePipelinePhase(output, "createMeshesWithMaximumIndicesCountFromMeshIfNeeded", result.splitTime, result.cornersCount, false);
+        __WritePipelinePhase(output, "computeMinMax", result.minMaxTime, result.cornersCount, false);
+        __WritePipelinePhase(output, "writeAllBuffers", result.writeTime, result.cornersCount, true);
+        fprintf(output, "      }\n");
+        fprintf(output, "    }%s\n", last ? "" : ",");
+    }
+    
+    bool runPipelineBenchmark(size_t maximumCornersCount, unsigned int maximumStreamsCount, const char *outputPath)
+    {
+        maximumStreamsCount = std::min(std::max(maximumStreamsCount, 1U), (unsigned int)PIPELINE_MAX_STREAMS_COUNT);
+        
+        std::vector <size_t> cornersCounts;
+        for (size_t i = 0 ; i < sizeof(kPipelineCornersCounts) / sizeof(size_t) ; i++) {
+            if (kPipelineCornersCounts[i] <= maximumCornersCount)
+                cornersCounts.push_back(kPipelineCornersCounts[i]);
+        }
+        if ((cornersCounts.size() == 0) || (cornersCounts.back() != maximumCornersCount))
+            cornersCounts.push_back(maximumCornersCount);
+        
+        std::vector <unsigned int> streamsCounts;
+        for (size_t i = 0 ; i < sizeof(kPipelineStreamsCounts) / sizeof(unsigned int) ; i++) {
+            if (kPipelineStreamsCounts[i] <= maximumStreamsCount)
+                streamsCounts.push_back(kPipelineStreamsCounts[i]);
+        }
+        if (streamsCounts.back() != maximumStreamsCount)
+            streamsCounts.push_back(maximumStreamsCount);
+        
+        //the helpers log to stdout, results go to their own file so that they can be parsed
+        FILE *output = fopen(outputPath, "w");
+        if (!output) {
+            printf("WARNING: cannot open %s for writing\n", outputPath);
+            return false;
+        }
+        
+        fprintf(output, "{\n");
+        fprintf(output, "  \"benchmark\": \"pipeline\",\n");
+        fprintf(output, "  \"results\": [\n");
+        for (size_t i = 0 ; i < cornersCounts.size() ; i++) {
+            for (size_t j = 0 ; j < streamsCounts.size() ; j++) {
+                __PipelineResult result;
+                __RunPipeline(cornersCounts[i], streamsCounts[j], &result);
+                __WritePipelineResult(output, result, (i + 1 == cornersCounts.size()) && (j + 1 == streamsCounts.size()));
+                fflush(output);
+            }
+        }
+        fprintf(output, "  ]\n");
+        fprintf(output, "}\n");
+        
+        fclose(output);
+        printf("[pipeline] results written to %s\n", outputPath);
+        
+        return true;
+    }
+}
@@ -0,0 +1,235 @@
+// Copyright (c) Fabrice Robinet
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "GLTF.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include "../helpers/geometryHelpers.h"
+#include "benchmarks.h"
+
+using namespace std::tr1;
+using namespace std;
+
+namespace GLTF
+{
+    /*
+        Reference implementation: the welding as it was done before VertexWeldingTable.
+        One n-uplet (prefixed by its count) is kept per corner and hashed by summing its indices.
+     */
+    struct ReferenceRemappedMeshIndexesHash {
+        inline size_t operator()(unsigned int* remappedMeshIndexes) const
+        {
+            size_t hash = 0;
+            size_t count = (size_t)remappedMeshIndexes[0];
+            
+            for (size_t i = 0 ; i < count ; i++) {
+                hash += (size_t)remappedMeshIndexes[i + 1 /* skip count */];
+            }
+            
+            return hash;
+        }
+    };
+    
+    struct ReferenceRemappedMeshIndexesEq {
+        inline bool operator()(unsigned int* k1, unsigned int* k2) const {
+            size_t count = (size_t)k1[0];
+            
+            if (count != (size_t)k2[0])
+                return false;
+            
+            for (size_t i = 0 ; i < count ; i++) {
+                if (k1[i + 1] != k2[i + 1])
+                    return false;
+            }
+            
+            return true;
+        }
+    };
+    
+    typedef unordered_map<unsigned int* ,unsigned int, ReferenceRemappedMeshIndexesHash, ReferenceRemappedMeshIndexesEq> ReferenceRemappedMeshIndexesHashmap;
+    
+    static unsigned int __ReferenceWeld(unsigned int **streams, unsigned int streamsCount, size_t cornersCount, unsigned int *uniqueIndexes)
+    {
+        ReferenceRemappedMeshIndexesHashmap remappedMeshIndexesMap;
+        unsigned int* originalCountAndIndexes = (unsigned int*)calloc(cornersCount, (streamsCount + 1) * sizeof(unsigned int));
+        unsigned int currentIndex = 0;
+        
+        for (size_t k = 0 ; k < cornersCount ; k++) {
+            unsigned int* remappedIndex = &originalCountAndIndexes[k * (streamsCount + 1)];
+            remappedIndex[0] = streamsCount;
+            for (unsigned int i = 0 ; i < streamsCount ; i++) {
+                remappedIndex[1 + i] = streams[i][k];
+            }
+            
+            unsigned int index;
+            if (remappedMeshIndexesMap.count(remappedIndex) == 0) {
+                index = currentIndex++;
+                remappedMeshIndexesMap[remappedIndex] = index;
+            } else {
+                index = remappedMeshIndexesMap[remappedIndex];
+            }
+            uniqueIndexes[k] = index;
+        }
+        
+        free(originalCountAndIndexes);
+        
+        return currentIndex;
+    }
+    
+    static unsigned int __TableWeld(unsigned int **streams, unsigned int streamsCount, size_t cornersCount, unsigned int *uniqueIndexes)
+    {
+        VertexWeldingTable weldingTable(streamsCount, cornersCount / 4);
+        unsigned int remappedIndex[16];
+        
+        unsigned int prefetchedIndex[16];
+        
+        for (size_t k = 0 ; k < cornersCount ; k++) {
+            if (k + WELDING_PREFETCH_DISTANCE < cornersCount) {
+                for (unsigned int i = 0 ; i < streamsCount ; i++) {
+                    prefetchedIndex[i] = streams[i][k + WELDING_PREFETCH_DISTANCE];
+                }
+                weldingTable.prefetch(prefetchedIndex);
+            }
+            for (unsigned int i = 0 ; i < streamsCount ; i++) {
+                remappedIndex[i] = streams[i][k];
+            }
+            uniqueIndexes[k] = weldingTable.findOrInsert(remappedIndex, 0);
+        }
+        
+        return weldingTable.verticesCount();
+    }
+    
+    /*
+        Builds the index streams of a triangulated grid (positions, normals, texcoords), like a regular polylist would give.
+        Normals have a crease every 8 rows and texcoords a seam every 64 columns, so that welding has actual work to do.
+     */
+    static void __BuildGridStreams(size_t cornersCount, unsigned int **streams, size_t *actualCornersCount)
+    {
+        size_t quadsCount = cornersCount / 6;
+        size_t width = 1;
+        while (width * width < quadsCount)
+            width++;
+        size_t height = (quadsCount + width - 1) / width;
+        size_t rowLength = width + 1;
+        size_t gridVerticesCount = rowLength * (height + 1);
+        size_t corner = 0;
+        
+        for (size_t y = 0 ; y < height ; y++) {
+            for (size_t x = 0 ; x < width ; x++) {
+                if (corner + 6 > cornersCount)
+                    break;
+                unsigned int a = (unsigned int)((y * rowLength) + x);
+                unsigned int quad[6] = { a, a + 1, (unsigned int)(a + rowLength), a + 1, (unsigned int)(a + rowLength + 1), (unsigned int)(a + rowLength) };
+                for (size_t k = 0 ; k < 6 ; k++) {
+                    unsigned int vertex = quad[k];
+                    size_t vertexRow = vertex / rowLength;
+                    size_t vertexColumn = vertex % rowLength;
+                    streams[0][corner + k] = vertex;
+                    streams[1][corner + k] = ((vertexRow % 8) == 0 && (vertexRow != y)) ? (unsigned int)(vertex + gridVerticesCount) : vertex;
+                    streams[2][corner + k] = ((vertexColumn % 64) == 0 && (vertexColumn != x)) ? (unsigned int)(vertex + gridVerticesCount) : vertex;
+                }
+                corner += 6;
+            }
+        }
+        
+        *actualCornersCount = corner;
+    }
+    
+    //shuffles triangles with a fixed seed LCG, exporters seldom give triangles in a cache friendly order
+    static void __ShuffleTriangles(unsigned int **streams, unsigned int streamsCount, size_t cornersCount)
+    {
+        size_t trianglesCount = cornersCount / 3;
+        unsigned long long seed = 0x2545F4914F6CDD1DULL;
+        
+        for (size_t i = trianglesCount - 1 ; i > 0 ; i--) {
+            seed = (seed * 6364136223846793005ULL) + 1442695040888963407ULL;
+            size_t j = (size_t)((seed >> 33) % (i + 1));
+            for (unsigned int s = 0 ; s < streamsCount ; s++) {
+                for (size_t k = 0 ; k < 3 ; k++) {
+                    unsigned int tmp = streams[s][(i * 3) + k];
+                    streams[s][(i * 3) + k] = streams[s][(j * 3) + k];
+                    streams[s][(j * 3) + k] = tmp;
+                }
+            }
+        }
+    }
+    
+    static bool __CompareWelding(const char *label, unsigned int **streams, unsigned int streamsCount, size_t cornersCount)
+    {
+        unsigned int *referenceIndexes = (unsigned int*)malloc(cornersCount * sizeof(unsigned int));
+        unsigned int *tableIndexes = (unsigned int*)malloc(cornersCount * sizeof(unsigned int));
+        
+        double start = benchmarkTime();
+        unsigned int referenceVerticesCount = __ReferenceWeld(streams, streamsCount, cornersCount, referenceIndexes);
+        double referenceTime = benchmarkTime() - start;
+        
+        start = benchmarkTime();
+        unsigned int tableVerticesCount = __TableWeld(streams, streamsCount, cornersCount, tableIndexes);
+        double tableTime = benchmarkTime() - start;
+        
+        //both assign indices in order of first appearance, so results must be identical
+        bool identical = (referenceVerticesCount == tableVerticesCount) &&
+                         (memcmp(referenceIndexes, tableIndexes, cornersCount * sizeof(unsigned int)) == 0);
+        
+        printf("[welding] %s corners:%d vertices:%d\n", label, (int)cornersCount, (int)tableVerticesCount);
+        printf("[welding]   unordered_map + additive hash: %.3fs\n", referenceTime);
+        printf("[welding]   VertexWeldingTable: %.3fs (x%.2f)\n", tableTime, tableTime > 0 ? referenceTime / tableTime : 0);
+        if (!identical)
+            printf("ERROR: welding results differ\n");
+        
+        free(tableIndexes);
+        free(referenceIndexes);
+        
+        return identical;
+    }
+    
+    bool runWeldingBenchmark(size_t cornersCount)
+    {
+        const unsigned int streamsCount = 3;
+        unsigned int *streams[streamsCount];
+        for (unsigned int i = 0 ; i < streamsCount ; i++) {
+            streams[i] = (unsigned int*)malloc(cornersCount * sizeof(unsigned int));
+        }
+        
+        size_t actualCornersCount = 0;
+        __BuildGridStreams(cornersCount, streams, &actualCornersCount);
+        
+        bool succeeded = __CompareWelding("grid order", streams, streamsCount, actualCornersCount);
+        
+        __ShuffleTriangles(streams, streamsCount, actualCornersCount);
+        succeeded &= __CompareWelding("shuffled triangles", streams, streamsCount, actualCornersCount);
+        
+        //per corner normals, as some exporters write them: no sharing at all
+        for (size_t k = 0 ; k < actualCornersCount ; k++) {
+            streams[1][k] = (unsigned int)k;
+        }
+        succeeded &= __CompareWelding("per corner normals", streams, streamsCount, actualCornersCount);
+        
+        for (unsigned int i = 0 ; i < streamsCount ; i++) {
+            free(streams[i]);
+        }
+        
+        return succeeded;
+    }
+}
@@ -2,8 +2,11 @@
 #include "../GLTF-OpenCOLLADA.h"
 #include "../GLTFConverterContext.h"
 
+#include "../helpers/blobIndex.h"
 #include "animationConverter.h"
-#include "../helpers/mathHelpers.h"
+#include "../helpers/decompositionHelpers.h"
+#include "../helpers/keyframeHelpers.h"
+#include "../helpers/quantizationHelpers.h"
 
 namespace GLTF
 {
@@ -22,82 +25,22 @@ namespace GLTF
         shared_ptr <GLTF::GLTFBufferView> rotationBufferView = createBufferViewWithAllocatedBuffer(rotationData, 0, rotationBufferSize, true);
         shared_ptr <GLTF::GLTFBufferView> scaleBufferView = createBufferViewWithAllocatedBuffer(scaleData, 0, scaleBufferSize, true);
         
-        float *previousRotation = 0;
+        //quaternions are kept in the hemisphere of the previous key so that we export the short path from orientations
+        decomposeMatrices(matrices, count, translationData, rotationData, scaleData, getPreferredDecompositionKernel());
+        quaternionsToAxisAngles(rotationData, count, rotationData);
         
-        for (size_t i = 0 ; i < count ; i++) {
-            
-            float *m = matrices;
-            COLLADABU::Math::Matrix4 mat;
-            mat.setAllElements(m[0], m[1], m[2], m[3],
-                               m[4], m[5], m[6], m[7],
-                               m[8], m[9], m[10], m[11],
-                               m[12], m[13], m[14], m[15] );
-            
-            decomposeMatrix(mat, translationData, rotationData, scaleData);
-            
-            //make sure we export the short path from orientations
-            if (0 != previousRotation) {
-                COLLADABU::Math::Vector3 axis1(previousRotation[0], previousRotation[1], previousRotation[2]);
-                COLLADABU::Math::Vector3 axis2(rotationData[0], rotationData[1], rotationData[2]);
-                
-                COLLADABU::Math::Quaternion key1;
-                COLLADABU::Math::Quaternion key2;
-                
-                key1.fromAngleAxis(previousRotation[3], axis1);
-                key2.fromAngleAxis(rotationData[3], axis2);
-                
-                COLLADABU::Math::Real cosHalfTheta = key1.dot(key2);
-                if (cosHalfTheta < 0) {
-                    key2.x = -key2.x;
-                    key2.y = -key2.y;
-                    key2.z = -key2.z;
-                    key2.w = -key2.w;
-                    
-                    COLLADABU::Math::Real angle;
-                    key2.toAngleAxis(angle, axis2);
-                    rotationData[3] = angle;
-                    rotationData[0] = axis2.x;
-                    rotationData[1] = axis2.y;
-                    rotationData[2] = axis2.z;
-                    
-                    key2.fromAngleAxis(rotationData[3], axis2);
-                    
-                    //FIXME: this needs to be refined, we ensure continuity here, but assume in clockwise order
-                    cosHalfTheta = key1.dot(key2);
-                    if (cosHalfTheta < 0) {
-                        rotationData[3] += (2 * 3.14159265359);
-                        key2.fromAngleAxis(rotationData[3], axis2);
-                    }
-                }
-                
-            }
-            
-            previousRotation = rotationData;
-            translationData += 3;
-            rotationData += 4;
-            scaleData += 3;
-            matrices += 16;
-        }
-        /*
-         rotationData = (float*)rotationBufferView->getBufferDataByApplyingOffset();
-         for (size_t i = 0 ; i < count ; i++) {
-         printf("rotation at:%d %f %f %f %f\n",  i,
-         rotationData[0],rotationData[1],rotationData[2],rotationData[3]);
-         
-         rotationData += 4;
-         }
-         */
         TRSBufferViews.push_back(translationBufferView);
         TRSBufferViews.push_back(rotationBufferView);
         TRSBufferViews.push_back(scaleBufferView);
     }
     
     static std::string __SetupSamplerForParameter(shared_ptr <GLTFAnimation> cvtAnimation,
-                                                  GLTFAnimation::Parameter *parameter) {
+                                                  GLTFAnimation::Parameter *parameter,
+                                                  const std::string& inputID) {
         shared_ptr<JSONObject> sampler(new JSONObject());
         std::string name = parameter->getID();
         std::string samplerID = cvtAnimation->getSamplerIDForName(name);
-        sampler->setString("input", "TIME");           //FIXME:harcoded for now
+        sampler->setString("input", inputID);
         sampler->setString("interpolation", "LINEAR"); //FIXME:harcoded for now
         sampler->setString("output", name);
         cvtAnimation->samplers()->setValue(samplerID, sampler);
@@ -207,26 +150,135 @@ namespace GLTF
         cvtAnimation->channels()->appendValue(trChannel);
     }
 
+    /*
+        Parameters are written through a blob index: an array identical to one already written points to it.
+        Times are the usual case, the animations of a scene are mostly baked at the same rate over the same range.
+     */
+    static void __WriteAnimationParameter(GLTFAnimation::Parameter *parameter,
+                                          const void *data,
+                                          size_t byteLength,
+                                          BlobIndex &animationsBlobIndex) {
+        parameter->setByteOffset(animationsBlobIndex.append((const unsigned char*)data, byteLength, sizeof(float)));
+    }
+    
+    /*
+        Baked channels often hold long runs of constant or linearly interpolable keys.
+        Returns in keptKeys the keys needed to reproduce the channel within the tolerance set for its path, empty if all are needed.
+     */
+    static void __ReduceAnimationParameterKeys(shared_ptr <GLTFAnimation> cvtAnimation,
+                                               const std::string& parameterSID,
+                                               size_t componentsCount,
+                                               shared_ptr <GLTFBufferView> bufferView,
+                                               const GLTFConverterContext &converterContext,
+                                               std::vector <unsigned int> &keptKeys) {
+        keptKeys.clear();
+        GLTFAnimation::Parameter *timeParameter = cvtAnimation->getParameterNamed("TIME");
+        if (!converterContext.reduceKeyframes || !timeParameter || (cvtAnimation->getCount() < 2))
+            return;
+        
+        KeyframeMetric metric = DISTANCE_KEYFRAME_METRIC;
+        double tolerance = 0;
+        if (parameterSID == "translation") {
+            tolerance = converterContext.translationTolerance;
+        } else if (parameterSID == "rotation") {
+            metric = AXIS_ANGLE_KEYFRAME_METRIC;
+            tolerance = converterContext.rotationTolerance;
+        } else if (parameterSID == "scale") {
+            tolerance = converterContext.scaleTolerance;
+        } else {
+            return;
+        }
+        
+        //FIXME: we assume float here, might be double
+        const float *times = (const float*)timeParameter->getBufferView()->getBufferDataByApplyingOffset();
+        const float *values = (const float*)bufferView->getBufferDataByApplyingOffset();
+        reduceKeyframes(times, values, cvtAnimation->getCount(), componentsCount, metric, tolerance, keptKeys);
+        if (keptKeys.size() == cvtAnimation->getCount())
+            keptKeys.clear();
+    }
+    
+    /*
+        Outputs are written as floats, or as shorts spanning the range of each component in the channel when animations are quantized.
+        Quantized outputs keep their FLOAT type, and are written with a SHORT component type, normalized and with a decode transform.
+        Axis angles are quantized this way too, their axis and angle get the precision of the range they cover.
+     */
+    static void __WriteAnimationOutput(GLTFAnimation::Parameter *parameter,
+                                       const float *values,
+                                       size_t keysCount,
+                                       size_t componentsCount,
+                                       const GLTFConverterContext &converterContext,
+                                       BlobIndex &animationsBlobIndex) {
+        if (converterContext.animationQuantizationBits == 0) {
+            __WriteAnimationParameter(parameter, values, keysCount * componentsCount * sizeof(float), animationsBlobIndex);
+            return;
+        }
+        
+        short *quantizedValues = (short*)malloc(keysCount * componentsCount * sizeof(short));
+        double decodeOffset[4], decodeScale[4];
+        quantizeFloats(values, keysCount, componentsCount, converterContext.animationQuantizationBits, quantizedValues, decodeOffset, decodeScale);
+        
+        //the type stays the one of the decoded values
+        parameter->setComponentType(GLTF::SHORT);
+        parameter->setDecodeTransform(decodeOffset, decodeScale, componentsCount);
+        parameter->setByteOffset(animationsBlobIndex.append((const unsigned char*)quantizedValues, keysCount * componentsCount * sizeof(short), sizeof(short)));
+        free(quantizedValues);
+    }
+    
     /*
         Handles Parameter creation / addition / write
+        Parameters keeping all the keys are sampled by TIME, written along the first of them.
+        The others get their own time parameter, with the times of the keys they keep.
      */
     static void __SetupAndWriteAnimationParameter(shared_ptr <GLTFAnimation> cvtAnimation,
                                                   const std::string& parameterSID,
                                                   const std::string& parameterType,
                                                   shared_ptr <GLTFBufferView> bufferView,
-                                                  std::ofstream &animationsOutputStream) {
+                                                  BlobIndex &animationsBlobIndex,
+                                                  const GLTFConverterContext &converterContext,
+                                                  bool *timeWritten) {
+        size_t componentsCount = (parameterType == "FLOAT_VEC4") ? 4 : ((parameterType == "FLOAT_VEC3") ? 3 : 1);
+        std::vector <unsigned int> keptKeys;
+        __ReduceAnimationParameterKeys(cvtAnimation, parameterSID, componentsCount, bufferView, converterContext, keptKeys);
+        
         //setup
         shared_ptr <GLTFAnimation::Parameter> parameter(new GLTFAnimation::Parameter(parameterSID));
-        parameter->setCount(cvtAnimation->getCount());
         parameter->setType(parameterType);
-        __SetupSamplerForParameter(cvtAnimation, parameter.get());
         
+        if (keptKeys.size() == 0) {
+            GLTFAnimation::Parameter *timeParameter = cvtAnimation->getParameterNamed("TIME");
+            if (timeParameter && !*timeWritten) {
+                shared_ptr<GLTFBufferView> timeBufferView = timeParameter->getBufferView();
+                __WriteAnimationParameter(timeParameter, timeBufferView->getBufferDataByApplyingOffset(), timeBufferView->getByteLength(), animationsBlobIndex);
+                *timeWritten = true;
+            }
+            
+            parameter->setCount(cvtAnimation->getCount());
+            __SetupSamplerForParameter(cvtAnimation, parameter.get(), "TIME");
+            cvtAnimation->parameters()->push_back(parameter);
+            
+            //write
+            __WriteAnimationOutput(parameter.get(), (const float*)bufferView->getBufferDataByApplyingOffset(), cvtAnimation->getCount(), componentsCount, converterContext, animationsBlobIndex);
+            return;
+        }
+        
+        std::string timeParameterSID = "TIME_" + parameterSID;
+        shared_ptr <GLTFAnimation::Parameter> timeParameter(new GLTFAnimation::Parameter(timeParameterSID));
+        timeParameter->setType("FLOAT");
+        timeParameter->setCount(keptKeys.size());
+        parameter->setCount(keptKeys.size());
+        __SetupSamplerForParameter(cvtAnimation, parameter.get(), timeParameterSID);
+        cvtAnimation->parameters()->push_back(timeParameter);
         cvtAnimation->parameters()->push_back(parameter);
         
         //write
-        parameter->setByteOffset(static_cast<size_t>(animationsOutputStream.tellp()));
-        animationsOutputStream.write((const char*)( bufferView->getBufferDataByApplyingOffset()),
-                                     bufferView->getByteLength());
+        float *keptTimes = (float*)malloc(keptKeys.size() * sizeof(float));
+        float *keptValues = (float*)malloc(keptKeys.size() * componentsCount * sizeof(float));
+        gatherKeyframes((const float*)cvtAnimation->getParameterNamed("TIME")->getBufferView()->getBufferDataByApplyingOffset(), 1, keptKeys, keptTimes);
+        gatherKeyframes((const float*)bufferView->getBufferDataByApplyingOffset(), componentsCount, keptKeys, keptValues);
+        __WriteAnimationParameter(timeParameter.get(), keptTimes, keptKeys.size() * sizeof(float), animationsBlobIndex);
+        __WriteAnimationOutput(parameter.get(), keptValues, keptKeys.size(), componentsCount, converterContext, animationsBlobIndex);
+        free(keptTimes);
+        free(keptValues);
     }
     
     /*
@@ -238,7 +290,7 @@ namespace GLTF
     bool writeAnimation(shared_ptr <GLTFAnimation> cvtAnimation,
                         const COLLADAFW::AnimationList::AnimationClass animationClass,
                         AnimatedTargetsSharedPtr animatedTargets,
-                        std::ofstream &animationsOutputStream,
+                        BlobIndex &animationsBlobIndex,
                         GLTF::GLTFConverterContext &converterContext) {
         
         
@@ -248,18 +300,10 @@ namespace GLTF
         shared_ptr<JSONObject> samplers = cvtAnimation->samplers();
         shared_ptr<JSONArray> channels = cvtAnimation->channels();
         size_t keyCount = cvtAnimation->getCount();
-        GLTFAnimation::Parameter *timeParameter = cvtAnimation->getParameterNamed("TIME");
-        if (timeParameter) {
-            shared_ptr<GLTFBufferView> timeBufferView = timeParameter->getBufferView();
-            std::string name = "TIME";
-            std::string samplerID = cvtAnimation->getSamplerIDForName(name);
-            
-            timeParameter->setByteOffset(static_cast<size_t>(animationsOutputStream.tellp()));
-            animationsOutputStream.write((const char*)( timeBufferView->getBufferDataByApplyingOffset()),
-                                         timeBufferView->getByteLength());
-            
-            //printf("time bufferLength: %d\n",(int)timeBufferView->getByteLength());
-        }
+        //TIME is written along the first parameter sampled by it, OUTPUT is consumed by the first binding of the animation
+        bool timeWritten = false;
+        bool hasOutput = cvtAnimation->getParameterNamed("OUTPUT") != 0;
+        bool converted = false;
         
         switch (animationClass) {
             case COLLADAFW::AnimationList::TIME:
@@ -284,21 +328,27 @@ namespace GLTF
                                                       "translation",
                                                       "FLOAT_VEC3",
                                                       TRSBufferViews[0],
-                                                      animationsOutputStream);
+                                                      animationsBlobIndex,
+                                                      converterContext,
+                                                      &timeWritten);
                     
                     //Rotation
                     __SetupAndWriteAnimationParameter(cvtAnimation,
                                                       "rotation",
                                                       "FLOAT_VEC4",
                                                       TRSBufferViews[1],
-                                                      animationsOutputStream);
+                                                      animationsBlobIndex,
+                                                      converterContext,
+                                                      &timeWritten);
                     
                     //Scale
                     __SetupAndWriteAnimationParameter(cvtAnimation,
                                                       "scale",
                                                       "FLOAT_VEC3",
                                                       TRSBufferViews[2],
-                                                      animationsOutputStream);
+                                                      animationsBlobIndex,
+                                                      converterContext,
+                                                      &timeWritten);
                     
                     for (size_t animatedTargetIndex = 0 ; animatedTargetIndex < animatedTargets->size() ; animatedTargetIndex++) {
                         shared_ptr<JSONObject> animatedTarget = (*animatedTargets)[animatedTargetIndex];
@@ -315,7 +365,7 @@ namespace GLTF
                     printf("WARNING: cannot find intermediate parameter named OUTPUT\n");
                 }
             }
-                return true;
+                converted = true;
                 break;
             case COLLADAFW::AnimationList::POSITION_XYZ: {
                 GLTFAnimation::Parameter *parameter = cvtAnimation->getParameterNamed("OUTPUT");
@@ -326,7 +376,9 @@ namespace GLTF
                                                       "translation",
                                                       "FLOAT_VEC3",
                                                       bufferView,
-                                                      animationsOutputStream);
+                                                      animationsBlobIndex,
+                                                      converterContext,
+                                                      &timeWritten);
                     
                     for (size_t animatedTargetIndex = 0 ; animatedTargetIndex < animatedTargets->size() ; animatedTargetIndex++) {
                         shared_ptr<JSONObject> animatedTarget = (*animatedTargets)[animatedTargetIndex];
@@ -340,7 +392,7 @@ namespace GLTF
                 }
             }
                 
-                return true;
+                converted = true;
                 break;
             case COLLADAFW::AnimationList::ANGLE: {
                 GLTFAnimation::Parameter *parameter = cvtAnimation->getParameterNamed("OUTPUT");
@@ -367,7 +419,9 @@ namespace GLTF
                                                                   "rotation",
                                                                   "FLOAT_VEC4",
                                                                   adjustedBuffer,
-                                                                  animationsOutputStream);
+                                                                  animationsBlobIndex,
+                                                                  converterContext,
+                                                                  &timeWritten);
                                 
                                 __AddChannel(cvtAnimation, targetID, path);
                             }
@@ -376,7 +430,7 @@ namespace GLTF
                 }
                 cvtAnimation->removeParameterNamed("OUTPUT");
             }
-                return true;
+                converted = true;
                 break;
             case COLLADAFW::AnimationList::POSITION_X:
             case COLLADAFW::AnimationList::POSITION_Y:
@@ -394,7 +448,11 @@ namespace GLTF
                 break;
         }
         
-        return false;
+        //all the parameters got reduced and have their own times
+        if (hasOutput && !timeWritten)
+            cvtAnimation->removeParameterNamed("TIME");
+        
+        return converted;
     }
     
     shared_ptr <GLTFAnimation> convertOpenCOLLADAAnimationToGLTFAnimation(const COLLADAFW::Animation* animation)
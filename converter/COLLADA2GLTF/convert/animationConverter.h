@@ -10,7 +10,7 @@ namespace GLTF
     bool writeAnimation(shared_ptr <GLTFAnimation> cvtAnimation,
                         const COLLADAFW::AnimationList::AnimationClass animationClass,
                         AnimatedTargetsSharedPtr animatedTargets,
-                        std::ofstream &animationsOutputStream,
+                        BlobIndex &animationsBlobIndex,
                         GLTF::GLTFConverterContext &converterContext);
 }
 
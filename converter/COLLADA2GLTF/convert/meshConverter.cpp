@@ -5,10 +5,19 @@
 #include "meshConverter.h"
 #include "../helpers/mathHelpers.h"
 #include "../helpers/geometryHelpers.h"
+#include "../helpers/vertexCacheHelpers.h"
+#include "../helpers/quantizationHelpers.h"
+#include "../helpers/narrowingHelpers.h"
+#include "../helpers/simplificationHelpers.h"
+#include "../helpers/profiler.h"
 
 namespace GLTF
 {
-    static unsigned int ConvertOpenCOLLADAMeshVertexDataToGLTFMeshAttributes(const COLLADAFW::MeshVertexData &vertexData, GLTF::IndexSetToMeshAttributeHashmap &meshAttributes)
+    /*
+        Double sources are converted to floats while they are copied, straight from the OpenCOLLADA array.
+        When recenter is true, their centroid is subtracted in double precision first and kept as the origin of the attribute.
+     */
+    static unsigned int ConvertOpenCOLLADAMeshVertexDataToGLTFMeshAttributes(const COLLADAFW::MeshVertexData &vertexData, GLTF::IndexSetToMeshAttributeHashmap &meshAttributes, bool recenter)
     {
         // The following are OpenCOLLADA fmk issues preventing doing a totally generic processing of sources
         //1. "set"(s) other than texCoord don't have valid input infos
@@ -45,6 +54,9 @@ namespace GLTF
             elementsCount = length / size;
             unsigned char *sourceData = 0;
             size_t sourceSize = 0;
+            bool sourceIsDouble = false;
+            bool hasCentroid = false;
+            double centroid[4];
             
             GLTF::ComponentType componentType = GLTF::NOT_AN_ELEMENT_TYPE;
             switch (vertexData.getType()) {
@@ -60,17 +72,16 @@ namespace GLTF
                 }
                     break;
                 case COLLADAFW::MeshVertexData::DATA_TYPE_DOUBLE: {
-                    /*
-                     sourceType = DOUBLE;
-                     
-                     const DoubleArray& array = vertexData.getDoubleValues()[indexOfSet];
-                     const size_t count = array.getCount();
-                     sourceData = (void*)array.getData();
-                     sourceSize = count * sizeof(double);
-                     */
-                    // Warning if can't make "safe" conversion
-                }
+                    componentType = GLTF::FLOAT;
+                    stride = sizeof(float) * size;
+                    const COLLADAFW::DoubleArray* array = vertexData.getDoubleValues();
                     
+                    sourceData = (unsigned char*)array->getData() + byteOffset;
+                    sourceIsDouble = true;
+                    
+                    sourceSize = length * sizeof(float);
+                    byteOffset += length * sizeof(double);
+                }
                     break;
                 default:
                 case COLLADAFW::MeshVertexData::DATA_TYPE_UNKNOWN:
@@ -79,7 +90,26 @@ namespace GLTF
             }
             
             // FIXME: the source could be shared, store / retrieve it here
-            shared_ptr <GLTFBufferView> cvtBufferView = createBufferViewWithAllocatedBuffer(name, sourceData, 0, sourceSize, false);
+            // the conversion may complete on a worker thread once OpenCOLLADA released the mesh, so we keep our own copy
+            unsigned char *sourceDataCopy = 0;
+            if (sourceSize > 0) {
+                sourceDataCopy = (unsigned char*)malloc(sourceSize);
+                if (sourceIsDouble && (size >= 1) && (size <= 4)) {
+                    if (recenter) {
+                        computeDoublesCentroid((const double*)sourceData, elementsCount, size, centroid);
+                        hasCentroid = true;
+                    }
+                    narrowDoublesToFloats((const double*)sourceData, elementsCount, size, hasCentroid ? centroid : 0, (float*)sourceDataCopy);
+                } else if (sourceIsDouble) {
+                    const double *doubles = (const double*)sourceData;
+                    for (size_t i = 0 ; i < length ; i++) {
+                        ((float*)sourceDataCopy)[i] = (float)doubles[i];
+                    }
+                } else {
+                    memcpy(sourceDataCopy, sourceData, sourceSize);
+                }
+            }
+            shared_ptr <GLTFBufferView> cvtBufferView = createBufferViewWithAllocatedBuffer(name, sourceDataCopy, 0, sourceSize, true);
             shared_ptr <GLTFMeshAttribute> cvtMeshAttribute(new GLTFMeshAttribute());
             
             cvtMeshAttribute->setBufferView(cvtBufferView);
@@ -87,6 +117,9 @@ namespace GLTF
             cvtMeshAttribute->setByteStride(stride);
             cvtMeshAttribute->setComponentType(componentType);
             cvtMeshAttribute->setCount(elementsCount);
+            if (hasCentroid) {
+                cvtMeshAttribute->setOrigin(centroid, size);
+            }
             
             meshAttributes[(unsigned int)indexOfSet] = cvtMeshAttribute;
         }
@@ -100,55 +133,6 @@ namespace GLTF
         primitiveIndicesVector.push_back(indices);
     }
     
-    static void __HandleIndexList(unsigned int idx,
-                                  COLLADAFW::IndexList *indexList,
-                                  Semantic semantic,
-                                  bool shouldTriangulate,
-                                  unsigned int count,
-                                  unsigned int vcount,
-                                  unsigned int *verticesCountArray,
-                                  shared_ptr <GLTF::GLTFPrimitive> cvtPrimitive,
-                                  IndicesVector &primitiveIndicesVector
-                                  )
-    {
-        unsigned int triangulatedIndicesCount = 0;
-        bool ownData = false;
-        unsigned int *indices = indexList->getIndices().getData();
-        
-        if (shouldTriangulate) {
-            indices = createTrianglesFromPolylist(verticesCountArray, indices, vcount, &triangulatedIndicesCount);
-            count = triangulatedIndicesCount;
-            ownData = true;
-        }
-        
-        //Why is OpenCOLLADA doing this ? why adding an offset the indices ??
-        //We need to offset it backward here.
-        unsigned int initialIndex = indexList->getInitialIndex();
-        if (initialIndex != 0) {
-            unsigned int *bufferDestination = 0;
-            if (!ownData) {
-                bufferDestination = (unsigned int*)malloc(sizeof(unsigned int) * count);
-                ownData = true;
-            } else {
-                bufferDestination = indices;
-            }
-            for (size_t idx = 0 ; idx < count ; idx++) {
-                bufferDestination[idx] = indices[idx] - initialIndex;
-            }
-            indices = bufferDestination;
-        }
-        
-        shared_ptr <GLTF::GLTFBufferView> uvBuffer = createBufferViewWithAllocatedBuffer(indices, 0, count * sizeof(unsigned int), ownData);
-        
-        //FIXME: Looks like for texcoord indexSet begin at 1, this is out of the sync with the index used in ConvertOpenCOLLADAMeshVertexDataToGLTFMeshAttributes that begins at 0
-        //for now forced to 0, to be fixed for multi texturing.
-        
-        //unsigned int idx = (unsigned int)indexList->getSetIndex();
-        
-        shared_ptr <GLTFIndices> jsonIndices(new GLTFIndices(uvBuffer, count));
-        __AppendIndices(cvtPrimitive, primitiveIndicesVector, jsonIndices, semantic, idx);
-    }
-    
     static shared_ptr <GLTF::GLTFPrimitive> ConvertOpenCOLLADAMeshPrimitive(
                                                                             COLLADAFW::MeshPrimitive *openCOLLADAMeshPrimitive,
                                                                             IndicesVector &primitiveIndicesVector)
@@ -202,109 +186,105 @@ namespace GLTF
         //count of indices , it must be the same for all kind of indices
         size_t count = openCOLLADAMeshPrimitive->getPositionIndices().getCount();
         
-        //vertex
-        //IndexList &positionIndexList = openCOLLADAMeshPrimitive->getPositionIndices();
-        unsigned int *indices = openCOLLADAMeshPrimitive->getPositionIndices().getData();
-        unsigned int *verticesCountArray = 0;
-        unsigned int vcount = 0;   //count of elements in the array containing the count of indices per polygon & polylist.
-        
-        if (shouldTriangulate) {
-            unsigned int triangulatedIndicesCount = 0;
-            //We have to upcast to polygon to retrieve the array of vertexCount
-            //OpenCOLLADA use polylist as polygon.
-            COLLADAFW::Polygons *polygon = (COLLADAFW::Polygons*)openCOLLADAMeshPrimitive;
-            const COLLADAFW::Polygons::VertexCountArray& vertexCountArray = polygon->getGroupedVerticesVertexCountArray();
-            vcount = (unsigned int)vertexCountArray.getCount();
-            verticesCountArray = (unsigned int*)malloc(sizeof(unsigned int) * vcount);
-            for (size_t i = 0; i < vcount; i++) {
-                verticesCountArray[i] = polygon->getGroupedVerticesVertexCount(i);;
-            }
-            indices = createTrianglesFromPolylist(verticesCountArray, indices, vcount, &triangulatedIndicesCount);
-            count = triangulatedIndicesCount;
-        }
-        
-        shared_ptr <GLTFBufferView> positionBuffer = createBufferViewWithAllocatedBuffer(indices, 0, count * sizeof(unsigned int), shouldTriangulate ? true : false);
-        
-        shared_ptr <GLTF::GLTFIndices> positionIndices(new GLTF::GLTFIndices(positionBuffer,count));
+        //all the index streams of the primitive, in the order their vertex attributes are appended
+        std::vector <const unsigned int*> sources;
+        std::vector <unsigned int> initialIndices;
+        std::vector <GLTF::Semantic> semantics;
+        std::vector <unsigned int> indexSets;
         
-        __AppendIndices(cvtPrimitive, primitiveIndicesVector, positionIndices, POSITION, 0);
+        sources.push_back(openCOLLADAMeshPrimitive->getPositionIndices().getData());
+        initialIndices.push_back(0);
+        semantics.push_back(POSITION);
+        indexSets.push_back(0);
         
         if (openCOLLADAMeshPrimitive->hasNormalIndices()) {
-            unsigned int triangulatedIndicesCount = 0;
-            indices = openCOLLADAMeshPrimitive->getNormalIndices().getData();
-            if (shouldTriangulate) {
-                indices = createTrianglesFromPolylist(verticesCountArray, indices, vcount, &triangulatedIndicesCount);
-                count = triangulatedIndicesCount;
-            }
-            
-            shared_ptr <GLTF::GLTFBufferView> normalBuffer = createBufferViewWithAllocatedBuffer(indices, 0, count * sizeof(unsigned int), shouldTriangulate ? true : false);
-            shared_ptr <GLTF::GLTFIndices> normalIndices(new GLTF::GLTFIndices(normalBuffer,
-                                                                               count));
-            __AppendIndices(cvtPrimitive, primitiveIndicesVector, normalIndices, NORMAL, 0);
+            sources.push_back(openCOLLADAMeshPrimitive->getNormalIndices().getData());
+            initialIndices.push_back(0);
+            semantics.push_back(NORMAL);
+            indexSets.push_back(0);
         }
         
+        //Why is OpenCOLLADA doing this ? why adding an offset the indices ??
+        //We need to offset it backward here.
         if (openCOLLADAMeshPrimitive->hasColorIndices()) {
             COLLADAFW::IndexListArray& colorListArray = openCOLLADAMeshPrimitive->getColorIndicesArray();
             for (size_t i = 0 ; i < colorListArray.getCount() ; i++) {
                 COLLADAFW::IndexList* indexList = openCOLLADAMeshPrimitive->getColorIndices(i);
-                __HandleIndexList(i,
-                                  indexList,
-                                  GLTF::COLOR,
-                                  shouldTriangulate,
-                                  count,
-                                  vcount,
-                                  verticesCountArray,
-                                  cvtPrimitive,
-                                  primitiveIndicesVector);
+                sources.push_back(indexList->getIndices().getData());
+                initialIndices.push_back(indexList->getInitialIndex());
+                semantics.push_back(GLTF::COLOR);
+                indexSets.push_back((unsigned int)i);
             }
         }
         
+        //FIXME: Looks like for texcoord indexSet begin at 1, this is out of the sync with the index used in ConvertOpenCOLLADAMeshVertexDataToGLTFMeshAttributes that begins at 0
+        //for now the position in the array is used, to be fixed for multi texturing.
         if (openCOLLADAMeshPrimitive->hasUVCoordIndices()) {
             COLLADAFW::IndexListArray& uvListArray = openCOLLADAMeshPrimitive->getUVCoordIndicesArray();
             for (size_t i = 0 ; i < uvListArray.getCount() ; i++) {
                 COLLADAFW::IndexList* indexList = openCOLLADAMeshPrimitive->getUVCoordIndices(i);
-                __HandleIndexList(i,
-                                  indexList,
-                                  GLTF::TEXCOORD,
-                                  shouldTriangulate,
-                                  count,
-                                  vcount,
-                                  verticesCountArray,
-                                  cvtPrimitive,
-                                  primitiveIndicesVector);
+                sources.push_back(indexList->getIndices().getData());
+                initialIndices.push_back(indexList->getInitialIndex());
+                semantics.push_back(GLTF::TEXCOORD);
+                indexSets.push_back((unsigned int)i);
+            }
+        }
+        
+        size_t streamsCount = sources.size();
+        std::vector <unsigned int*> destinations(streamsCount);
+        
+        if (shouldTriangulate) {
+            //We have to upcast to polygon to retrieve the array of vertexCount
+            //OpenCOLLADA use polylist as polygon.
+            COLLADAFW::Polygons *polygon = (COLLADAFW::Polygons*)openCOLLADAMeshPrimitive;
+            const COLLADAFW::Polygons::VertexCountArray& vertexCountArray = polygon->getGroupedVerticesVertexCountArray();
+            unsigned int vcount = (unsigned int)vertexCountArray.getCount();   //count of elements in the array containing the count of indices per polygon & polylist.
+            std::vector <unsigned int> verticesCountArray(vcount);
+            for (size_t i = 0; i < vcount; i++) {
+                verticesCountArray[i] = polygon->getGroupedVerticesVertexCount(i);
+            }
+            
+            //the fan layout is the same for all the streams, it is computed once and all of them are gathered together
+            TriangulationPlan triangulationPlan(vcount ? &verticesCountArray[0] : 0, vcount);
+            count = triangulationPlan.getIndicesCount();
+            for (size_t s = 0 ; s < streamsCount ; s++) {
+                destinations[s] = (unsigned int*)malloc(sizeof(unsigned int) * count);
+            }
+            if (streamsCount > 0) {
+                triangulationPlan.gatherIndices(&sources[0], &initialIndices[0], streamsCount, &destinations[0]);
+            }
+        } else {
+            for (size_t s = 0 ; s < streamsCount ; s++) {
+                destinations[s] = (unsigned int*)malloc(sizeof(unsigned int) * count);
+                const unsigned int *source = sources[s];
+                unsigned int initialIndex = initialIndices[s];
+                for (size_t i = 0 ; i < count ; i++) {
+                    destinations[s][i] = source[i] - initialIndex;
+                }
             }
         }
         
-        if (verticesCountArray) {
-            free(verticesCountArray);
+        for (size_t s = 0 ; s < streamsCount ; s++) {
+            shared_ptr <GLTF::GLTFBufferView> indicesBuffer = createBufferViewWithAllocatedBuffer(destinations[s], 0, count * sizeof(unsigned int), true);
+            shared_ptr <GLTF::GLTFIndices> indices(new GLTF::GLTFIndices(indicesBuffer, count));
+            __AppendIndices(cvtPrimitive, primitiveIndicesVector, indices, semantics[s], indexSets[s]);
         }
         
         return cvtPrimitive;
     }
     
-    static void __InvertV(void *value,
-                          GLTF::ComponentType type,
-                          size_t componentsPerAttribute,
-                          size_t index,
-                          size_t vertexAttributeByteSize,
-                          void *context) {
-        char* bufferData = (char*)value;
-        
-        if (componentsPerAttribute > 1) {
-            switch (type) {
-                case GLTF::FLOAT: {
-                    float* vector = (float*)bufferData;
-                    vector[1] = (float) (1.0 - vector[1]);
-                }
-                    break;
-                default:
-                    break;
-            }
+    class __InvertVVisitor {
+    public:
+        template <size_t N>
+        void operator()(float (&vector)[N], size_t index)
+        {
+            vector[1] = (float) (1.0 - vector[1]);
         }
-    }
+    };
     
-    void convertOpenCOLLADAMesh(COLLADAFW::Mesh* openCOLLADAMesh,
-                                MeshVector &meshes)
+    shared_ptr <GLTFMesh> createSnapshotFromOpenCOLLADAMesh(COLLADAFW::Mesh* openCOLLADAMesh,
+                                                            std::vector< shared_ptr<IndicesVector> > &allPrimitiveIndicesVectors,
+                                                            const GLTF::GLTFConverterContext &converterContext)
     {
         shared_ptr <GLTF::GLTFMesh> cvtMesh(new GLTF::GLTFMesh());
         
@@ -314,8 +294,6 @@ namespace GLTF
         const COLLADAFW::MeshPrimitiveArray& primitives =  openCOLLADAMesh->getMeshPrimitives();
         size_t primitiveCount = primitives.getCount();
         
-        std::vector< shared_ptr<IndicesVector> > allPrimitiveIndicesVectors;
-        
         // get all primitives
         for (size_t i = 0 ; i < primitiveCount ; i++) {
             const COLLADAFW::MeshPrimitive::PrimitiveType primitiveType = primitives[i]->getPrimitiveType();
@@ -341,21 +319,25 @@ namespace GLTF
                 GLTF::Semantic semantic = vertexAttributes[k]->getSemantic();
                 GLTF::IndexSetToMeshAttributeHashmap& meshAttributes = cvtMesh->getMeshAttributesForSemantic(semantic);
                 
+                //sources are shared by all primitives, they only need to be copied once
+                if (meshAttributes.size() > 0)
+                    continue;
+                
                 switch (semantic) {
                     case GLTF::POSITION:
-                        ConvertOpenCOLLADAMeshVertexDataToGLTFMeshAttributes(openCOLLADAMesh->getPositions(), meshAttributes);
+                        ConvertOpenCOLLADAMeshVertexDataToGLTFMeshAttributes(openCOLLADAMesh->getPositions(), meshAttributes, converterContext.recenterDoublePositions);
                         break;
                         
                     case GLTF::NORMAL:
-                        ConvertOpenCOLLADAMeshVertexDataToGLTFMeshAttributes(openCOLLADAMesh->getNormals(), meshAttributes);
+                        ConvertOpenCOLLADAMeshVertexDataToGLTFMeshAttributes(openCOLLADAMesh->getNormals(), meshAttributes, false);
                         break;
                         
                     case GLTF::TEXCOORD:
-                        ConvertOpenCOLLADAMeshVertexDataToGLTFMeshAttributes(openCOLLADAMesh->getUVCoords(), meshAttributes);
+                        ConvertOpenCOLLADAMeshVertexDataToGLTFMeshAttributes(openCOLLADAMesh->getUVCoords(), meshAttributes, false);
                         break;
                         
                     case GLTF::COLOR:
-                        ConvertOpenCOLLADAMeshVertexDataToGLTFMeshAttributes(openCOLLADAMesh->getColors(), meshAttributes);
+                        ConvertOpenCOLLADAMeshVertexDataToGLTFMeshAttributes(openCOLLADAMesh->getColors(), meshAttributes, false);
                         break;
                         
                     default:
@@ -366,9 +348,31 @@ namespace GLTF
             }
         }
         
+        return cvtMesh;
+    }
+    
+    static void __AppendMeshWithinIndicesWidth(shared_ptr <GLTFMesh> mesh, MeshVector &meshes, const GLTF::GLTFConverterContext &converterContext)
+    {
+        size_t firstMeshIndex = meshes.size();
+        //32 bits indices can address any mesh, no need to split it
+        if ((converterContext.maxIndicesWidth == 32) || (createMeshesWithMaximumIndicesCountFromMeshIfNeeded(mesh.get(), 65535, meshes) == false)) {
+            meshes.push_back(mesh);
+        }
+        
+        //whatever the maximum width, each primitive gets the narrowest indices able to address its vertices
+        for (size_t i = firstMeshIndex ; i < meshes.size() ; i++) {
+            setNarrowestIndicesComponentTypes(meshes[i].get());
+        }
+    }
+    
+    void convertMeshSnapshot(GLTFMesh *snapshot,
+                             std::vector< shared_ptr<IndicesVector> > &allPrimitiveIndicesVectors,
+                             MeshVector &meshes,
+                             const GLTF::GLTFConverterContext &converterContext)
+    {
         //https://github.com/KhronosGroup/collada2json/issues/41
         //Goes through all texcoord and invert V
-        GLTF::IndexSetToMeshAttributeHashmap& texcoordMeshAttributes = cvtMesh->getMeshAttributesForSemantic(GLTF::TEXCOORD);
+        GLTF::IndexSetToMeshAttributeHashmap& texcoordMeshAttributes = snapshot->getMeshAttributesForSemantic(GLTF::TEXCOORD);
         GLTF::IndexSetToMeshAttributeHashmap::const_iterator meshAttributeIterator;
         
         //FIXME: consider turn this search into a method for mesh
@@ -377,17 +381,88 @@ namespace GLTF
             //(*it).second;            // the mapped value (of type T)
             shared_ptr <GLTF::GLTFMeshAttribute> meshAttribute = (*meshAttributeIterator).second;
             
-            meshAttribute->apply(__InvertV, NULL);
+            if (meshAttribute->getComponentType() != GLTF::FLOAT)
+                continue;
+            
+            __InvertVVisitor invertV;
+            switch (meshAttribute->getComponentsPerAttribute()) {
+                case 2:
+                    meshAttribute->forEach<float, 2>(invertV);
+                    break;
+                case 3:
+                    meshAttribute->forEach<float, 3>(invertV);
+                    break;
+                case 4:
+                    meshAttribute->forEach<float, 4>(invertV);
+                    break;
+                default:
+                    break;
+            }
         }
         
-        if (cvtMesh->getPrimitives().size() > 0) {
-            //After this point cvtMesh should be referenced anymore and will be deallocated
-            shared_ptr <GLTF::GLTFMesh> unifiedMesh = createUnifiedIndexesMeshFromMesh(cvtMesh.get(), allPrimitiveIndicesVectors);
-            if  (createMeshesWithMaximumIndicesCountFromMeshIfNeeded(unifiedMesh.get(), 65535, meshes) == false) {
-                meshes.push_back(unifiedMesh);
+        if (snapshot->getPrimitives().size() > 0) {
+            size_t firstMeshIndex = meshes.size();
+            //After this point the snapshot should not be referenced anymore and will be deallocated
+            shared_ptr <GLTF::GLTFMesh> unifiedMesh = createUnifiedIndexesMeshFromMesh(snapshot, allPrimitiveIndicesVectors);
+            if (!unifiedMesh) {
+                // FIXME: report error
+                printf("WARNING: mesh %s could not be welded, it is skipped\n", snapshot->getID().c_str());
+                return;
+            }
+            //reorder before splitting, this way the sub meshes get the locality of the reordered triangles too
+            if (converterContext.optimizeVertexCache) {
+                optimizeMeshForVertexCache(unifiedMesh.get());
+            }
+            
+            //levels of detail are simplified from the welded mesh, each one from the previous one, before any split so that they can share its vertices
+            MeshVector levelsOfDetail;
+            shared_ptr <GLTF::GLTFMesh> previousLevelMesh = unifiedMesh;
+            double previousRatio = 1;
+            for (size_t i = 0 ; i < converterContext.levelsOfDetailRatios.size() ; i++) {
+                double ratio = converterContext.levelsOfDetailRatios[i];
+                shared_ptr <GLTF::GLTFMesh> levelMesh = createSimplifiedMesh(previousLevelMesh.get(), ratio / previousRatio);
+                if (!levelMesh)
+                    continue;
+                levelMesh->setID(unifiedMesh->getID() + "-lod" + GLTFUtils::toString(i + 1));
+                levelMesh->setName(unifiedMesh->getName() + "-lod" + GLTFUtils::toString(i + 1));
+                levelMesh->setLevelOfDetail((unsigned int)(i + 1));
+                levelsOfDetail.push_back(levelMesh);
+                previousLevelMesh = levelMesh;
+                previousRatio = ratio;
             }
+            
+            __AppendMeshWithinIndicesWidth(unifiedMesh, meshes, converterContext);
+            for (size_t i = 0 ; i < levelsOfDetail.size() ; i++) {
+                size_t firstLevelMeshIndex = meshes.size();
+                __AppendMeshWithinIndicesWidth(levelsOfDetail[i], meshes, converterContext);
+                //sub meshes are created without a level
+                for (size_t j = firstLevelMeshIndex ; j < meshes.size() ; j++) {
+                    meshes[j]->setLevelOfDetail(levelsOfDetail[i]->getLevelOfDetail());
+                }
+            }
+            
+            //quantize last, splitting copies the attributes as they are and bounds are taken on the final meshes
+            if ((converterContext.positionQuantizationBits != 0) || (converterContext.normalQuantizationBits != 0) || (converterContext.texcoordQuantizationBits != 0)) {
+                for (size_t i = firstMeshIndex ; i < meshes.size() ; i++) {
+                    quantizeMeshAttributes(meshes[i].get(),
+                                           converterContext.positionQuantizationBits,
+                                           converterContext.normalQuantizationBits,
+                                           converterContext.texcoordQuantizationBits);
+                }
+            }
+            Profiler::count(MESHES_COUNTER, meshes.size() - firstMeshIndex);
         }
     }
+    
+    void convertOpenCOLLADAMesh(COLLADAFW::Mesh* openCOLLADAMesh,
+                                MeshVector &meshes,
+                                GLTF::GLTFConverterContext &converterContext)
+    {
+        std::vector< shared_ptr<IndicesVector> > allPrimitiveIndicesVectors;
+        
+        shared_ptr <GLTF::GLTFMesh> snapshot = createSnapshotFromOpenCOLLADAMesh(openCOLLADAMesh, allPrimitiveIndicesVectors, converterContext);
+        convertMeshSnapshot(snapshot.get(), allPrimitiveIndicesVectors, meshes, converterContext);
+    }
 
     
 }
@@ -6,7 +6,18 @@
 
 namespace GLTF
 {
-    void convertOpenCOLLADAMesh(COLLADAFW::Mesh* openCOLLADAMesh, MeshVector &meshes);
+    /*
+        Mesh conversion is done in 2 steps:
+        - createSnapshotFromOpenCOLLADAMesh gathers the primitives (triangulating them if needed) and copies the sources and indices.
+          It must be called from the loader callback, the returned mesh doesn't reference any OpenCOLLADA data.
+          Double sources are narrowed to floats there, so only the OpenCOLLADA copy of them is ever held in double precision.
+        - convertMeshSnapshot inverts V, unifies the indices, optimizes and splits the mesh.
+          It only touches the snapshot, so it can run on any thread.
+     */
+    shared_ptr <GLTFMesh> createSnapshotFromOpenCOLLADAMesh(COLLADAFW::Mesh* openCOLLADAMesh, std::vector< shared_ptr<IndicesVector> > &allPrimitiveIndicesVectors, const GLTF::GLTFConverterContext &converterContext);
+    void convertMeshSnapshot(GLTFMesh *snapshot, std::vector< shared_ptr<IndicesVector> > &allPrimitiveIndicesVectors, MeshVector &meshes, const GLTF::GLTFConverterContext &converterContext);
+    
+    void convertOpenCOLLADAMesh(COLLADAFW::Mesh* openCOLLADAMesh, MeshVector &meshes, GLTF::GLTFConverterContext &converterContext);
 }
 
 
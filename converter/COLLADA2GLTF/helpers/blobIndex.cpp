@@ -0,0 +1,260 @@
+// Copyright (c) Fabrice Robinet
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "GLTF.h"
+#include "blobIndex.h"
+
+using namespace std::tr1;
+using namespace std;
+
+namespace GLTF
+{
+    //---- hashBytes -------------------------------------------------------------
+    
+    //multiply-rotate rounds over 4 independent lanes (the structure of xxHash64), so that the multiplications can overlap
+    static const unsigned long long kHashPrime1 = 0x9E3779B185EBCA87ULL;
+    static const unsigned long long kHashPrime2 = 0xC2B2AE3D27D4EB4FULL;
+    static const unsigned long long kHashPrime3 = 0x165667B19E3779F9ULL;
+    
+    static inline unsigned long long __RotateLeft64(unsigned long long x, int r)
+    {
+        return (x << r) | (x >> (64 - r));
+    }
+    
+    static inline unsigned long long __Read64(const unsigned char *data)
+    {
+        unsigned long long value;
+        memcpy(&value, data, sizeof(value));
+        return value;
+    }
+    
+    static inline unsigned long long __HashRound(unsigned long long lane, unsigned long long value)
+    {
+        return __RotateLeft64(lane + (value * kHashPrime2), 31) * kHashPrime1;
+    }
+    
+    unsigned long long hashBytes(const unsigned char *data, size_t length)
+    {
+        const unsigned char *end = data + length;
+        unsigned long long hash;
+        
+        if (length >= 32) {
+            unsigned long long lanes[4] = { kHashPrime1 + kHashPrime2, kHashPrime2, 0, 0 - kHashPrime1 };
+            const unsigned char *blocksEnd = end - 32;
+            while (data <= blocksEnd) {
+                lanes[0] = __HashRound(lanes[0], __Read64(data));
+                lanes[1] = __HashRound(lanes[1], __Read64(data + 8));
+                lanes[2] = __HashRound(lanes[2], __Read64(data + 16));
+                lanes[3] = __HashRound(lanes[3], __Read64(data + 24));
+                data += 32;
+            }
+            hash = __RotateLeft64(lanes[0], 1) + __RotateLeft64(lanes[1], 7) + __RotateLeft64(lanes[2], 12) + __RotateLeft64(lanes[3], 18);
+            for (size_t i = 0 ; i < 4 ; i++) {
+                hash = ((hash ^ __HashRound(0, lanes[i])) * kHashPrime1) + kHashPrime3;
+            }
+        } else {
+            hash = kHashPrime3;
+        }
+        
+        hash += (unsigned long long)length;
+        for ( ; data + 8 <= end ; data += 8) {
+            hash = (__RotateLeft64(hash ^ __HashRound(0, __Read64(data)), 27) * kHashPrime1) + kHashPrime3;
+        }
+        for ( ; data < end ; data++) {
+            hash = __RotateLeft64(hash ^ ((*data) * kHashPrime3), 11) * kHashPrime1;
+        }
+        
+        //final avalanche
+        hash ^= hash >> 33;
+        hash *= kHashPrime2;
+        hash ^= hash >> 29;
+        hash *= kHashPrime3;
+        hash ^= hash >> 32;
+        return hash;
+    }
+    
+    bool readBlobFromSegmentedStream(size_t offset, unsigned char *data, size_t length, void *context)
+    {
+        GLTFSegmentedOutputStream *segmentedStream = (GLTFSegmentedOutputStream*)context;
+        return segmentedStream->read(offset, (char*)data, length);
+    }
+    
+    //---- BlobIndex -------------------------------------------------------------
+    
+    //bytes read back at once when comparing blobs
+    static const size_t kBlobComparisonChunkSize = 64 * 1024;
+    
+    BlobIndex::BlobIndex() :
+    _outputStream(0),
+    _readerFunc(0),
+    _readerContext(0),
+    _deduplicatedBlobsCount(0),
+    _deduplicatedBytesCount(0)
+    {
+    }
+    
+    BlobIndex::~BlobIndex()
+    {
+    }
+    
+    void BlobIndex::reset(std::ostream *outputStream, BlobReaderFunc readerFunc, void *readerContext)
+    {
+        this->_outputStream = outputStream;
+        this->_readerFunc = readerFunc;
+        this->_readerContext = readerContext;
+        this->_hashToBlobLocation.clear();
+        this->_deduplicatedBlobsCount = 0;
+        this->_deduplicatedBytesCount = 0;
+    }
+    
+    bool BlobIndex::_matches(size_t offset, const unsigned char *data, size_t length)
+    {
+        std::vector <unsigned char> writtenData(std::min(length, kBlobComparisonChunkSize));
+        for (size_t compared = 0 ; compared < length ; compared += writtenData.size()) {
+            size_t chunk = std::min(length - compared, writtenData.size());
+            if (!this->_readerFunc(offset + compared, &writtenData[0], chunk, this->_readerContext))
+                return false;
+            if (memcmp(&writtenData[0], data + compared, chunk) != 0)
+                return false;
+        }
+        return true;
+    }
+    
+    size_t BlobIndex::append(const unsigned char *data, size_t length, size_t alignment)
+    {
+        unsigned long long hash = hashBytes(data, length);
+        
+        std::pair <HashToBlobLocation::const_iterator, HashToBlobLocation::const_iterator> candidates = this->_hashToBlobLocation.equal_range(hash);
+        for (HashToBlobLocation::const_iterator candidate = candidates.first ; candidate != candidates.second ; candidate++) {
+            const BlobLocation& location = candidate->second;
+            //blobs are reused at the same offset, so it has to suit the alignment of this one too
+            if ((location.length == length) && ((location.offset % alignment) == 0) && this->_matches(location.offset, data, length)) {
+                this->_deduplicatedBlobsCount++;
+                this->_deduplicatedBytesCount += length;
+                return location.offset;
+            }
+        }
+        
+        padStreamToAlignment(*this->_outputStream, alignment);
+        
+        BlobLocation location;
+        location.offset = static_cast<size_t>(this->_outputStream->tellp());
+        location.length = length;
+        this->_outputStream->write((const char*)data, length);
+        this->_hashToBlobLocation.insert(std::make_pair(hash, location));
+        
+        return location.offset;
+    }
+    
+    size_t BlobIndex::getDeduplicatedBlobsCount()
+    {
+        return this->_deduplicatedBlobsCount;
+    }
+    
+    size_t BlobIndex::getDeduplicatedBytesCount()
+    {
+        return this->_deduplicatedBytesCount;
+    }
+    
+    //---- appendMeshesBuffers -------------------------------------------------------------
+    
+    typedef std::pair <size_t /* offset in the source stream */, GLTFMeshAttribute*> MeshAttributeAtOffset;
+    typedef std::pair <size_t /* offset in the source stream */, GLTFIndices*> IndicesAtOffset;
+    
+    static bool __AppendSourceBlob(GLTFSegmentedOutputStream &sourceStream, size_t sourceOffset, size_t length, size_t alignment,
+                                   BlobIndex &blobIndex, std::vector <unsigned char> &blob, size_t *offset)
+    {
+        blob.resize(std::max(length, (size_t)1));
+        if (!sourceStream.read(sourceOffset, (char*)&blob[0], length))
+            return false;
+        *offset = blobIndex.append(&blob[0], length, alignment);
+        return true;
+    }
+    
+    bool appendMeshesBuffers(MeshVector &meshes,
+                             GLTFSegmentedOutputStream &verticesSourceStream,
+                             GLTFSegmentedOutputStream &indicesSourceStream,
+                             BlobIndex &verticesBlobIndex,
+                             BlobIndex &indicesBlobIndex)
+    {
+        std::vector <MeshAttributeAtOffset> meshAttributesAtOffsets;
+        std::vector <IndicesAtOffset> indicesAtOffsets;
+        std::set <GLTFMeshAttribute*> collectedMeshAttributes;
+        
+        for (size_t i = 0 ; i < meshes.size() ; i++) {
+            shared_ptr <GLTFMesh> mesh = meshes[i];
+            PrimitiveVector primitives = mesh->getPrimitives();
+            if (primitives.size() == 0)
+                continue;
+            
+            shared_ptr <MeshAttributeVector> allMeshAttributes = mesh->meshAttributes();
+            for (size_t j = 0 ; j < allMeshAttributes->size() ; j++) {
+                GLTFMeshAttribute* meshAttribute = (*allMeshAttributes)[j].get();
+                if ((meshAttribute->getCount() == 0) || !collectedMeshAttributes.insert(meshAttribute).second)
+                    continue;
+                meshAttributesAtOffsets.push_back(MeshAttributeAtOffset(meshAttribute->getByteOffset(), meshAttribute));
+            }
+            for (size_t j = 0 ; j < primitives.size() ; j++) {
+                GLTFIndices* indices = primitives[j]->getUniqueIndices().get();
+                if (indices->getCount() > 0)
+                    indicesAtOffsets.push_back(IndicesAtOffset(indices->getByteOffset(), indices));
+            }
+        }
+        
+        std::vector <unsigned char> blob;
+        
+        //attributes overlapping in the source stream are interleaved, they form a single blob
+        std::sort(meshAttributesAtOffsets.begin(), meshAttributesAtOffsets.end());
+        for (size_t first = 0 ; first < meshAttributesAtOffsets.size() ; ) {
+            size_t blobStart = meshAttributesAtOffsets[first].first;
+            size_t blobEnd = blobStart;
+            size_t last = first;
+            for ( ; (last < meshAttributesAtOffsets.size()) && ((last == first) || (meshAttributesAtOffsets[last].first < blobEnd)) ; last++) {
+                GLTFMeshAttribute* meshAttribute = meshAttributesAtOffsets[last].second;
+                size_t attributeEnd = meshAttributesAtOffsets[last].first + (meshAttribute->getByteStride() * (meshAttribute->getCount() - 1)) + meshAttribute->getVertexAttributeByteLength();
+                blobEnd = std::max(blobEnd, attributeEnd);
+            }
+            
+            size_t offset = 0;
+            if (!__AppendSourceBlob(verticesSourceStream, blobStart, blobEnd - blobStart, sizeof(float), verticesBlobIndex, blob, &offset))
+                return false;
+            for (size_t j = first ; j < last ; j++) {
+                meshAttributesAtOffsets[j].second->setByteOffset(offset + (meshAttributesAtOffsets[j].first - blobStart));
+            }
+            first = last;
+        }
+        
+        std::sort(indicesAtOffsets.begin(), indicesAtOffsets.end());
+        for (size_t j = 0 ; j < indicesAtOffsets.size() ; j++) {
+            GLTFIndices* indices = indicesAtOffsets[j].second;
+            size_t indexByteLength = getIndexByteLength(indices->getComponentType());
+            size_t offset = 0;
+            if (!__AppendSourceBlob(indicesSourceStream, indicesAtOffsets[j].first, indices->getCount() * indexByteLength, indexByteLength, indicesBlobIndex, blob, &offset))
+                return false;
+            indices->setByteOffset(offset);
+        }
+        
+        return true;
+    }
+}
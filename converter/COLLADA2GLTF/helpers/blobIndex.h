@@ -0,0 +1,95 @@
+// Copyright (c) Fabrice Robinet
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef __BLOB_INDEX_H__
+#define __BLOB_INDEX_H__
+
+namespace GLTF
+{
+    //64 bits hash of length bytes, processing 32 bytes per step so that it can run over every buffer written
+    unsigned long long hashBytes(const unsigned char *data, size_t length);
+    
+    //copies to data the length bytes written at offset in the stream an index appends to, returns false if they can't be read
+    typedef bool (*BlobReaderFunc)(size_t /* offset */,
+        unsigned char* /* data */,
+        size_t /* length */,
+        void* /* context */);
+    
+    //BlobReaderFunc for a GLTFSegmentedOutputStream passed as context
+    bool readBlobFromSegmentedStream(size_t offset, unsigned char *data, size_t length, void *context);
+    
+    /*
+        BlobIndex appends blobs to a stream and remembers them by content, so that a blob identical to one already written
+        gets the offset of that one instead of being written again. Blobs matching by hash and length are compared byte per byte,
+        the bytes already written being read back from the stream with a BlobReaderFunc.
+     */
+    class BlobIndex {
+    private:
+        BlobIndex(const BlobIndex&);
+        BlobIndex& operator=(const BlobIndex&);
+    public:
+        BlobIndex();
+        virtual ~BlobIndex();
+        
+        //forgets the blobs appended so far, the next ones are appended to outputStream
+        void reset(std::ostream *outputStream, BlobReaderFunc readerFunc, void *readerContext);
+        
+        //offset of a blob identical to data in the stream, it is appended at a multiple of alignment if there was none
+        size_t append(const unsigned char *data, size_t length, size_t alignment);
+        
+        size_t getDeduplicatedBlobsCount();
+        size_t getDeduplicatedBytesCount();
+        
+    private:
+        bool _matches(size_t offset, const unsigned char *data, size_t length);
+        
+    private:
+        typedef struct {
+            size_t offset;
+            size_t length;
+        } BlobLocation;
+        typedef unordered_multimap <unsigned long long, BlobLocation> HashToBlobLocation;
+        
+        std::ostream *_outputStream;
+        BlobReaderFunc _readerFunc;
+        void *_readerContext;
+        HashToBlobLocation _hashToBlobLocation;
+        size_t _deduplicatedBlobsCount;
+        size_t _deduplicatedBytesCount;
+    };
+    
+    /*
+        Appends the buffers of meshes, that were written by writeAllBuffers to verticesSourceStream and indicesSourceStream,
+        through the blob indexes and updates the byte offsets of their attributes and indices accordingly.
+        Interleaved attributes are appended as a single blob.
+        Returns false if a buffer could not be read back from its source stream, byte offsets are then left partially updated.
+     */
+    bool appendMeshesBuffers(MeshVector &meshes,
+                             GLTFSegmentedOutputStream &verticesSourceStream,
+                             GLTFSegmentedOutputStream &indicesSourceStream,
+                             BlobIndex &verticesBlobIndex,
+                             BlobIndex &indicesBlobIndex);
+}
+
+#endif
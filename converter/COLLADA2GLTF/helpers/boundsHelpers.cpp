@@ -0,0 +1,352 @@
+// Copyright (c) Fabrice Robinet
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+
+#include "GLTF.h"
+#include <float.h>
+#include "boundsHelpers.h"
+
+/*
+    The SIMD kernels are compiled for their own instruction set only, so that the rest of the converter keeps the default target,
+    and they are selected at runtime depending on the processor.
+ */
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#define GLTF_BOUNDS_SSE 1
+#if (_MSC_VER >= 1700)
+#define GLTF_BOUNDS_AVX2 1
+#endif
+#define GLTF_TARGET_SSE
+#define GLTF_TARGET_AVX2
+#elif defined(__clang__) || (defined(__GNUC__) && ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 9))))
+#include <immintrin.h>
+#define GLTF_BOUNDS_SSE 1
+#define GLTF_BOUNDS_AVX2 1
+#define GLTF_TARGET_SSE __attribute__((target("sse")))
+#define GLTF_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+using namespace rapidjson;
+using namespace std::tr1;
+using namespace std;
+
+namespace GLTF
+{
+    //packed vectors are processed in blocks of 12 floats, a multiple of 1, 2, 3 and 4 components
+    static const size_t kPackedBlockLength = 12;
+    
+    static void __ResetBounds(size_t componentsPerAttribute, float *min, float *max)
+    {
+        for (size_t j = 0 ; j < componentsPerAttribute ; j++) {
+            min[j] = FLT_MAX;
+            max[j] = -FLT_MAX;
+        }
+    }
+    
+    static void __AccumulateBounds(const unsigned char *data, size_t first, size_t last, size_t componentsPerAttribute, size_t byteStride, float *min, float *max)
+    {
+        for (size_t i = first ; i < last ; i++) {
+            const float *vector = (const float*)(data + (i * byteStride));
+            for (size_t j = 0 ; j < componentsPerAttribute ; j++) {
+                float value = vector[j];
+                if (value < min[j]) {
+                    min[j] = value;
+                }
+                if (value > max[j]) {
+                    max[j] = value;
+                }
+            }
+        }
+    }
+    
+    //the value at index k of a packed block belongs to the component k % componentsPerAttribute
+    static void __FoldPackedBounds(const float *blockMin, const float *blockMax, size_t blockLength, size_t componentsPerAttribute, float *min, float *max)
+    {
+        for (size_t k = 0 ; k < blockLength ; k++) {
+            size_t j = k % componentsPerAttribute;
+            if (blockMin[k] < min[j])
+                min[j] = blockMin[k];
+            if (blockMax[k] > max[j])
+                max[j] = blockMax[k];
+        }
+    }
+    
+    //count of vectors that can be loaded as 4 floats without reading past the last component of the last vector
+    static size_t __CountOfVec4Loads(size_t count, size_t componentsPerAttribute, size_t byteStride)
+    {
+        size_t dataLength = ((count - 1) * byteStride) + (componentsPerAttribute * sizeof(float));
+        if (dataLength < 4 * sizeof(float))
+            return 0;
+        if (byteStride == 0)
+            return count;
+        return std::min(count, ((dataLength - (4 * sizeof(float))) / byteStride) + 1);
+    }
+    
+    static void __ComputeFloatBoundsScalar(const unsigned char *data, size_t count, size_t componentsPerAttribute, size_t byteStride, float *min, float *max)
+    {
+        __ResetBounds(componentsPerAttribute, min, max);
+        __AccumulateBounds(data, 0, count, componentsPerAttribute, byteStride, min, max);
+    }
+    
+    /*
+        In the kernels below the value just loaded is always the first operand of min/max,
+        when it is NaN these instructions return the second operand and the value is ignored, like with the scalar comparisons.
+     */
+#if GLTF_BOUNDS_SSE
+    GLTF_TARGET_SSE
+    static void __ComputeFloatBoundsSSE(const unsigned char *data, size_t count, size_t componentsPerAttribute, size_t byteStride, float *min, float *max)
+    {
+        __ResetBounds(componentsPerAttribute, min, max);
+        
+        if (byteStride == componentsPerAttribute * sizeof(float)) {
+            const float *values = (const float*)data;
+            size_t valuesCount = count * componentsPerAttribute;
+            size_t blocksLength = valuesCount - (valuesCount % kPackedBlockLength);
+            
+            __m128 min0 = _mm_set1_ps(FLT_MAX), min1 = min0, min2 = min0;
+            __m128 max0 = _mm_set1_ps(-FLT_MAX), max1 = max0, max2 = max0;
+            for (size_t i = 0 ; i < blocksLength ; i += kPackedBlockLength) {
+                __m128 v0 = _mm_loadu_ps(values + i);
+                __m128 v1 = _mm_loadu_ps(values + i + 4);
+                __m128 v2 = _mm_loadu_ps(values + i + 8);
+                min0 = _mm_min_ps(v0, min0);
+                min1 = _mm_min_ps(v1, min1);
+                min2 = _mm_min_ps(v2, min2);
+                max0 = _mm_max_ps(v0, max0);
+                max1 = _mm_max_ps(v1, max1);
+                max2 = _mm_max_ps(v2, max2);
+            }
+            
+            float blockMin[kPackedBlockLength], blockMax[kPackedBlockLength];
+            _mm_storeu_ps(blockMin, min0);
+            _mm_storeu_ps(blockMin + 4, min1);
+            _mm_storeu_ps(blockMin + 8, min2);
+            _mm_storeu_ps(blockMax, max0);
+            _mm_storeu_ps(blockMax + 4, max1);
+            _mm_storeu_ps(blockMax + 8, max2);
+            __FoldPackedBounds(blockMin, blockMax, kPackedBlockLength, componentsPerAttribute, min, max);
+            
+            //blocksLength is a multiple of componentsPerAttribute, the remaining values start with the first component of a vector
+            __AccumulateBounds(data, blocksLength / componentsPerAttribute, count, componentsPerAttribute, byteStride, min, max);
+            return;
+        }
+        
+        //interleaved (or padded) vectors, each one is loaded as 4 floats and the lanes past componentsPerAttribute are ignored
+        size_t vec4LoadsCount = __CountOfVec4Loads(count, componentsPerAttribute, byteStride);
+        __m128 min0 = _mm_set1_ps(FLT_MAX), min1 = min0;
+        __m128 max0 = _mm_set1_ps(-FLT_MAX), max1 = max0;
+        size_t i = 0;
+        for ( ; i + 2 <= vec4LoadsCount ; i += 2) {
+            __m128 v0 = _mm_loadu_ps((const float*)(data + (i * byteStride)));
+            __m128 v1 = _mm_loadu_ps((const float*)(data + ((i + 1) * byteStride)));
+            min0 = _mm_min_ps(v0, min0);
+            min1 = _mm_min_ps(v1, min1);
+            max0 = _mm_max_ps(v0, max0);
+            max1 = _mm_max_ps(v1, max1);
+        }
+        if (i < vec4LoadsCount) {
+            __m128 v0 = _mm_loadu_ps((const float*)(data + (i * byteStride)));
+            min0 = _mm_min_ps(v0, min0);
+            max0 = _mm_max_ps(v0, max0);
+        }
+        
+        float vectorMin[4], vectorMax[4];
+        _mm_storeu_ps(vectorMin, _mm_min_ps(min0, min1));
+        _mm_storeu_ps(vectorMax, _mm_max_ps(max0, max1));
+        __FoldPackedBounds(vectorMin, vectorMax, componentsPerAttribute, componentsPerAttribute, min, max);
+        
+        __AccumulateBounds(data, vec4LoadsCount, count, componentsPerAttribute, byteStride, min, max);
+    }
+#endif
+    
+#if GLTF_BOUNDS_AVX2
+    GLTF_TARGET_AVX2
+    static void __ComputeFloatBoundsAVX2(const unsigned char *data, size_t count, size_t componentsPerAttribute, size_t byteStride, float *min, float *max)
+    {
+        __ResetBounds(componentsPerAttribute, min, max);
+        
+        if (byteStride == componentsPerAttribute * sizeof(float)) {
+            const float *values = (const float*)data;
+            size_t valuesCount = count * componentsPerAttribute;
+            size_t blockLength = kPackedBlockLength * 2;
+            size_t blocksLength = valuesCount - (valuesCount % blockLength);
+            
+            __m256 min0 = _mm256_set1_ps(FLT_MAX), min1 = min0, min2 = min0;
+            __m256 max0 = _mm256_set1_ps(-FLT_MAX), max1 = max0, max2 = max0;
+            for (size_t i = 0 ; i < blocksLength ; i += blockLength) {
+                __m256 v0 = _mm256_loadu_ps(values + i);
+                __m256 v1 = _mm256_loadu_ps(values + i + 8);
+                __m256 v2 = _mm256_loadu_ps(values + i + 16);
+                min0 = _mm256_min_ps(v0, min0);
+                min1 = _mm256_min_ps(v1, min1);
+                min2 = _mm256_min_ps(v2, min2);
+                max0 = _mm256_max_ps(v0, max0);
+                max1 = _mm256_max_ps(v1, max1);
+                max2 = _mm256_max_ps(v2, max2);
+            }
+            
+            float blockMin[kPackedBlockLength * 2], blockMax[kPackedBlockLength * 2];
+            _mm256_storeu_ps(blockMin, min0);
+            _mm256_storeu_ps(blockMin + 8, min1);
+            _mm256_storeu_ps(blockMin + 16, min2);
+            _mm256_storeu_ps(blockMax, max0);
+            _mm256_storeu_ps(blockMax + 8, max1);
+            _mm256_storeu_ps(blockMax + 16, max2);
+            __FoldPackedBounds(blockMin, blockMax, blockLength, componentsPerAttribute, min, max);
+            
+            __AccumulateBounds(data, blocksLength / componentsPerAttribute, count, componentsPerAttribute, byteStride, min, max);
+            return;
+        }
+        
+        //two vectors per register, one in each 128 bits lane
+        size_t vec4LoadsCount = __CountOfVec4Loads(count, componentsPerAttribute, byteStride);
+        __m256 min0 = _mm256_set1_ps(FLT_MAX), min1 = min0;
+        __m256 max0 = _mm256_set1_ps(-FLT_MAX), max1 = max0;
+        size_t i = 0;
+        for ( ; i + 4 <= vec4LoadsCount ; i += 4) {
+            __m256 v0 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps((const float*)(data + (i * byteStride)))),
+                                             _mm_loadu_ps((const float*)(data + ((i + 1) * byteStride))), 1);
+            __m256 v1 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps((const float*)(data + ((i + 2) * byteStride)))),
+                                             _mm_loadu_ps((const float*)(data + ((i + 3) * byteStride))), 1);
+            min0 = _mm256_min_ps(v0, min0);
+            min1 = _mm256_min_ps(v1, min1);
+            max0 = _mm256_max_ps(v0, max0);
+            max1 = _mm256_max_ps(v1, max1);
+        }
+        min0 = _mm256_min_ps(min0, min1);
+        max0 = _mm256_max_ps(max0, max1);
+        
+        __m128 vectorMin = _mm_min_ps(_mm256_castps256_ps128(min0), _mm256_extractf128_ps(min0, 1));
+        __m128 vectorMax = _mm_max_ps(_mm256_castps256_ps128(max0), _mm256_extractf128_ps(max0, 1));
+        for ( ; i < vec4LoadsCount ; i++) {
+            __m128 v0 = _mm_loadu_ps((const float*)(data + (i * byteStride)));
+            vectorMin = _mm_min_ps(v0, vectorMin);
+            vectorMax = _mm_max_ps(v0, vectorMax);
+        }
+        
+        float foldedMin[4], foldedMax[4];
+        _mm_storeu_ps(foldedMin, vectorMin);
+        _mm_storeu_ps(foldedMax, vectorMax);
+        __FoldPackedBounds(foldedMin, foldedMax, componentsPerAttribute, componentsPerAttribute, min, max);
+        
+        __AccumulateBounds(data, vec4LoadsCount, count, componentsPerAttribute, byteStride, min, max);
+    }
+#endif
+    
+    bool isBoundsKernelSupported(BoundsKernel kernel)
+    {
+        switch (kernel) {
+            case SCALAR_BOUNDS_KERNEL:
+                return true;
+#if GLTF_BOUNDS_SSE
+            case SSE_BOUNDS_KERNEL:
+#if defined(_MSC_VER)
+            {
+                int info[4];
+                __cpuid(info, 1);
+                return (info[3] & (1 << 25)) != 0;
+            }
+#else
+#if !defined(__clang__)
+                __builtin_cpu_init();
+#endif
+                return __builtin_cpu_supports("sse") != 0;
+#endif
+#endif
+#if GLTF_BOUNDS_AVX2
+            case AVX2_BOUNDS_KERNEL:
+#if defined(_MSC_VER)
+            {
+                int info[4];
+                __cpuid(info, 0);
+                if (info[0] < 7)
+                    return false;
+                //the OS must save the AVX registers (OSXSAVE and XCR0 bits 1 and 2)
+                __cpuid(info, 1);
+                if ((info[2] & (1 << 27)) == 0)
+                    return false;
+                if ((_xgetbv(0) & 6) != 6)
+                    return false;
+                __cpuidex(info, 7, 0);
+                return (info[1] & (1 << 5)) != 0;
+            }
+#else
+#if !defined(__clang__)
+                __builtin_cpu_init();
+#endif
+                return __builtin_cpu_supports("avx2") != 0;
+#endif
+#endif
+            default:
+                break;
+        }
+        return false;
+    }
+    
+    static BoundsKernel __SelectBoundsKernel()
+    {
+        if (isBoundsKernelSupported(AVX2_BOUNDS_KERNEL))
+            return AVX2_BOUNDS_KERNEL;
+        if (isBoundsKernelSupported(SSE_BOUNDS_KERNEL))
+            return SSE_BOUNDS_KERNEL;
+        return SCALAR_BOUNDS_KERNEL;
+    }
+    
+    //selected during static initialization, so that it is never written once threads are running
+    static const BoundsKernel kPreferredBoundsKernel = __SelectBoundsKernel();
+    
+    BoundsKernel getPreferredBoundsKernel()
+    {
+        return kPreferredBoundsKernel;
+    }
+    
+    void computeFloatBounds(const unsigned char *data, size_t count, size_t componentsPerAttribute, size_t byteStride, float *min, float *max)
+    {
+        computeFloatBounds(data, count, componentsPerAttribute, byteStride, min, max, kPreferredBoundsKernel);
+    }
+    
+    void computeFloatBounds(const unsigned char *data, size_t count, size_t componentsPerAttribute, size_t byteStride, float *min, float *max, BoundsKernel kernel)
+    {
+        assert((componentsPerAttribute >= 1) && (componentsPerAttribute <= 4) && (count > 0));
+        
+        switch (kernel) {
+#if GLTF_BOUNDS_AVX2
+            case AVX2_BOUNDS_KERNEL:
+                __ComputeFloatBoundsAVX2(data, count, componentsPerAttribute, byteStride, min, max);
+                return;
+#endif
+#if GLTF_BOUNDS_SSE
+            case SSE_BOUNDS_KERNEL:
+                __ComputeFloatBoundsSSE(data, count, componentsPerAttribute, byteStride, min, max);
+                return;
+#endif
+            default:
+                __ComputeFloatBoundsScalar(data, count, componentsPerAttribute, byteStride, min, max);
+                return;
+        }
+    }
+}
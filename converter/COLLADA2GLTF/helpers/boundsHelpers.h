@@ -0,0 +1,51 @@
+// Copyright (c) Fabrice Robinet
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+
+#ifndef __BOUNDS_HELPERS__
+#define __BOUNDS_HELPERS__
+
+namespace GLTF
+{
+    typedef enum {
+        SCALAR_BOUNDS_KERNEL = 0,
+        SSE_BOUNDS_KERNEL = 1,
+        AVX2_BOUNDS_KERNEL = 2
+    } BoundsKernel;
+    
+    //whether the kernel was built in and can run on this processor, the scalar one is always supported
+    bool isBoundsKernelSupported(BoundsKernel kernel);
+    
+    //best kernel supported, selected once at startup
+    BoundsKernel getPreferredBoundsKernel();
+    
+    /*
+        Computes the per component min and max of count vectors of componentsPerAttribute floats (1 to 4), laid out byteStride bytes apart.
+        NaN values are ignored. count must not be 0.
+     */
+    void computeFloatBounds(const unsigned char *data, size_t count, size_t componentsPerAttribute, size_t byteStride, float *min, float *max);
+    void computeFloatBounds(const unsigned char *data, size_t count, size_t componentsPerAttribute, size_t byteStride, float *min, float *max, BoundsKernel kernel);
+}
+
+#endif
@@ -0,0 +1,283 @@
+// Copyright (c) Fabrice Robinet
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "GLTF.h"
+#include <math.h>
+#include "decompositionHelpers.h"
+
+//SSE2 is part of x86-64, its kernel is built in and always used there
+#if defined(__x86_64__) || defined(_M_X64)
+#include <emmintrin.h>
+#define GLTF_DECOMPOSITION_SSE2 1
+#endif
+
+using namespace std::tr1;
+using namespace std;
+
+namespace GLTF
+{
+    bool isDecompositionKernelSupported(DecompositionKernel kernel)
+    {
+        switch (kernel) {
+            case SCALAR_DECOMPOSITION_KERNEL:
+                return true;
+            case SSE2_DECOMPOSITION_KERNEL:
+#if GLTF_DECOMPOSITION_SSE2
+                return true;
+#else
+                return false;
+#endif
+            default:
+                break;
+        }
+        return false;
+    }
+    
+    DecompositionKernel getPreferredDecompositionKernel()
+    {
+        return isDecompositionKernelSupported(SSE2_DECOMPOSITION_KERNEL) ? SSE2_DECOMPOSITION_KERNEL : SCALAR_DECOMPOSITION_KERNEL;
+    }
+    
+    /*
+        The kernels perform the same operations in the same order, single precision square roots and divisions being exact
+        their results are identical.
+        The rotation matrix is made of the columns of the matrix divided by the scales, it is converted to a quaternion
+        with Shepperd's method: the largest of the 4 diagonal terms of the quaternion matrix gives the component computed
+        from a square root, the 3 others are computed from it.
+     */
+    static void __DecomposeMatrixScalar(const float *m, float *translation, float *rotation, float *scale)
+    {
+        float c0x = m[0], c0y = m[4], c0z = m[8];
+        float c1x = m[1], c1y = m[5], c1z = m[9];
+        float c2x = m[2], c2y = m[6], c2z = m[10];
+        
+        float sx = sqrtf(((c0x * c0x) + (c0y * c0y)) + (c0z * c0z));
+        float sy = sqrtf(((c1x * c1x) + (c1y * c1y)) + (c1z * c1z));
+        float sz = sqrtf(((c2x * c2x) + (c2y * c2y)) + (c2z * c2z));
+        
+        float crossX = (c1y * c2z) - (c1z * c2y);
+        float crossY = (c1z * c2x) - (c1x * c2z);
+        float crossZ = (c1x * c2y) - (c1y * c2x);
+        float determinant = ((c0x * crossX) + (c0y * crossY)) + (c0z * crossZ);
+        if (determinant < 0) {
+            sx = -sx;
+            sy = -sy;
+            sz = -sz;
+        }
+        
+        //a null scale leaves a null column, the rotation is then whatever the others make it
+        float isx = (sx != 0) ? 1.f / sx : 0;
+        float isy = (sy != 0) ? 1.f / sy : 0;
+        float isz = (sz != 0) ? 1.f / sz : 0;
+        
+        float r00 = c0x * isx, r01 = c1x * isy, r02 = c2x * isz;
+        float r10 = c0y * isx, r11 = c1y * isy, r12 = c2y * isz;
+        float r20 = c0z * isx, r21 = c1z * isy, r22 = c2z * isz;
+        
+        float tw = ((1.f + r00) + r11) + r22;
+        float tx = ((1.f + r00) - r11) - r22;
+        float ty = ((1.f - r00) + r11) - r22;
+        float tz = ((1.f - r00) - r11) + r22;
+        float t = std::max(std::max(tw, tx), std::max(ty, tz));
+        
+        float root = sqrtf(t);
+        float half = 0.5f * root;
+        float k = 0.5f / root;
+        float dx = (r21 - r12) * k, dy = (r02 - r20) * k, dz = (r10 - r01) * k;
+        float sxy = (r01 + r10) * k, sxz = (r02 + r20) * k, syz = (r12 + r21) * k;
+        
+        float x, y, z, w;
+        if (tw == t) {
+            x = dx; y = dy; z = dz; w = half;
+        } else if (tx == t) {
+            x = half; y = sxy; z = sxz; w = dx;
+        } else if (ty == t) {
+            x = sxy; y = half; z = syz; w = dy;
+        } else {
+            x = sxz; y = syz; z = half; w = dz;
+        }
+        
+        float inverseLength = 1.f / sqrtf((((x * x) + (y * y)) + (z * z)) + (w * w));
+        
+        translation[0] = m[3];
+        translation[1] = m[7];
+        translation[2] = m[11];
+        rotation[0] = x * inverseLength;
+        rotation[1] = y * inverseLength;
+        rotation[2] = z * inverseLength;
+        rotation[3] = w * inverseLength;
+        scale[0] = sx;
+        scale[1] = sy;
+        scale[2] = sz;
+    }
+    
+    static void __KeepInHemisphere(const float *previous, float *rotation)
+    {
+        if (!previous)
+            return;
+        float dot = (((previous[0] * rotation[0]) + (previous[1] * rotation[1])) + (previous[2] * rotation[2])) + (previous[3] * rotation[3]);
+        if (dot < 0) {
+            rotation[0] = -rotation[0];
+            rotation[1] = -rotation[1];
+            rotation[2] = -rotation[2];
+            rotation[3] = -rotation[3];
+        }
+    }
+    
+#if GLTF_DECOMPOSITION_SSE2
+    static inline __m128 __Select(__m128 mask, __m128 a, __m128 b)
+    {
+        return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+    }
+    
+    //decomposes the 4 matrices at matrices in structure of arrays form, returns them as 4 translations, 4 quaternions and 4 scales of 4 floats
+    static void __DecomposeMatricesSSE2(const float *matrices, float translations[4][4], float rotations[4][4], float scales[4][4])
+    {
+        __m128 m00 = _mm_loadu_ps(matrices), m01 = _mm_loadu_ps(matrices + 16), m02 = _mm_loadu_ps(matrices + 32), m03 = _mm_loadu_ps(matrices + 48);
+        __m128 m10 = _mm_loadu_ps(matrices + 4), m11 = _mm_loadu_ps(matrices + 20), m12 = _mm_loadu_ps(matrices + 36), m13 = _mm_loadu_ps(matrices + 52);
+        __m128 m20 = _mm_loadu_ps(matrices + 8), m21 = _mm_loadu_ps(matrices + 24), m22 = _mm_loadu_ps(matrices + 40), m23 = _mm_loadu_ps(matrices + 56);
+        //each register then holds the same element of the 4 matrices
+        _MM_TRANSPOSE4_PS(m00, m01, m02, m03);
+        _MM_TRANSPOSE4_PS(m10, m11, m12, m13);
+        _MM_TRANSPOSE4_PS(m20, m21, m22, m23);
+        
+        __m128 zero = _mm_setzero_ps();
+        __m128 one = _mm_set1_ps(1.f);
+        __m128 oneHalf = _mm_set1_ps(0.5f);
+        
+        __m128 sx = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m00, m00), _mm_mul_ps(m10, m10)), _mm_mul_ps(m20, m20)));
+        __m128 sy = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m01, m01), _mm_mul_ps(m11, m11)), _mm_mul_ps(m21, m21)));
+        __m128 sz = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m02, m02), _mm_mul_ps(m12, m12)), _mm_mul_ps(m22, m22)));
+        
+        __m128 crossX = _mm_sub_ps(_mm_mul_ps(m11, m22), _mm_mul_ps(m21, m12));
+        __m128 crossY = _mm_sub_ps(_mm_mul_ps(m21, m02), _mm_mul_ps(m01, m22));
+        __m128 crossZ = _mm_sub_ps(_mm_mul_ps(m01, m12), _mm_mul_ps(m11, m02));
+        __m128 determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m00, crossX), _mm_mul_ps(m10, crossY)), _mm_mul_ps(m20, crossZ));
+        __m128 flip = _mm_and_ps(_mm_cmplt_ps(determinant, zero), _mm_set1_ps(-0.f));
+        sx = _mm_xor_ps(sx, flip);
+        sy = _mm_xor_ps(sy, flip);
+        sz = _mm_xor_ps(sz, flip);
+        
+        __m128 isx = _mm_and_ps(_mm_cmpneq_ps(sx, zero), _mm_div_ps(one, sx));
+        __m128 isy = _mm_and_ps(_mm_cmpneq_ps(sy, zero), _mm_div_ps(one, sy));
+        __m128 isz = _mm_and_ps(_mm_cmpneq_ps(sz, zero), _mm_div_ps(one, sz));
+        
+        __m128 r00 = _mm_mul_ps(m00, isx), r01 = _mm_mul_ps(m01, isy), r02 = _mm_mul_ps(m02, isz);
+        __m128 r10 = _mm_mul_ps(m10, isx), r11 = _mm_mul_ps(m11, isy), r12 = _mm_mul_ps(m12, isz);
+        __m128 r20 = _mm_mul_ps(m20, isx), r21 = _mm_mul_ps(m21, isy), r22 = _mm_mul_ps(m22, isz);
+        
+        __m128 tw = _mm_add_ps(_mm_add_ps(_mm_add_ps(one, r00), r11), r22);
+        __m128 tx = _mm_sub_ps(_mm_sub_ps(_mm_add_ps(one, r00), r11), r22);
+        __m128 ty = _mm_sub_ps(_mm_add_ps(_mm_sub_ps(one, r00), r11), r22);
+        __m128 tz = _mm_add_ps(_mm_sub_ps(_mm_sub_ps(one, r00), r11), r22);
+        __m128 t = _mm_max_ps(_mm_max_ps(tw, tx), _mm_max_ps(ty, tz));
+        
+        __m128 root = _mm_sqrt_ps(t);
+        __m128 half = _mm_mul_ps(oneHalf, root);
+        __m128 k = _mm_div_ps(oneHalf, root);
+        __m128 dx = _mm_mul_ps(_mm_sub_ps(r21, r12), k), dy = _mm_mul_ps(_mm_sub_ps(r02, r20), k), dz = _mm_mul_ps(_mm_sub_ps(r10, r01), k);
+        __m128 sxy = _mm_mul_ps(_mm_add_ps(r01, r10), k), sxz = _mm_mul_ps(_mm_add_ps(r02, r20), k), syz = _mm_mul_ps(_mm_add_ps(r12, r21), k);
+        
+        //same precedence as the scalar kernel on ties: w, x, y then z
+        __m128 isW = _mm_cmpeq_ps(tw, t);
+        __m128 isX = _mm_andnot_ps(isW, _mm_cmpeq_ps(tx, t));
+        __m128 isY = _mm_andnot_ps(_mm_or_ps(isW, isX), _mm_cmpeq_ps(ty, t));
+        __m128 x = __Select(isW, dx, __Select(isX, half, __Select(isY, sxy, sxz)));
+        __m128 y = __Select(isW, dy, __Select(isX, sxy, __Select(isY, half, syz)));
+        __m128 z = __Select(isW, dz, __Select(isX, sxz, __Select(isY, syz, half)));
+        __m128 w = __Select(isW, half, __Select(isX, dx, __Select(isY, dy, dz)));
+        
+        __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)), _mm_mul_ps(w, w)));
+        __m128 inverseLength = _mm_div_ps(one, length);
+        x = _mm_mul_ps(x, inverseLength);
+        y = _mm_mul_ps(y, inverseLength);
+        z = _mm_mul_ps(z, inverseLength);
+        w = _mm_mul_ps(w, inverseLength);
+        
+        //back to one vector per matrix, the 4th component of translations and scales is padding
+        __m128 translationsPadding = _mm_setzero_ps();
+        __m128 scalesPadding = _mm_setzero_ps();
+        _MM_TRANSPOSE4_PS(m03, m13, m23, translationsPadding);
+        _MM_TRANSPOSE4_PS(x, y, z, w);
+        _MM_TRANSPOSE4_PS(sx, sy, sz, scalesPadding);
+        
+        _mm_storeu_ps(translations[0], m03); _mm_storeu_ps(translations[1], m13); _mm_storeu_ps(translations[2], m23); _mm_storeu_ps(translations[3], translationsPadding);
+        _mm_storeu_ps(rotations[0], x); _mm_storeu_ps(rotations[1], y); _mm_storeu_ps(rotations[2], z); _mm_storeu_ps(rotations[3], w);
+        _mm_storeu_ps(scales[0], sx); _mm_storeu_ps(scales[1], sy); _mm_storeu_ps(scales[2], sz); _mm_storeu_ps(scales[3], scalesPadding);
+    }
+#endif
+    
+    void decomposeMatrices(const float *matrices, size_t count, float *translations, float *rotations, float *scales, DecompositionKernel kernel)
+    {
+        const float *previousRotation = 0;
+        size_t i = 0;
+        
+#if GLTF_DECOMPOSITION_SSE2
+        if (kernel == SSE2_DECOMPOSITION_KERNEL) {
+            float blockTranslations[4][4], blockRotations[4][4], blockScales[4][4];
+            for ( ; (i + 4) <= count ; i += 4) {
+                __DecomposeMatricesSSE2(matrices + (i * 16), blockTranslations, blockRotations, blockScales);
+                for (size_t j = 0 ; j < 4 ; j++) {
+                    float *rotation = rotations + ((i + j) * 4);
+                    memcpy(translations + ((i + j) * 3), blockTranslations[j], 3 * sizeof(float));
+                    memcpy(rotation, blockRotations[j], 4 * sizeof(float));
+                    memcpy(scales + ((i + j) * 3), blockScales[j], 3 * sizeof(float));
+                    __KeepInHemisphere(previousRotation, rotation);
+                    previousRotation = rotation;
+                }
+            }
+        }
+#endif
+        
+        for ( ; i < count ; i++) {
+            float *rotation = rotations + (i * 4);
+            __DecomposeMatrixScalar(matrices + (i * 16), translations + (i * 3), rotation, scales + (i * 3));
+            __KeepInHemisphere(previousRotation, rotation);
+            previousRotation = rotation;
+        }
+    }
+    
+    void quaternionsToAxisAngles(const float *quaternions, size_t count, float *axisAngles)
+    {
+        for (size_t i = 0 ; i < count ; i++) {
+            double x = quaternions[i * 4], y = quaternions[(i * 4) + 1], z = quaternions[(i * 4) + 2], w = quaternions[(i * 4) + 3];
+            double squaredLength = (x * x) + (y * y) + (z * z);
+            float *axisAngle = axisAngles + (i * 4);
+            if (squaredLength > 0) {
+                //acos(w) would lose the small angles, w being within a float epsilon of 1
+                double length = sqrt(squaredLength);
+                axisAngle[0] = (float)(x / length);
+                axisAngle[1] = (float)(y / length);
+                axisAngle[2] = (float)(z / length);
+                axisAngle[3] = (float)(2. * atan2(length, w));
+            } else {
+                //no rotation, any axis does
+                axisAngle[0] = 1;
+                axisAngle[1] = 0;
+                axisAngle[2] = 0;
+                axisAngle[3] = 0;
+            }
+        }
+    }
+}
@@ -0,0 +1,51 @@
+// Copyright (c) Fabrice Robinet
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef __DECOMPOSITION_HELPERS__
+#define __DECOMPOSITION_HELPERS__
+
+namespace GLTF
+{
+    typedef enum {
+        SCALAR_DECOMPOSITION_KERNEL = 0,
+        SSE2_DECOMPOSITION_KERNEL
+    } DecompositionKernel;
+    
+    bool isDecompositionKernelSupported(DecompositionKernel kernel);
+    DecompositionKernel getPreferredDecompositionKernel();
+    
+    /*
+        Decomposes count affine matrices of 16 floats, row major with the translation in the 4th column as in COLLADA,
+        into packed translations (3 floats), rotations as unit quaternions (x, y, z, w) and scales (3 floats).
+        Shear and perspective are ignored. A matrix flipping the coordinate system gets negative scales.
+        Each quaternion is in the hemisphere of the previous one, so that interpolating consecutive keys takes the short path.
+        The SSE2 kernel decomposes 4 matrices at a time, its results are the same as the scalar kernel.
+     */
+    void decomposeMatrices(const float *matrices, size_t count, float *translations, float *rotations, float *scales, DecompositionKernel kernel);
+    
+    //converts count unit quaternions to axis (x, y, z) and angle in radians, axisAngles may be quaternions
+    void quaternionsToAxisAngles(const float *quaternions, size_t count, float *axisAngles);
+}
+
+#endif
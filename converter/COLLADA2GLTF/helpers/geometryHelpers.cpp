@@ -25,6 +25,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "geometryHelpers.h"
+#include "profiler.h"
 
 using namespace rapidjson;
 using namespace std::tr1;
@@ -32,45 +33,71 @@ using namespace std;
 
 namespace GLTF
 {
-    unsigned int* createTrianglesFromPolylist(unsigned int *verticesCount /* array containing the count for each array of indices per face */,
-                                              unsigned int *polylist /* array containing the indices of a face */,
-                                              unsigned int count /* count of entries within the verticesCount array */,
-                                              unsigned int *triangulatedIndicesCount /* number of indices in returned array */) {
-        //destination buffer size
-        unsigned int indicesCount = 0;
+    //--------------------------------------------------------------------
+    TriangulationPlan::TriangulationPlan(const unsigned int *verticesCount, unsigned int count) :
+    _indicesCount(0)
+    {
+        size_t sourceIndex = 0;
         for (unsigned int i = 0 ; i < count ; i++) {
-            indicesCount += (verticesCount[i] - 2) * 3;
-        }
-
-        if (triangulatedIndicesCount) {
-            *triangulatedIndicesCount = indicesCount;
+            unsigned int faceVerticesCount = verticesCount[i];
+            if (faceVerticesCount >= 3) {
+                if ((this->_runs.size() > 0) && (this->_runs.back().verticesCount == faceVerticesCount) &&
+                    (this->_runs.back().firstSourceIndex + (this->_runs.back().facesCount * faceVerticesCount) == sourceIndex)) {
+                    this->_runs.back().facesCount++;
+                } else {
+                    Run run;
+                    run.verticesCount = faceVerticesCount;
+                    run.facesCount = 1;
+                    run.firstSourceIndex = sourceIndex;
+                    run.firstDestinationIndex = this->_indicesCount;
+                    this->_runs.push_back(run);
+                }
+                this->_indicesCount += (faceVerticesCount - 2) * 3;
+            }
+            sourceIndex += faceVerticesCount;
         }
-
-        unsigned int *triangleIndices = (unsigned int*)malloc(sizeof(unsigned int) * indicesCount);
-        unsigned int offsetDestination = 0;
-        unsigned int offsetSource = 0;
-        
-        for (unsigned int i = 0 ; i < count ; i++) {
-            unsigned int trianglesCount = verticesCount[i] - 2;
-            
-            unsigned int firstIndex = polylist[0];
-            offsetSource = 1;
-            
-            for (unsigned k = 0 ; k < trianglesCount ; k++) {
-                triangleIndices[offsetDestination] = firstIndex;
-                triangleIndices[offsetDestination + 1] = polylist[offsetSource];
-                triangleIndices[offsetDestination + 2] = polylist[offsetSource + 1];
-                //printf("%d %d %d\n",triangleIndices[offsetDestination], triangleIndices[offsetDestination +1], triangleIndices[offsetDestination +2]);
-                offsetSource += 1;
-                offsetDestination += 3;
+    }
+    
+    void TriangulationPlan::gatherIndices(const unsigned int **sources, const unsigned int *initialIndices, size_t streamsCount, unsigned int **destinations) const
+    {
+        ProfilerScope profilerScope(TRIANGULATION_PHASE);
+        
+        for (size_t r = 0 ; r < this->_runs.size() ; r++) {
+            const Run& run = this->_runs[r];
+            for (size_t s = 0 ; s < streamsCount ; s++) {
+                const unsigned int *source = sources[s] + run.firstSourceIndex;
+                unsigned int *destination = destinations[s] + run.firstDestinationIndex;
+                unsigned int initialIndex = initialIndices[s];
+                
+                switch (run.verticesCount) {
+                    case 3:
+                        for (size_t i = 0 ; i < run.facesCount * 3 ; i++) {
+                            destination[i] = source[i] - initialIndex;
+                        }
+                        break;
+                    case 4:
+                        for (size_t f = 0 ; f < run.facesCount ; f++, source += 4, destination += 6) {
+                            destination[0] = source[0] - initialIndex;
+                            destination[1] = source[1] - initialIndex;
+                            destination[2] = source[2] - initialIndex;
+                            destination[3] = destination[0];
+                            destination[4] = destination[2];
+                            destination[5] = source[3] - initialIndex;
+                        }
+                        break;
+                    default:
+                        for (size_t f = 0 ; f < run.facesCount ; f++, source += run.verticesCount) {
+                            unsigned int firstIndex = source[0] - initialIndex;
+                            for (unsigned int k = 2 ; k < run.verticesCount ; k++, destination += 3) {
+                                destination[0] = firstIndex;
+                                destination[1] = source[k - 1] - initialIndex;
+                                destination[2] = source[k] - initialIndex;
+                            }
+                        }
+                        break;
+                }
             }
-            offsetSource += 1;
-            
-            polylist += verticesCount[i];
         }
-        
-        
-        return triangleIndices;
     }
     
     std::string keyWithSemanticAndSet(GLTF::Semantic semantic, unsigned int indexSet)
@@ -84,91 +111,197 @@ namespace GLTF
         return semanticIndexSetKey;
     }
     
-    //---- GLTFPrimitiveRemapInfos -------------------------------------------------------------
+    //---- VertexWeldingTable -------------------------------------------------------------
     
-    // FIXME: put better comment here
-    //RemappedMeshIndexes[0] = count ;  RemappedMeshIndexes[1+] original indexes (used for hash code)
-    struct RemappedMeshIndexesHash {
-        inline size_t operator()(unsigned int* remappedMeshIndexes) const
-        {
-            size_t hash = 0;
-            size_t count = (size_t)remappedMeshIndexes[0];
-            
-            for (size_t i = 0 ; i < count ; i++) {
-                hash += (size_t)remappedMeshIndexes[i + 1 /* skip count */];
-            }
-            
-            return hash;
+    //keeps the probe sequences short, linear probing degrades quickly above ~0.7
+    #define WELDING_TABLE_MAX_LOAD_FACTOR_PERCENT 70
+    
+    //MurmurHash3 (32 bits) body and finalizer, every index of the n-uplet contributes to all the bits of the hash,
+    //unlike a plain sum where permutations (and many grid-like n-uplets) collide.
+    static inline unsigned int __RotateLeft(unsigned int x, int r)
+    {
+        return (x << r) | (x >> (32 - r));
+    }
+    
+    static inline unsigned int __HashTuple(const unsigned int *tuple, unsigned int tupleSize)
+    {
+        unsigned int hash = tupleSize;
+        for (unsigned int i = 0 ; i < tupleSize ; i++) {
+            unsigned int k = tuple[i];
+            k *= 0xcc9e2d51;
+            k = __RotateLeft(k, 15);
+            k *= 0x1b873593;
+            hash ^= k;
+            hash = __RotateLeft(hash, 13);
+            hash = hash * 5 + 0xe6546b64;
         }
-    };
+        hash ^= hash >> 16;
+        hash *= 0x85ebca6b;
+        hash ^= hash >> 13;
+        hash *= 0xc2b2ae35;
+        hash ^= hash >> 16;
+        
+        return hash;
+    }
     
-    struct RemappedMeshIndexesEq {
-        inline bool operator()(unsigned int* k1, unsigned int* k2) const {
-            
-            size_t count = (size_t)k1[0];
-            
-            if (count != (size_t)k2[0])
-                return false;
+    VertexWeldingTable::VertexWeldingTable(unsigned int tupleSize, size_t expectedVerticesCount):
+    _tupleSize(tupleSize),
+    _capacity(64),
+    _verticesCount(0)
+    {
+        while ((this->_capacity * WELDING_TABLE_MAX_LOAD_FACTOR_PERCENT) / 100 < expectedVerticesCount)
+            this->_capacity *= 2;
+        
+        this->_slots = (Slot*)calloc(this->_capacity, sizeof(Slot));
+        this->_tuplesCapacity = (this->_capacity * WELDING_TABLE_MAX_LOAD_FACTOR_PERCENT) / 100;
+        this->_tuples = (unsigned int*)malloc(this->_tuplesCapacity * (tupleSize ? tupleSize : 1) * sizeof(unsigned int));
+    }
+    
+    VertexWeldingTable::~VertexWeldingTable()
+    {
+        if (this->_slots)
+            free(this->_slots);
+        if (this->_tuples)
+            free(this->_tuples);
+    }
+    
+    unsigned int VertexWeldingTable::verticesCount()
+    {
+        return this->_verticesCount;
+    }
+    
+    unsigned int VertexWeldingTable::tupleSize()
+    {
+        return this->_tupleSize;
+    }
+    
+    const unsigned int* VertexWeldingTable::tupleAtIndex(unsigned int vertexIndex)
+    {
+        return this->_tuples + ((size_t)vertexIndex * this->_tupleSize);
+    }
+    
+    bool VertexWeldingTable::_grow()
+    {
+        size_t capacity = this->_capacity * 2;
+        size_t mask = capacity - 1;
+        Slot *slots = (Slot*)calloc(capacity, sizeof(Slot));
+        size_t tuplesCapacity = (capacity * WELDING_TABLE_MAX_LOAD_FACTOR_PERCENT) / 100;
+        unsigned int *tuples = (unsigned int*)realloc(this->_tuples, tuplesCapacity * (this->_tupleSize ? this->_tupleSize : 1) * sizeof(unsigned int));
+        
+        if (!slots || !tuples) {
+            // FIXME: report error
+            if (slots)
+                free(slots);
+            if (tuples)
+                this->_tuples = tuples;
+            return false;
+        }
+        
+        //hashes are kept in the slots, no need to hash the n-uplets again
+        for (size_t i = 0 ; i < this->_capacity ; i++) {
+            Slot slot = this->_slots[i];
+            if (slot.vertexIndexPlusOne == 0)
+                continue;
+            size_t position = slot.hash & mask;
+            while (slots[position].vertexIndexPlusOne != 0)
+                position = (position + 1) & mask;
+            slots[position] = slot;
+        }
+        
+        free(this->_slots);
+        this->_slots = slots;
+        this->_capacity = capacity;
+        this->_tuples = tuples;
+        this->_tuplesCapacity = tuplesCapacity;
+        
+        return true;
+    }
+    
+    void VertexWeldingTable::prefetch(const unsigned int *tuple)
+    {
+#if defined(__GNUC__)
+        __builtin_prefetch(&this->_slots[__HashTuple(tuple, this->_tupleSize) & (this->_capacity - 1)]);
+#endif
+    }
+    
+    unsigned int VertexWeldingTable::findOrInsert(const unsigned int *tuple, bool *inserted)
+    {
+        //a failed growth leaves the table as it was, n-uplets already there can still be found
+        bool canInsert = (this->_verticesCount < this->_tuplesCapacity) || this->_grow();
+        
+        unsigned int tupleSize = this->_tupleSize;
+        unsigned int hash = __HashTuple(tuple, tupleSize);
+        size_t mask = this->_capacity - 1;
+        size_t position = hash & mask;
+        
+        for (;;) {
+            Slot *slot = &this->_slots[position];
+            if (slot->vertexIndexPlusOne == 0) {
+                if (!canInsert)
+                    return WELDING_TABLE_NO_VERTEX;
+                
+                unsigned int vertexIndex = this->_verticesCount++;
+                memcpy(this->_tuples + ((size_t)vertexIndex * tupleSize), tuple, tupleSize * sizeof(unsigned int));
+                slot->hash = hash;
+                slot->vertexIndexPlusOne = vertexIndex + 1;
+                if (inserted)
+                    *inserted = true;
+                return vertexIndex;
+            }
             
-            for (size_t i = 0 ; i < count ; i++) {
-                if (k1[i + 1] != k2[i + 1])
-                    return false;
+            if (slot->hash == hash) {
+                unsigned int vertexIndex = slot->vertexIndexPlusOne - 1;
+                const unsigned int *candidate = this->_tuples + ((size_t)vertexIndex * tupleSize);
+                unsigned int i = 0;
+                while ((i < tupleSize) && (candidate[i] == tuple[i]))
+                    i++;
+                if (i == tupleSize) {
+                    if (inserted)
+                        *inserted = false;
+                    return vertexIndex;
+                }
             }
             
-            return true;
+            position = (position + 1) & mask;
         }
-    };
+    }
     
-    typedef unordered_map<unsigned int* ,unsigned int /* index of existing n-uplet of indices */, RemappedMeshIndexesHash, RemappedMeshIndexesEq> RemappedMeshIndexesHashmap;
-
-    typedef unordered_map<unsigned int ,unsigned int> IndicesMap;
+    //---- GLTFPrimitiveRemapInfos -------------------------------------------------------------
     
-    //FIXME: this could be just an intermediate anonymous(no id) GLTFBuffer
+    //vertices are created in order while welding, so the ones introduced by a primitive form a range.
     class GLTFPrimitiveRemapInfos
     {
     public:
-        GLTFPrimitiveRemapInfos(unsigned int* generatedIndices, unsigned int generatedIndicesCount, unsigned int *originalCountAndIndexes);
+        GLTFPrimitiveRemapInfos(unsigned int firstVertexIndex, unsigned int generatedVerticesCount);
         virtual ~GLTFPrimitiveRemapInfos();
         
-        unsigned int generatedIndicesCount();
-        unsigned int* generatedIndices();
-        unsigned int* originalCountAndIndexes();
+        unsigned int firstVertexIndex();
+        unsigned int generatedVerticesCount();
         
     private:
-        unsigned int _generatedIndicesCount;
-        unsigned int* _generatedIndices;
-        unsigned int* _originalCountAndIndexes;
+        unsigned int _firstVertexIndex;
+        unsigned int _generatedVerticesCount;
     };
     
     //---- GLTFPrimitiveRemapInfos -------------------------------------------------------------
-    GLTFPrimitiveRemapInfos::GLTFPrimitiveRemapInfos(unsigned int* generatedIndices, unsigned int generatedIndicesCount, unsigned int *originalCountAndIndexes):
-    _generatedIndicesCount(generatedIndicesCount),
-    _generatedIndices(generatedIndices),
-    _originalCountAndIndexes(originalCountAndIndexes)
+    GLTFPrimitiveRemapInfos::GLTFPrimitiveRemapInfos(unsigned int firstVertexIndex, unsigned int generatedVerticesCount):
+    _firstVertexIndex(firstVertexIndex),
+    _generatedVerticesCount(generatedVerticesCount)
     {
     }
     
     GLTFPrimitiveRemapInfos::~GLTFPrimitiveRemapInfos()
     {
-        if (this->_generatedIndices)
-            free(this->_generatedIndices);
-        if (this->_originalCountAndIndexes)
-            free(this->_originalCountAndIndexes);
-    }
-    
-    unsigned int GLTFPrimitiveRemapInfos::generatedIndicesCount()
-    {
-        return _generatedIndicesCount;
     }
     
-    unsigned int* GLTFPrimitiveRemapInfos::generatedIndices()
+    unsigned int GLTFPrimitiveRemapInfos::firstVertexIndex()
     {
-        return _generatedIndices;
+        return _firstVertexIndex;
     }
     
-    unsigned int* GLTFPrimitiveRemapInfos::originalCountAndIndexes()
+    unsigned int GLTFPrimitiveRemapInfos::generatedVerticesCount()
     {
-        return _originalCountAndIndexes;
+        return _generatedVerticesCount;
     }
     
     typedef struct {
@@ -216,6 +349,7 @@ namespace GLTF
                                   MeshAttributeVector allOriginalMeshAttributes,
                                   MeshAttributeVector allRemappedMeshAttributes,
                                   unsigned int* indicesInRemapping,
+                                  VertexWeldingTable &weldingTable,
                                   shared_ptr<GLTF::GLTFPrimitiveRemapInfos> primitiveRemapInfos)
     {
         size_t indicesSize = allIndices.size();
@@ -226,34 +360,28 @@ namespace GLTF
         unsigned int vertexAttributesCount = (unsigned int)indicesSize;
         
         //get the primitive infos to know where we need to "go" for remap
-        unsigned int count = primitiveRemapInfos->generatedIndicesCount();
-        unsigned int* indices = primitiveRemapInfos->generatedIndices();
+        unsigned int firstVertexIndex = primitiveRemapInfos->firstVertexIndex();
+        unsigned int endVertexIndex = firstVertexIndex + primitiveRemapInfos->generatedVerticesCount();
         
         MeshAttributesBufferInfos *allBufferInfos = createMeshAttributesBuffersInfos(allOriginalMeshAttributes , allRemappedMeshAttributes, indicesInRemapping, vertexAttributesCount);
+        if (!allBufferInfos)
+            return false;
         
-        unsigned int* uniqueIndicesBuffer = (unsigned int*)primitive->getIndices()->getBufferView()->getBufferDataByApplyingOffset();
-        
-        unsigned int *originalCountAndIndexes = primitiveRemapInfos->originalCountAndIndexes();
-        
-        for (unsigned int k = 0 ; k < count ; k++) {
-            unsigned int idx = indices[k];
-            unsigned int* remappedIndex = &originalCountAndIndexes[idx * (allOriginalMeshAttributes.size() + 1)];
+        for (unsigned int vertexIndex = firstVertexIndex ; vertexIndex < endVertexIndex ; vertexIndex++) {
+            const unsigned int* remappedIndex = weldingTable.tupleAtIndex(vertexIndex);
             
             for (size_t meshAttributeIndex = 0 ; meshAttributeIndex < vertexAttributesCount  ; meshAttributeIndex++) {
                 MeshAttributesBufferInfos *bufferInfos = &allBufferInfos[meshAttributeIndex];
-                unsigned int indiceInRemap = indicesInRemapping[meshAttributeIndex];
-                unsigned int rindex = remappedIndex[1 /* skip count */ + indiceInRemap];
+                unsigned int rindex = remappedIndex[indicesInRemapping[meshAttributeIndex]];
                 void *ptrSrc = (unsigned char*)bufferInfos->originalBufferData + (rindex * bufferInfos->originalMeshAttributeByteStride);
-                //FIXME: optimize / secure this a bit, too many indirections without testing for invalid pointers
                 /* copy the vertex attributes at the right offset and right indice (using the generated uniqueIndexes table */
-                void *ptrDst = bufferInfos->remappedBufferData + (uniqueIndicesBuffer[idx] * bufferInfos->remappedMeshAttributeByteStride);
+                void *ptrDst = bufferInfos->remappedBufferData + (vertexIndex * bufferInfos->remappedMeshAttributeByteStride);
 
                 memcpy(ptrDst, ptrSrc , bufferInfos->elementByteLength);
             }
         }
         
-        if (allBufferInfos)
-            free(allBufferInfos);
+        free(allBufferInfos);
         
         return true;
     }
@@ -261,48 +389,58 @@ namespace GLTF
     
     shared_ptr<GLTF::GLTFPrimitiveRemapInfos> __BuildPrimitiveUniqueIndexes(shared_ptr<GLTF::GLTFPrimitive> primitive,
                                                                                   std::vector< shared_ptr<GLTF::GLTFIndices> > allIndices,
-                                                                                  RemappedMeshIndexesHashmap& remappedMeshIndexesMap,
+                                                                                  VertexWeldingTable &weldingTable,
                                                                                   unsigned int* indicesInRemapping,
                                                                                   size_t startIndex,
                                                                                   unsigned int meshAttributesCount,
                                                                                   size_t &endIndex)
     {
-        unsigned int generatedIndicesCount = 0;
-
         size_t allIndicesSize = allIndices.size();
         size_t vertexIndicesCount = allIndices[0]->getCount();
-        size_t sizeOfRemappedIndex = (meshAttributesCount + 1) * sizeof(unsigned int);
         
-        unsigned int* originalCountAndIndexes = (unsigned int*)calloc( vertexIndicesCount, sizeOfRemappedIndex);
-        //this is useful for debugging.
+        //mesh attributes not used by this primitive stay at 0 in the n-uplet
+        unsigned int *remappedIndex = (unsigned int*)calloc(meshAttributesCount ? meshAttributesCount : 1, sizeof(unsigned int));
+        unsigned int *prefetchedIndex = (unsigned int*)calloc(meshAttributesCount ? meshAttributesCount : 1, sizeof(unsigned int));
+        unsigned int **allIndicesPtr = (unsigned int**)malloc(allIndicesSize * sizeof(unsigned int*));
+        for (size_t i = 0 ; i < allIndicesSize ; i++) {
+            allIndicesPtr[i] = (unsigned int*)allIndices[i]->getBufferView()->getBufferDataByApplyingOffset();
+        }
         
         unsigned int *uniqueIndexes = (unsigned int*)calloc( vertexIndicesCount , sizeof(unsigned int));
-        unsigned int *generatedIndices = (unsigned int*) calloc (vertexIndicesCount , sizeof(unsigned int)); //owned by PrimitiveRemapInfos
-        unsigned int currentIndex = startIndex;
+        bool succeeded = true;
         
         for (size_t k = 0 ; k < vertexIndicesCount ; k++) {
-            unsigned int* remappedIndex = &originalCountAndIndexes[k * (meshAttributesCount + 1)];
-                        
-            remappedIndex[0] = meshAttributesCount;
-            for (unsigned int i = 0 ; i < allIndicesSize ; i++) {
-                unsigned int idx = indicesInRemapping[i];
-                unsigned int* indicesPtr = (unsigned int*)allIndices[i]->getBufferView()->getBufferDataByApplyingOffset();
-                remappedIndex[1 + idx] = indicesPtr[k];
+            if (k + WELDING_PREFETCH_DISTANCE < vertexIndicesCount) {
+                for (size_t i = 0 ; i < allIndicesSize ; i++) {
+                    prefetchedIndex[indicesInRemapping[i]] = allIndicesPtr[i][k + WELDING_PREFETCH_DISTANCE];
+                }
+                weldingTable.prefetch(prefetchedIndex);
             }
             
-            unsigned int index;
-            if (remappedMeshIndexesMap.count(remappedIndex) == 0) {
-                index = currentIndex++;
-                generatedIndices[generatedIndicesCount++] = (unsigned int)k;
-                remappedMeshIndexesMap[remappedIndex] = index;
-            } else {
-                index = remappedMeshIndexesMap[remappedIndex];
+            for (size_t i = 0 ; i < allIndicesSize ; i++) {
+                remappedIndex[indicesInRemapping[i]] = allIndicesPtr[i][k];
+            }
+            
+            uniqueIndexes[k] = weldingTable.findOrInsert(remappedIndex, 0);
+            if (uniqueIndexes[k] == WELDING_TABLE_NO_VERTEX) {
+                succeeded = false;
+                break;
             }
-            uniqueIndexes[k] = index;
         }
         
-        endIndex = currentIndex;
-        shared_ptr <GLTF::GLTFPrimitiveRemapInfos> primitiveRemapInfos(new GLTF::GLTFPrimitiveRemapInfos(generatedIndices, generatedIndicesCount, originalCountAndIndexes));
+        free(allIndicesPtr);
+        free(prefetchedIndex);
+        free(remappedIndex);
+        
+        if (!succeeded) {
+            // FIXME: report error
+            printf("WARNING: out of memory while welding the vertices of a primitive\n");
+            free(uniqueIndexes);
+            return shared_ptr <GLTF::GLTFPrimitiveRemapInfos> ();
+        }
+        
+        endIndex = weldingTable.verticesCount();
+        shared_ptr <GLTF::GLTFPrimitiveRemapInfos> primitiveRemapInfos(new GLTF::GLTFPrimitiveRemapInfos((unsigned int)startIndex, (unsigned int)(endIndex - startIndex)));
         shared_ptr <GLTF::GLTFBufferView> indicesBufferView = createBufferViewWithAllocatedBuffer(uniqueIndexes, 0, vertexIndicesCount * sizeof(unsigned int), true);
         
         shared_ptr <GLTF::GLTFIndices> indices = shared_ptr <GLTF::GLTFIndices> (new GLTF::GLTFIndices(indicesBufferView, vertexIndicesCount));
@@ -315,6 +453,8 @@ namespace GLTF
     
     shared_ptr <GLTFMesh> createUnifiedIndexesMeshFromMesh(GLTFMesh *sourceMesh, std::vector< shared_ptr<IndicesVector> > &vectorOfIndicesVector)
     {
+        ProfilerScope profilerScope(WELDING_PHASE);
+        
         MeshAttributeVector originalMeshAttributes;
         MeshAttributeVector remappedMeshAttributes;
         shared_ptr <GLTFMesh> targetMesh(new GLTFMesh(*sourceMesh));
@@ -358,8 +498,21 @@ namespace GLTF
         
         vector <shared_ptr<GLTF::GLTFPrimitiveRemapInfos> > allPrimitiveRemapInfos;
         
+        //pre-size the welding table assuming each vertex is shared by ~4 corners (closed triangle meshes are closer to 6),
+        //it grows if that's not enough
+        size_t cornersCount = 0;
+        size_t trianglesCount = 0;
+        for (unsigned int i = 0 ; i < primitiveCount ; i++) {
+            if (vectorOfIndicesVector[i]->size() > 0) {
+                size_t primitiveCornersCount = (*vectorOfIndicesVector[i])[0]->getCount();
+                cornersCount += primitiveCornersCount;
+                if (sourcePrimitives[i]->getType() == "TRIANGLES")
+                    trianglesCount += primitiveCornersCount / 3;
+            }
+        }
+        
         //build a array that maps the meshAttributes that the indices points to with the index of the indice.
-        GLTF::RemappedMeshIndexesHashmap remappedMeshIndexesMap;
+        GLTF::VertexWeldingTable weldingTable(maxVertexAttributes, cornersCount / 4);
         for (unsigned int i = 0 ; i < primitiveCount ; i++) {
             shared_ptr<IndicesVector>  allIndicesSharedPtr = vectorOfIndicesVector[i];
             IndicesVector *allIndices = allIndicesSharedPtr.get();
@@ -375,7 +528,7 @@ namespace GLTF
                 indicesInRemapping[k] = idx;
             }
             
-            shared_ptr<GLTF::GLTFPrimitiveRemapInfos> primitiveRemapInfos = __BuildPrimitiveUniqueIndexes(targetPrimitives[i], *allIndices, remappedMeshIndexesMap, indicesInRemapping, startIndex, maxVertexAttributes, endIndex);
+            shared_ptr<GLTF::GLTFPrimitiveRemapInfos> primitiveRemapInfos = __BuildPrimitiveUniqueIndexes(targetPrimitives[i], *allIndices, weldingTable, indicesInRemapping, startIndex, maxVertexAttributes, endIndex);
             
             free(indicesInRemapping);
             
@@ -383,8 +536,8 @@ namespace GLTF
                 startIndex = endIndex;
                 allPrimitiveRemapInfos.push_back(primitiveRemapInfos);
             } else {
-                // FIXME: report error
-                //return NULL;
+                //the primitive has no indices, the mesh can't be built
+                return shared_ptr <GLTFMesh> ();
             }
         }
         
@@ -393,6 +546,10 @@ namespace GLTF
         // we can allocate the buffer to hold vertex attributes
         unsigned int vertexCount = endIndex;
         
+        Profiler::count(TRIANGLES_COUNTER, trianglesCount);
+        Profiler::count(VERTICES_BEFORE_WELDING_COUNTER, cornersCount);
+        Profiler::count(VERTICES_AFTER_WELDING_COUNTER, vertexCount);
+        
         for (unsigned int i = 0 ; i < allSemantics.size() ; i++) {
             IndexSetToMeshAttributeHashmap& indexSetToMeshAttribute = sourceMesh->getMeshAttributesForSemantic(allSemantics[i]);
             IndexSetToMeshAttributeHashmap& destinationIndexSetToMeshAttribute = targetMesh->getMeshAttributesForSemantic(allSemantics[i]);
@@ -445,6 +602,7 @@ namespace GLTF
                                                    originalMeshAttributes ,
                                                    remappedMeshAttributes,
                                                    indicesInRemapping,
+                                                   weldingTable,
                                                    allPrimitiveRemapInfos[i]);
             free(indicesInRemapping);
             
@@ -459,60 +617,103 @@ namespace GLTF
         
     //------ Mesh splitting ----
     
-    class SubMeshContext {
-    public:
-        shared_ptr <GLTFMesh> targetMesh;
-        //For each sub mesh being built, maintain 2 maps,
-        //with key:indice value: remapped indice
-        IndicesMap indexToRemappedIndex;
-    } ;
-
-    SubMeshContext* __CreateSubMeshContext()
+    /*
+        Sub meshes are built this way:
+        - primitives are broken down into elements (points, lines or triangles), strips and fans get decomposed since they can't be cut anywhere.
+        - a sub mesh grows from a seed element to the elements sharing its vertices (breadth first) until its vertices budget is reached.
+          Elements that would exceed the budget are skipped but growing goes on, the next ones may only reuse vertices already in the sub mesh.
+          This keeps sub meshes spatially coherent and limits the vertices shared by several of them, which have to be duplicated.
+        - elements are then emitted per sub mesh in their original order, so the locality of a vertex cache optimization done before is kept.
+        Each element is assigned once and the elements of a vertex are enumerated once per sub mesh using it, so this is linear in the elements count.
+     */
+    
+    static const unsigned int kUnassigned = 0xFFFFFFFF;
+    static const unsigned int kMaxIndicesPerElement = 3;
+    
+    static unsigned int __IndicesPerElement(const std::string& type)
     {
-        SubMeshContext *subMesh = new SubMeshContext();
-        shared_ptr <GLTFMesh> targetMesh = shared_ptr <GLTFMesh> (new GLTFMesh());
-        subMesh->targetMesh = targetMesh;
-        
-        return subMesh;
+        if (type == "POINTS")
+            return 1;
+        if ((type == "LINES") || (type == "LINE_STRIP"))
+            return 2;
+        return 3;
     }
     
-    void __PushAndRemapIndicesInSubMesh(SubMeshContext *subMesh, unsigned int* indices, int count)
+    //type of the primitives holding decomposed elements in sub meshes
+    static std::string __DecomposedPrimitiveType(const std::string& type)
     {
-        for (int i = 0 ; i < count ; i++) {
-            unsigned int index = indices[i];
-            
-            bool shouldRemap = subMesh->indexToRemappedIndex.count(index) == 0;
-            if (shouldRemap) {
-                unsigned int remappedIndex = subMesh->indexToRemappedIndex.size();
-                
-                subMesh->indexToRemappedIndex[index] = remappedIndex;
-            } 
+        if (type == "LINE_STRIP")
+            return "LINES";
+        if ((type == "TRIANGLE_STRIPS") || (type == "TRIANGLE_FANS"))
+            return "TRIANGLES";
+        return type;
+    }
+    
+    //appends indices of the elements of a primitive to elementsIndices, kMaxIndicesPerElement per element
+    static void __AppendElements(const std::string& type, const unsigned int *indices, size_t count, std::vector <unsigned int> &elementsIndices)
+    {
+        if (type == "LINE_STRIP") {
+            for (size_t i = 0 ; i + 1 < count ; i++) {
+                elementsIndices.push_back(indices[i]);
+                elementsIndices.push_back(indices[i + 1]);
+                elementsIndices.push_back(indices[i + 1]);
+            }
+        } else if (type == "TRIANGLE_STRIPS") {
+            for (size_t i = 0 ; i + 2 < count ; i++) {
+                //every other triangle of a strip has its winding reversed
+                unsigned int a = indices[(i & 1) ? i + 1 : i];
+                unsigned int b = indices[(i & 1) ? i : i + 1];
+                unsigned int c = indices[i + 2];
+                //degenerated triangles only join strips
+                if ((a == b) || (b == c) || (a == c))
+                    continue;
+                elementsIndices.push_back(a);
+                elementsIndices.push_back(b);
+                elementsIndices.push_back(c);
+            }
+        } else if (type == "TRIANGLE_FANS") {
+            for (size_t i = 1 ; i + 1 < count ; i++) {
+                elementsIndices.push_back(indices[0]);
+                elementsIndices.push_back(indices[i]);
+                elementsIndices.push_back(indices[i + 1]);
+            }
+        } else {
+            unsigned int indicesPerElement = __IndicesPerElement(type);
+            for (size_t i = 0 ; i + indicesPerElement <= count ; i += indicesPerElement) {
+                for (size_t k = 0 ; k < kMaxIndicesPerElement ; k++) {
+                    elementsIndices.push_back(indices[i + std::min(k, (size_t)indicesPerElement - 1)]);
+                }
+            }
         }
     }
     
-    static void __RemapMeshAttribute(void *value,
-                          GLTF::ComponentType type,
-                          size_t componentsPerAttribute,
-                          size_t index,
-                          size_t vertexAttributeByteSize,
-                          void *context) {
-        
-        void **remapContext = (void**)context;
-        unsigned char *targetBufferPtr = (unsigned char*)remapContext[0];
-        SubMeshContext *subMesh = (SubMeshContext*)remapContext[1];
-        if (subMesh->indexToRemappedIndex.count(index) > 0) {
-            size_t remappedIndex = subMesh->indexToRemappedIndex[index];
-            memcpy(&targetBufferPtr[vertexAttributeByteSize * remappedIndex], value, vertexAttributeByteSize);
+    //first element at or after element that is not assigned yet, nextElements is compressed along the way
+    static unsigned int __NextUnassignedElement(std::vector <unsigned int> &nextElements, unsigned int element)
+    {
+        unsigned int unassignedElement = element;
+        while ((unassignedElement < nextElements.size()) && (nextElements[unassignedElement] != unassignedElement))
+            unassignedElement = nextElements[unassignedElement];
+        while ((element < nextElements.size()) && (nextElements[element] != element)) {
+            unsigned int nextElement = nextElements[element];
+            nextElements[element] = unassignedElement;
+            element = nextElement;
         }
+        return unassignedElement;
     }
     
-    //FIXME: add suport for interleaved arrays
+    class SubMeshContext {
+    public:
+        shared_ptr <GLTFMesh> targetMesh;
+        //index of each vertex of the sub mesh in the source mesh
+        std::vector <unsigned int> sourceIndices;
+    } ;
+    
     void __RemapSubMesh(SubMeshContext *subMesh, GLTFMesh *sourceMesh)
     {
         //remap the subMesh using the original mesh
         //we walk through all meshAttributes
         vector <GLTF::Semantic> allSemantics = sourceMesh->allSemantics();
-        std::map<string, unsigned int> semanticAndSetToIndex;
+        unsigned int vertexAttributeCount = (unsigned int)subMesh->sourceIndices.size();
         
         for (unsigned int i = 0 ; i < allSemantics.size() ; i++) {
             IndexSetToMeshAttributeHashmap& indexSetToMeshAttribute = sourceMesh->getMeshAttributesForSemantic(allSemantics[i]);
@@ -525,22 +726,26 @@ namespace GLTF
                 unsigned int indexSet = (*meshAttributeIterator).first;
                 
                 shared_ptr <GLTFBufferView> referenceBufferView = selectedMeshAttribute->getBufferView();
+                size_t vertexAttributeByteLength = selectedMeshAttribute->getVertexAttributeByteLength();
+                size_t byteStride = selectedMeshAttribute->getByteStride();
+                const unsigned char *sourceBufferPtr = (const unsigned char*)referenceBufferView->getBufferDataByApplyingOffset();
                 
-                unsigned int vertexAttributeCount = subMesh->indexToRemappedIndex.size();
-                
-                //FIXME: this won't work with interleaved
-                unsigned int *targetBufferPtr = (unsigned int*)malloc(selectedMeshAttribute->getVertexAttributeByteLength() * vertexAttributeCount);
+                /*
+                    Gather the vectors used by the sub mesh, the target is packed.
+                    This does not go through GLTFMeshAttribute::visit, a visitor walks every vector of the source mesh
+                    and would make the cost of splitting proportional to the count of sub meshes times the source vertices.
+                 */
+                unsigned char *targetBufferPtr = (unsigned char*)malloc(vertexAttributeByteLength * vertexAttributeCount);
+                for (size_t j = 0 ; j < vertexAttributeCount ; j++) {
+                    memcpy(targetBufferPtr + (j * vertexAttributeByteLength), sourceBufferPtr + (subMesh->sourceIndices[j] * byteStride), vertexAttributeByteLength);
+                }
                 
-                void *context[2];
-                context[0] = targetBufferPtr;
-                context[1] = subMesh;
-                selectedMeshAttribute->apply(__RemapMeshAttribute, (void*)context);
-                                        
                 shared_ptr <GLTFBufferView> remappedBufferView =
-                createBufferViewWithAllocatedBuffer(referenceBufferView->getID(), targetBufferPtr, 0, selectedMeshAttribute->getVertexAttributeByteLength() * vertexAttributeCount, true);
+                createBufferViewWithAllocatedBuffer(referenceBufferView->getID(), targetBufferPtr, 0, vertexAttributeByteLength * vertexAttributeCount, true);
                 
                 shared_ptr <GLTFMeshAttribute> remappedMeshAttribute(new GLTF::GLTFMeshAttribute(selectedMeshAttribute.get()));
                 remappedMeshAttribute->setBufferView(remappedBufferView);
+                remappedMeshAttribute->setByteStride(vertexAttributeByteLength);
                 remappedMeshAttribute->setCount(vertexAttributeCount);
                 
                 targetIndexSetToMeshAttribute[indexSet] = remappedMeshAttribute;
@@ -548,151 +753,247 @@ namespace GLTF
         }
     }
     
-    bool createMeshesWithMaximumIndicesCountFromMeshIfNeeded(GLTFMesh *sourceMesh, unsigned int maxiumIndicesCount, MeshVector &meshes)
+    static void __AppendSubMeshPrimitive(SubMeshContext *subMesh, shared_ptr <GLTFPrimitive> sourcePrimitive, std::vector <unsigned int> &targetIndices)
     {
-        bool splitNeeded = false;
+        if (targetIndices.size() == 0)
+            return;
         
-        //First, check every primitive indices count to figure out if we really need to split anything at all.
-        //TODO: what about making a sanity check, to ensure we don't have points not referenced by any primitive. (I wonder if that's would be considered compliant with the SPEC. need to check.
-        PrimitiveVector primitives = sourceMesh->getPrimitives();
+        shared_ptr <GLTFPrimitive> targetPrimitive(new GLTFPrimitive((*sourcePrimitive)));
+        targetPrimitive->setType(__DecomposedPrimitiveType(sourcePrimitive->getType()));
         
-        for (size_t i = 0 ; i < primitives.size() ; i++) {
-            if (primitives[i]->getIndices()->getCount() >= maxiumIndicesCount) {
-                splitNeeded = true;
-                break;
-            }
+        size_t indicesLength = targetIndices.size() * sizeof(unsigned int);
+        unsigned int *targetIndicesPtr = (unsigned int*)malloc(indicesLength);
+        memcpy(targetIndicesPtr, &targetIndices[0], indicesLength);
+        
+        shared_ptr <GLTFBufferView> targetBufferView = createBufferViewWithAllocatedBuffer(targetIndicesPtr, 0, indicesLength, true);
+        shared_ptr <GLTFIndices> indices(new GLTFIndices(targetBufferView, targetIndices.size()));
+        targetPrimitive->setIndices(indices);
+        
+        subMesh->targetMesh->appendPrimitive(targetPrimitive);
+        targetIndices.clear();
+    }
+    
+    bool createMeshesWithMaximumIndicesCountFromMeshIfNeeded(GLTFMesh *sourceMesh, unsigned int maxiumIndicesCount, MeshVector &meshes)
+    {
+        ProfilerScope profilerScope(SPLITTING_PHASE);
+        
+        //indices can only exceed the maximum if there are more vertices than that
+        size_t verticesCount = 0;
+        shared_ptr <MeshAttributeVector> allMeshAttributes = sourceMesh->meshAttributes();
+        for (size_t i = 0 ; i < allMeshAttributes->size() ; i++) {
+            verticesCount = std::max(verticesCount, (*allMeshAttributes)[i]->getCount());
         }
         
-        if (!splitNeeded)
+        if ((verticesCount <= maxiumIndicesCount) || (maxiumIndicesCount < kMaxIndicesPerElement))
             return false;
         
-        SubMeshContext *subMesh = NULL;
-
-        bool stillHavePrimitivesElementsToBeProcessed = false;
-        bool primitiveCompleted = false;
+        PrimitiveVector primitives = sourceMesh->getPrimitives();
         
-        int *allNextPrimitiveIndices = (int*)calloc(primitives.size(), sizeof(int));
-        unsigned int meshIndex = 0;
+        //break down primitives into elements
+        std::vector <unsigned int> elementsIndices;
+        std::vector <unsigned int> elementsPrimitive;
+        std::vector <unsigned int> indicesPerElement(primitives.size());
         for (size_t i = 0 ; i < primitives.size() ; i++) {
-            if (allNextPrimitiveIndices[i] == -1)
-                continue;
-            
-            if (subMesh == 0) {
-                subMesh = __CreateSubMeshContext();
-                meshes.push_back(subMesh->targetMesh);
-                std::string meshID = "";
-                std::string meshName = "";
-                
-                meshID += sourceMesh->getID();
-                meshName += sourceMesh->getName();
-                if (meshIndex) {
-                    meshID += "-"+ GLTFUtils::toString(meshIndex);
-                    meshName += "-"+ GLTFUtils::toString(meshIndex);
-                }
-                subMesh->targetMesh->setID(meshID);
-                subMesh->targetMesh->setName(meshName);
-                
-                stillHavePrimitivesElementsToBeProcessed = false;
-                meshIndex++;
-            }
-            
-            shared_ptr <GLTFPrimitive> targetPrimitive;
-            //when we are done with a primitive we mark its nextIndice with a -1
-
-            targetPrimitive = shared_ptr <GLTFPrimitive> (new GLTFPrimitive((*primitives[i])));
-            
-            unsigned int nextPrimitiveIndex = (unsigned int)allNextPrimitiveIndices[i];
+            shared_ptr <GLTFIndices> indices = primitives[i]->getIndices();
+            const unsigned int *indicesPtr = (const unsigned int*)indices->getBufferView()->getBufferDataByApplyingOffset();
+            size_t previousElementsCount = elementsIndices.size() / kMaxIndicesPerElement;
             
-            shared_ptr<GLTFPrimitive> &primitive = primitives[i];
-            shared_ptr<GLTFIndices> indices = primitive->getIndices();
+            indicesPerElement[i] = __IndicesPerElement(__DecomposedPrimitiveType(primitives[i]->getType()));
+            __AppendElements(primitives[i]->getType(), indicesPtr, indices->getCount(), elementsIndices);
+            elementsPrimitive.resize(elementsIndices.size() / kMaxIndicesPerElement, (unsigned int)i);
             
-            unsigned int* indicesPtr = (unsigned int*)indices->getBufferView()->getBufferDataByApplyingOffset();
-            unsigned int* targetIndicesPtr = (unsigned int*)malloc(indices->getBufferView()->getBuffer()->getByteLength());
-            
-            //sub meshes are built this way [ and it is not optimal yet (*)]:
-            //each primitive is iterated through all its triangles/lines/...
-            //When the indices count in indexToRemappedIndex is >= maxiumIndicesCount then we try the next primitive.
-            /* 
-                we could continue walking through a primitive even if the of maximum indices has been reached, because, for instance the next say, triangles could be within the already remapped indices. That said, not doing so should produce meshes that have more chances to have adjacent triangles. Need more experimentation about this. Having 2 modes would ideal.
-             */
-            
-            
-            //Different iterators type will be needed for these types
-            /*
-             type = "TRIANGLES";
-             type = "LINES";
-             type = "LINE_STRIP";
-             type = "TRIANGLES";
-             type = "TRIANGLE_FANS";
-             type = "TRIANGLE_STRIPS";
-             type = "POINTS";
-             */
-            size_t j = 0;
-            unsigned int primitiveCount = 0;
-            unsigned int targetIndicesCount = 0;
-            if (primitive->getType() == "TRIANGLES") {
-                unsigned int indicesPerElementCount = 3;
-                primitiveCount = indices->getCount() / indicesPerElementCount;
-                for (j = nextPrimitiveIndex ; j < primitiveCount ; j++) {
-                    unsigned int *indicesPtrAtPrimitiveIndex = indicesPtr + (j * indicesPerElementCount);
-                    //will we still have room to store coming indices from this mesh ?
-                    //note: this is tied to the policy described above in (*)
-                    size_t currentSize = subMesh->indexToRemappedIndex.size();
-                    if ((currentSize + indicesPerElementCount) < maxiumIndicesCount) {
-                        __PushAndRemapIndicesInSubMesh(subMesh, indicesPtrAtPrimitiveIndex, indicesPerElementCount);
-
-                        //build the indices for the primitive to be added to the subMesh
-                        targetIndicesPtr[targetIndicesCount] = subMesh->indexToRemappedIndex[indicesPtrAtPrimitiveIndex[0]];
-                        targetIndicesPtr[targetIndicesCount + 1] = subMesh->indexToRemappedIndex[indicesPtrAtPrimitiveIndex[1]];
-                        targetIndicesPtr[targetIndicesCount + 2] = subMesh->indexToRemappedIndex[indicesPtrAtPrimitiveIndex[2]];
-                        
-                        targetIndicesCount += indicesPerElementCount;
+            if (previousElementsCount == elementsPrimitive.size())
+                printf("WARNING: primitive of type %s dropped while splitting mesh %s\n", primitives[i]->getType().c_str(), sourceMesh->getID().c_str());
+        }
+        unsigned int elementsCount = (unsigned int)elementsPrimitive.size();
+        
+        //elements using each vertex, stored contiguously (counting sort)
+        std::vector <unsigned int> vertexElementsStart(verticesCount + 1, 0);
+        std::vector <unsigned int> vertexElements;
+        for (unsigned int e = 0 ; e < elementsCount ; e++) {
+            const unsigned int *element = &elementsIndices[e * kMaxIndicesPerElement];
+            for (unsigned int k = 0 ; k < indicesPerElement[elementsPrimitive[e]] ; k++) {
+                vertexElementsStart[element[k] + 1]++;
+            }
+        }
+        for (size_t v = 0 ; v < verticesCount ; v++) {
+            vertexElementsStart[v + 1] += vertexElementsStart[v];
+        }
+        vertexElements.resize(vertexElementsStart[verticesCount]);
+        std::vector <unsigned int> vertexElementsEnd(vertexElementsStart.begin(), vertexElementsStart.end() - 1);
+        for (unsigned int e = 0 ; e < elementsCount ; e++) {
+            const unsigned int *element = &elementsIndices[e * kMaxIndicesPerElement];
+            for (unsigned int k = 0 ; k < indicesPerElement[elementsPrimitive[e]] ; k++) {
+                vertexElements[vertexElementsEnd[element[k]]++] = e;
+            }
+        }
+        
+        //grow the sub meshes
+        std::vector <unsigned int> elementSubMesh(elementsCount, kUnassigned);
+        std::vector <unsigned int> elementQueuedSubMesh(elementsCount, kUnassigned);
+        std::vector <unsigned int> vertexSubMesh(verticesCount, kUnassigned);
+        std::vector <unsigned int> nextElements(elementsCount);
+        for (unsigned int e = 0 ; e < elementsCount ; e++) {
+            nextElements[e] = e;
+        }
+        std::vector <unsigned int> queue;
+        size_t referencedVerticesCount = 0;
+        size_t subMeshesVerticesCount = 0;
+        unsigned int subMeshesCount = 0;
+        unsigned int seed = __NextUnassignedElement(nextElements, 0);
+        
+        while (seed < elementsCount) {
+            unsigned int subMeshIndex = subMeshesCount++;
+            unsigned int subMeshVerticesCount = 0;
+            
+            queue.clear();
+            size_t queueHead = 0;
+            while (seed < elementsCount) {
+                queue.push_back(seed);
+                elementQueuedSubMesh[seed] = subMeshIndex;
+                
+                while (queueHead < queue.size()) {
+                    unsigned int e = queue[queueHead++];
+                    const unsigned int *element = &elementsIndices[e * kMaxIndicesPerElement];
+                    unsigned int elementIndicesCount = indicesPerElement[elementsPrimitive[e]];
                     
-                        nextPrimitiveIndex++;
-                    } else {
-                        allNextPrimitiveIndices[i] = -1;
-                        primitiveCompleted = true;
-                        break;
+                    unsigned int newVerticesCount = 0;
+                    for (unsigned int k = 0 ; k < elementIndicesCount ; k++) {
+                        if ((vertexSubMesh[element[k]] != subMeshIndex) && ((k == 0) || (element[k] != element[0])) && ((k < 2) || (element[k] != element[1])))
+                            newVerticesCount++;
+                    }
+                    if (subMeshVerticesCount + newVerticesCount > maxiumIndicesCount)
+                        continue;
+                    
+                    elementSubMesh[e] = subMeshIndex;
+                    nextElements[e] = e + 1;
+                    subMeshVerticesCount += newVerticesCount;
+                    
+                    for (unsigned int k = 0 ; k < elementIndicesCount ; k++) {
+                        unsigned int vertex = element[k];
+                        if (vertexSubMesh[vertex] == subMeshIndex)
+                            continue;
+                        if (vertexSubMesh[vertex] == kUnassigned)
+                            referencedVerticesCount++;
+                        vertexSubMesh[vertex] = subMeshIndex;
+                        
+                        for (unsigned int n = vertexElementsStart[vertex] ; n < vertexElementsStart[vertex + 1] ; n++) {
+                            unsigned int neighbor = vertexElements[n];
+                            if ((elementSubMesh[neighbor] == kUnassigned) && (elementQueuedSubMesh[neighbor] != subMeshIndex)) {
+                                elementQueuedSubMesh[neighbor] = subMeshIndex;
+                                queue.push_back(neighbor);
+                            }
+                        }
                     }
                 }
-            }
-            
-            allNextPrimitiveIndices[i] = nextPrimitiveIndex;
-
-            if (targetIndicesCount > 0) {
-                //FIXME: here targetIndices takes too much memory
-                //To avoid this we would need to make a smaller copy.
-                //In our case not sure if that's really a problem since this buffer won't be around for too long, as each buffer is deallocated once the callback from OpenCOLLADA to handle geomery has completed.
                 
-                shared_ptr <GLTFBufferView> targetBufferView = createBufferViewWithAllocatedBuffer(targetIndicesPtr, 0,targetIndicesCount * sizeof(unsigned int), true);
-                
-                shared_ptr <GLTFIndices> indices(new GLTFIndices(targetBufferView, targetIndicesCount));
-                targetPrimitive->setIndices(indices);
-                
-                subMesh->targetMesh->appendPrimitive(targetPrimitive);
-            } else {
-                if (targetIndicesPtr)
-                    free(targetIndicesPtr);
+                //the connected elements are exhausted, fill what is left with another piece of the mesh
+                seed = __NextUnassignedElement(nextElements, 0);
+                if (subMeshVerticesCount + kMaxIndicesPerElement > maxiumIndicesCount)
+                    break;
+                while ((seed < elementsCount) && (elementQueuedSubMesh[seed] == subMeshIndex)) {
+                    seed = __NextUnassignedElement(nextElements, seed + 1);
+                }
             }
             
-            if (j < primitiveCount)
-                stillHavePrimitivesElementsToBeProcessed = true;
-            
-            //did we process the last primitive ?
-            if (primitiveCompleted || (((i + 1) == primitives.size()))) {
-                __RemapSubMesh(subMesh, sourceMesh);
-                if (stillHavePrimitivesElementsToBeProcessed) {
-                    //loop again and build new mesh
-                    i = -1;
-                    delete subMesh;
-                    subMesh = 0;
+            subMeshesVerticesCount += subMeshVerticesCount;
+            seed = __NextUnassignedElement(nextElements, 0);
+        }
+        
+        //elements of each sub mesh, in their original order
+        std::vector <unsigned int> subMeshElementsStart(subMeshesCount + 1, 0);
+        std::vector <unsigned int> subMeshElements(elementsCount);
+        for (unsigned int e = 0 ; e < elementsCount ; e++) {
+            subMeshElementsStart[elementSubMesh[e] + 1]++;
+        }
+        for (unsigned int s = 0 ; s < subMeshesCount ; s++) {
+            subMeshElementsStart[s + 1] += subMeshElementsStart[s];
+        }
+        std::vector <unsigned int> subMeshElementsEnd(subMeshElementsStart.begin(), subMeshElementsStart.end() - 1);
+        for (unsigned int e = 0 ; e < elementsCount ; e++) {
+            subMeshElements[subMeshElementsEnd[elementSubMesh[e]]++] = e;
+        }
+        
+        //emit the sub meshes
+        std::fill(vertexSubMesh.begin(), vertexSubMesh.end(), kUnassigned);
+        std::vector <unsigned int> remappedIndices(verticesCount);
+        std::vector <unsigned int> targetIndices;
+        for (unsigned int s = 0 ; s < subMeshesCount ; s++) {
+            SubMeshContext subMesh;
+            subMesh.targetMesh = shared_ptr <GLTFMesh> (new GLTFMesh());
+            meshes.push_back(subMesh.targetMesh);
+            
+            std::string meshID = sourceMesh->getID();
+            std::string meshName = sourceMesh->getName();
+            if (s) {
+                meshID += "-"+ GLTFUtils::toString(s);
+                meshName += "-"+ GLTFUtils::toString(s);
+            }
+            subMesh.targetMesh->setID(meshID);
+            subMesh.targetMesh->setName(meshName);
+            
+            unsigned int primitiveIndex = kUnassigned;
+            for (unsigned int n = subMeshElementsStart[s] ; n < subMeshElementsStart[s + 1] ; n++) {
+                unsigned int e = subMeshElements[n];
+                if (elementsPrimitive[e] != primitiveIndex) {
+                    if (primitiveIndex != kUnassigned)
+                        __AppendSubMeshPrimitive(&subMesh, primitives[primitiveIndex], targetIndices);
+                    primitiveIndex = elementsPrimitive[e];
+                }
+                
+                const unsigned int *element = &elementsIndices[e * kMaxIndicesPerElement];
+                for (unsigned int k = 0 ; k < indicesPerElement[primitiveIndex] ; k++) {
+                    unsigned int vertex = element[k];
+                    if (vertexSubMesh[vertex] != s) {
+                        vertexSubMesh[vertex] = s;
+                        remappedIndices[vertex] = (unsigned int)subMesh.sourceIndices.size();
+                        subMesh.sourceIndices.push_back(vertex);
+                    }
+                    targetIndices.push_back(remappedIndices[vertex]);
                 }
             }
+            if (primitiveIndex != kUnassigned)
+                __AppendSubMeshPrimitive(&subMesh, primitives[primitiveIndex], targetIndices);
+            
+            __RemapSubMesh(&subMesh, sourceMesh);
         }
         
-        free(allNextPrimitiveIndices);
+        if (referencedVerticesCount > 0) {
+            printf("[split] mesh %s: %d vertices into %d meshes, %.2f%% duplicated vertices\n",
+                   sourceMesh->getID().c_str(),
+                   (int)referencedVerticesCount,
+                   (int)subMeshesCount,
+                   100. * (double)(subMeshesVerticesCount - referencedVerticesCount) / (double)referencedVerticesCount);
+        }
         
         return true;
     }
+    
+    void setNarrowestIndicesComponentTypes(GLTFMesh *mesh)
+    {
+        PrimitiveVector primitives = mesh->getPrimitives();
+        for (size_t i = 0 ; i < primitives.size() ; i++) {
+            shared_ptr <GLTFIndices> indices = primitives[i]->getIndices();
+            size_t indicesCount = indices->getCount();
+            if (indicesCount == 0)
+                continue;
+            
+            //the largest index is what matters, a primitive may only reference a few of the vertices of its mesh
+            const unsigned int* indicesPtr = (const unsigned int*)indices->getBufferView()->getBufferDataByApplyingOffset();
+            unsigned int maxIndex = 0;
+            for (size_t j = 0 ; j < indicesCount ; j++) {
+                if (indicesPtr[j] > maxIndex)
+                    maxIndex = indicesPtr[j];
+            }
+            
+            if (maxIndex <= 0xFF) {
+                indices->setComponentType(UNSIGNED_BYTE);
+            } else if (maxIndex <= 0xFFFF) {
+                indices->setComponentType(UNSIGNED_SHORT);
+            } else {
+                indices->setComponentType(UNSIGNED_INT);
+            }
+        }
+    }
 
-}
\ No newline at end of file
+}
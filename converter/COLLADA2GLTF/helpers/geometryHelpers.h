@@ -26,16 +26,89 @@
 
 namespace GLTF
 {
+    /*
+        VertexWeldingTable maps n-uplets of indices (one index per mesh attribute) to the index of the unique vertex they define.
+        This is a flat open addressing hash table (linear probing): slots just hold a hash and a vertex index, while the n-uplets are
+        stored inline and contiguously, in the order vertices get created. So the table doubles as the remap table used to build vertex attributes.
+     */
+    #define WELDING_PREFETCH_DISTANCE 8
+    //returned by findOrInsert for a new n-uplet when the table could not grow to store it
+    #define WELDING_TABLE_NO_VERTEX 0xFFFFFFFF
+    
+    class VertexWeldingTable {
+    private:
+        VertexWeldingTable(const VertexWeldingTable&);
+        VertexWeldingTable& operator=(const VertexWeldingTable&);
+    public:
+        VertexWeldingTable(unsigned int tupleSize, size_t expectedVerticesCount);
+        virtual ~VertexWeldingTable();
+        
+        //returns the index of the vertex matching tuple, it is created (with index verticesCount()) if needed and inserted is set to true.
+        //returns WELDING_TABLE_NO_VERTEX if it had to be created but memory ran out.
+        unsigned int findOrInsert(const unsigned int *tuple, bool *inserted);
+        
+        //hints the slot for tuple into the CPU cache, calling this a few n-uplets ahead hides most of the memory latency
+        void prefetch(const unsigned int *tuple);
+        
+        unsigned int verticesCount();
+        unsigned int tupleSize();
+        const unsigned int* tupleAtIndex(unsigned int vertexIndex);
+        
+    private:
+        bool _grow();
+        
+    private:
+        typedef struct {
+            unsigned int hash;
+            unsigned int vertexIndexPlusOne; // 0 means empty slot
+        } Slot;
+        
+        unsigned int _tupleSize;
+        size_t _capacity;
+        Slot *_slots;
+        unsigned int *_tuples;
+        size_t _tuplesCapacity;
+        unsigned int _verticesCount;
+    };
+    
     std::string keyWithSemanticAndSet(GLTF::Semantic semantic, unsigned int indexSet);
 
+    //null if memory ran out while welding
     shared_ptr <GLTFMesh> createUnifiedIndexesMeshFromMesh(GLTFMesh *sourceMesh, std::vector< shared_ptr<IndicesVector> > &vectorOfIndicesVector);
     
     bool createMeshesWithMaximumIndicesCountFromMeshIfNeeded(GLTFMesh *sourceMesh, unsigned int maxiumIndicesCount, MeshVector &meshes);
     
-    unsigned int* createTrianglesFromPolylist(unsigned int *verticesCount /* array containing the count for each array of indices per face */,
-                                              unsigned int *polylist /* array containing the indices of a face */,
-                                              unsigned int count /* count of entries within the verticesCount array */,
-                                              unsigned int *triangulatedIndicesCount /* number of indices in returned array */);
+    //gives each primitive the smallest of UNSIGNED_BYTE, UNSIGNED_SHORT and UNSIGNED_INT able to hold its indices
+    void setNarrowestIndicesComponentTypes(GLTFMesh *mesh);
+    
+    /*
+        Fan triangulation of a polylist, computed once from its vertices count per face and applied to all its index streams.
+        The plan is made of runs of consecutive faces with the same vertices count, exporters mostly write a single run of triangles or quads.
+        Faces with less than 3 vertices don't produce triangles.
+     */
+    class TriangulationPlan {
+    public:
+        TriangulationPlan(const unsigned int *verticesCount, unsigned int count /* count of entries within the verticesCount array */);
+        
+        size_t getIndicesCount() const { return this->_indicesCount; }
+        
+        /*
+            Triangulates streamsCount polylists with a single walk of the plan, removing initialIndices[s] from the indices of stream s.
+            Each destination must hold getIndicesCount() indices.
+         */
+        void gatherIndices(const unsigned int **sources, const unsigned int *initialIndices, size_t streamsCount, unsigned int **destinations) const;
+        
+    private:
+        typedef struct {
+            unsigned int verticesCount;
+            size_t facesCount;
+            size_t firstSourceIndex;
+            size_t firstDestinationIndex;
+        } Run;
+        
+        std::vector <Run> _runs;
+        size_t _indicesCount;
+    };
 
 }
 
@@ -0,0 +1,384 @@
+// Copyright (c) Fabrice Robinet
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "GLTF.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "jobScheduler.h"
+#include "profiler.h"
+#include "imageHelpers.h"
+
+using namespace std;
+
+namespace GLTF
+{
+    //enough for the largest header read here, a DDS header followed by its DX10 extension
+    static const size_t kImageHeaderMaxLength = 148;
+    
+    static unsigned int __ReadBigEndian16(const unsigned char *data)
+    {
+        return (data[0] << 8) | data[1];
+    }
+    
+    static unsigned int __ReadBigEndian32(const unsigned char *data)
+    {
+        return ((unsigned int)data[0] << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+    }
+    
+    static unsigned int __ReadLittleEndian16(const unsigned char *data)
+    {
+        return data[0] | (data[1] << 8);
+    }
+    
+    static unsigned int __ReadLittleEndian32(const unsigned char *data)
+    {
+        return data[0] | (data[1] << 8) | (data[2] << 16) | ((unsigned int)data[3] << 24);
+    }
+    
+    static bool __HasExtension(const std::string& path, const std::string& extension)
+    {
+        if (path.size() < extension.size())
+            return false;
+        std::string pathExtension = path.substr(path.size() - extension.size());
+        std::transform(pathExtension.begin(), pathExtension.end(), pathExtension.begin(), ::tolower);
+        return pathExtension == extension;
+    }
+    
+    //---- PNG -------------------------------------------------------------------
+    
+    static const unsigned char kPNGSignature[8] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+    static const unsigned int kPNGGrayscaleAlphaColorType = 4;
+    static const unsigned int kPNGTruecolorAlphaColorType = 6;
+    
+    static bool __IsPNG(const unsigned char *header, size_t headerLength)
+    {
+        return (headerLength >= sizeof(kPNGSignature)) && (memcmp(header, kPNGSignature, sizeof(kPNGSignature)) == 0);
+    }
+    
+    static bool __ReadPNGMetadata(FILE *fd, const unsigned char *header, size_t headerLength, ImageMetadata& metadata)
+    {
+        //signature, then IHDR: length, type, width, height, bit depth, color type, compression, filter, interlace, CRC
+        if ((headerLength < 33) || (memcmp(header + 12, "IHDR", 4) != 0))
+            return false;
+        
+        metadata.width = __ReadBigEndian32(header + 16);
+        metadata.height = __ReadBigEndian32(header + 20);
+        unsigned int colorType = header[25];
+        metadata.hasAlpha = (colorType == kPNGGrayscaleAlphaColorType) || (colorType == kPNGTruecolorAlphaColorType);
+        
+        //other color types get alpha from a tRNS chunk, it has to come before the pixels so only the chunk headers up to IDAT are read
+        if (!metadata.hasAlpha && (fseek(fd, 33, SEEK_SET) == 0)) {
+            unsigned char chunkHeader[8];
+            while (fread(chunkHeader, 1, sizeof(chunkHeader), fd) == sizeof(chunkHeader)) {
+                if ((memcmp(chunkHeader + 4, "IDAT", 4) == 0) || (memcmp(chunkHeader + 4, "IEND", 4) == 0))
+                    break;
+                if (memcmp(chunkHeader + 4, "tRNS", 4) == 0) {
+                    metadata.hasAlpha = true;
+                    break;
+                }
+                //skips the data and the CRC
+                if (fseek(fd, (long)__ReadBigEndian32(chunkHeader) + 4, SEEK_CUR) != 0)
+                    break;
+            }
+        }
+        
+        return true;
+    }
+    
+    //---- JPEG ------------------------------------------------------------------
+    
+    static bool __IsJPEG(const unsigned char *header, size_t headerLength)
+    {
+        return (headerLength >= 3) && (header[0] == 0xFF) && (header[1] == 0xD8) && (header[2] == 0xFF);
+    }
+    
+    //start of frame markers, the ones in between are DHT, JPG and DAC
+    static bool __IsJPEGStartOfFrame(int marker)
+    {
+        return (marker >= 0xC0) && (marker <= 0xCF) && (marker != 0xC4) && (marker != 0xC8) && (marker != 0xCC);
+    }
+    
+    static bool __ReadJPEGMetadata(FILE *fd, ImageMetadata& metadata)
+    {
+        //JPEG has no alpha, the dimensions are in the start of frame segment, which comes before the scans
+        metadata.hasAlpha = false;
+        if (fseek(fd, 2, SEEK_SET) != 0)
+            return false;
+        
+        for (;;) {
+            int marker = fgetc(fd);
+            if (marker != 0xFF)
+                return false;
+            //markers may be padded with any count of 0xFF
+            while (marker == 0xFF) {
+                marker = fgetc(fd);
+            }
+            if (marker == EOF)
+                return false;
+            
+            //standalone markers have no length
+            if ((marker == 0x01) || ((marker >= 0xD0) && (marker <= 0xD8)))
+                continue;
+            //end of image or start of scan before any frame
+            if ((marker == 0xD9) || (marker == 0xDA))
+                return false;
+            
+            unsigned char segmentHeader[7];
+            if (fread(segmentHeader, 1, 2, fd) != 2)
+                return false;
+            unsigned int segmentLength = __ReadBigEndian16(segmentHeader);
+            if (segmentLength < 2)
+                return false;
+            
+            if (__IsJPEGStartOfFrame(marker)) {
+                //length, precision, height, width
+                if (fread(segmentHeader + 2, 1, 5, fd) != 5)
+                    return false;
+                metadata.height = __ReadBigEndian16(segmentHeader + 3);
+                metadata.width = __ReadBigEndian16(segmentHeader + 5);
+                return true;
+            }
+            
+            if (fseek(fd, (long)segmentLength - 2, SEEK_CUR) != 0)
+                return false;
+        }
+    }
+    
+    //---- TGA -------------------------------------------------------------------
+    
+    //TGA has no signature (the footer of version 2 is optional), files are recognized by their extension and a consistent header
+    static bool __ReadTGAMetadata(const std::string& path, const unsigned char *header, size_t headerLength, ImageMetadata& metadata)
+    {
+        if (!__HasExtension(path, ".tga") || (headerLength < 18))
+            return false;
+        
+        unsigned int colorMapType = header[1];
+        unsigned int imageType = header[2];
+        unsigned int colorMapEntrySize = header[7];
+        unsigned int pixelDepth = header[16];
+        unsigned int alphaBitsCount = header[17] & 0x0F;
+        
+        //color mapped, true color and grayscale, raw or run length encoded
+        bool isColorMapped = (imageType == 1) || (imageType == 9);
+        bool isKnownImageType = isColorMapped || (imageType == 2) || (imageType == 3) || (imageType == 10) || (imageType == 11);
+        if ((colorMapType > 1) || !isKnownImageType)
+            return false;
+        
+        metadata.width = __ReadLittleEndian16(header + 12);
+        metadata.height = __ReadLittleEndian16(header + 14);
+        //some writers leave the count of alpha bits to 0 for 32 bits pixels
+        metadata.hasAlpha = (alphaBitsCount > 0) || (isColorMapped ? (colorMapEntrySize == 32) : (pixelDepth == 32));
+        
+        return true;
+    }
+    
+    //---- DDS -------------------------------------------------------------------
+    
+    static const unsigned int kDDSAlphaPixelsFlag = 0x1;
+    static const unsigned int kDDSAlphaFlag = 0x2;
+    static const unsigned int kDDSFourCCFlag = 0x4;
+    
+    static bool __IsDDS(const unsigned char *header, size_t headerLength)
+    {
+        return (headerLength >= 128) && (memcmp(header, "DDS ", 4) == 0) && (__ReadLittleEndian32(header + 4) == 124);
+    }
+    
+    //DXGI formats always storing alpha. BC7 blocks may or not, like DXT1 they are considered opaque.
+    static bool __DXGIFormatHasAlpha(unsigned int format)
+    {
+        return ((format >= 1) && (format <= 4)) ||     //R32G32B32A32
+               ((format >= 9) && (format <= 14)) ||    //R16G16B16A16
+               ((format >= 23) && (format <= 25)) ||   //R10G10B10A2
+               ((format >= 27) && (format <= 32)) ||   //R8G8B8A8
+               (format == 65) ||                       //A8
+               ((format >= 73) && (format <= 78)) ||   //BC2, BC3
+               (format == 86) || (format == 87) ||     //B5G5R5A1, B8G8R8A8
+               (format == 89) ||                       //R10G10B10_XR_BIAS_A2
+               (format == 90) || (format == 91) ||     //B8G8R8A8 typeless and sRGB
+               (format == 115);                        //B4G4R4A4
+    }
+    
+    static bool __ReadDDSMetadata(const unsigned char *header, size_t headerLength, ImageMetadata& metadata)
+    {
+        //the header follows the magic, the pixel format is at its offset 72
+        metadata.height = __ReadLittleEndian32(header + 12);
+        metadata.width = __ReadLittleEndian32(header + 16);
+        
+        unsigned int pixelFormatFlags = __ReadLittleEndian32(header + 80);
+        const unsigned char *fourCC = header + 84;
+        
+        if (pixelFormatFlags & kDDSFourCCFlag) {
+            if (memcmp(fourCC, "DX10", 4) == 0) {
+                if (headerLength < 148)
+                    return false;
+                metadata.hasAlpha = __DXGIFormatHasAlpha(__ReadLittleEndian32(header + 128));
+            } else {
+                metadata.hasAlpha = (memcmp(fourCC, "DXT2", 4) == 0) ||
+                                    (memcmp(fourCC, "DXT3", 4) == 0) ||
+                                    (memcmp(fourCC, "DXT4", 4) == 0) ||
+                                    (memcmp(fourCC, "DXT5", 4) == 0);
+            }
+        } else {
+            metadata.hasAlpha = (pixelFormatFlags & (kDDSAlphaPixelsFlag | kDDSAlphaFlag)) != 0;
+        }
+        
+        return true;
+    }
+    
+    //---- metadata --------------------------------------------------------------
+    
+    bool readImageMetadata(const std::string& path, ImageMetadata& metadata)
+    {
+        ProfilerScope profilerScope(IMAGE_PROBING_PHASE);
+        
+        FILE* fd = fopen(path.c_str(), "rb");
+        if (!fd)
+            return false;
+        
+        unsigned char header[kImageHeaderMaxLength];
+        size_t headerLength = fread(header, 1, sizeof(header), fd);
+        
+        ImageMetadata readMetadata;
+        readMetadata.format = UNKNOWN_IMAGE_FORMAT;
+        readMetadata.width = 0;
+        readMetadata.height = 0;
+        readMetadata.hasAlpha = false;
+        
+        if (__IsPNG(header, headerLength)) {
+            if (__ReadPNGMetadata(fd, header, headerLength, readMetadata))
+                readMetadata.format = PNG_IMAGE_FORMAT;
+        } else if (__IsJPEG(header, headerLength)) {
+            if (__ReadJPEGMetadata(fd, readMetadata))
+                readMetadata.format = JPEG_IMAGE_FORMAT;
+        } else if (__IsDDS(header, headerLength)) {
+            if (__ReadDDSMetadata(header, headerLength, readMetadata))
+                readMetadata.format = DDS_IMAGE_FORMAT;
+        } else if (__ReadTGAMetadata(path, header, headerLength, readMetadata)) {
+            readMetadata.format = TGA_IMAGE_FORMAT;
+        }
+        
+        fclose(fd);
+        
+        if (readMetadata.format == UNKNOWN_IMAGE_FORMAT)
+            return false;
+        
+        metadata = readMetadata;
+        return true;
+    }
+    
+    typedef struct {
+        time_t modificationTime;
+        bool succeeded;
+        ImageMetadata metadata;
+    } ImageMetadataEntry;
+    
+    typedef std::map <std::string, ImageMetadataEntry> PathToImageMetadataEntry;
+    
+    static PathToImageMetadataEntry __pathToImageMetadataEntry;
+#ifndef WIN32
+    static pthread_mutex_t __imageMetadataMutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+    
+    static void __LockImageMetadata()
+    {
+#ifndef WIN32
+        pthread_mutex_lock(&__imageMetadataMutex);
+#endif
+    }
+    
+    static void __UnlockImageMetadata()
+    {
+#ifndef WIN32
+        pthread_mutex_unlock(&__imageMetadataMutex);
+#endif
+    }
+    
+    static bool __GetModificationTime(const std::string& path, time_t *modificationTime)
+    {
+#ifdef WIN32
+        struct _stat status;
+        if (_stat(path.c_str(), &status) != 0)
+            return false;
+#else
+        struct stat status;
+        if (stat(path.c_str(), &status) != 0)
+            return false;
+#endif
+        *modificationTime = status.st_mtime;
+        return true;
+    }
+    
+    bool getImageMetadata(const std::string& path, ImageMetadata& metadata)
+    {
+        time_t modificationTime;
+        if (!__GetModificationTime(path, &modificationTime))
+            return false;
+        
+        __LockImageMetadata();
+        PathToImageMetadataEntry::const_iterator entryIterator = __pathToImageMetadataEntry.find(path);
+        if ((entryIterator != __pathToImageMetadataEntry.end()) && (entryIterator->second.modificationTime == modificationTime)) {
+            bool succeeded = entryIterator->second.succeeded;
+            if (succeeded)
+                metadata = entryIterator->second.metadata;
+            __UnlockImageMetadata();
+            return succeeded;
+        }
+        __UnlockImageMetadata();
+        
+        //read without holding the lock, so that images get probed concurrently. The same image may then be read twice, with the same result.
+        ImageMetadataEntry entry;
+        entry.modificationTime = modificationTime;
+        entry.succeeded = readImageMetadata(path, entry.metadata);
+        
+        __LockImageMetadata();
+        __pathToImageMetadataEntry[path] = entry;
+        __UnlockImageMetadata();
+        
+        if (entry.succeeded)
+            metadata = entry.metadata;
+        return entry.succeeded;
+    }
+    
+    //--------------------------------------------------------------------
+    ImageProbingJob::ImageProbingJob(const std::string& path, Profiler *profiler) :
+    _path(path),
+    _profiler(profiler)
+    {
+    }
+    
+    ImageProbingJob::~ImageProbingJob()
+    {
+    }
+    
+    void ImageProbingJob::run()
+    {
+        Profiler *previousProfiler = Profiler::getCurrentProfiler();
+        Profiler::setCurrentProfiler(this->_profiler);
+        
+        ImageMetadata metadata;
+        getImageMetadata(this->_path, metadata);
+        
+        Profiler::setCurrentProfiler(previousProfiler);
+    }
+}
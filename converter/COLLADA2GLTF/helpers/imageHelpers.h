@@ -0,0 +1,73 @@
+// Copyright (c) Fabrice Robinet
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef __IMAGE_HELPERS_H__
+#define __IMAGE_HELPERS_H__
+
+namespace GLTF
+{
+    typedef enum {
+        UNKNOWN_IMAGE_FORMAT = 0,
+        PNG_IMAGE_FORMAT,
+        JPEG_IMAGE_FORMAT,
+        TGA_IMAGE_FORMAT,
+        DDS_IMAGE_FORMAT
+    } ImageFormat;
+    
+    typedef struct {
+        ImageFormat format;
+        unsigned int width;
+        unsigned int height;
+        bool hasAlpha;
+    } ImageMetadata;
+    
+    /*
+        Reads the format, dimensions and presence of alpha of the image at path from its header, and for PNG its chunks before the pixels,
+        without decoding it. Returns false if the file can't be read or its format is not one of ImageFormat.
+        DXT1 surfaces are considered opaque, their 1 bit alpha can only be told by decoding the blocks.
+     */
+    bool readImageMetadata(const std::string& path, ImageMetadata& metadata);
+    
+    /*
+        Same as readImageMetadata, memoized for the whole process by path and modification time of the file.
+        It can be called from any thread, batch conversions referencing the same images read them once.
+     */
+    bool getImageMetadata(const std::string& path, ImageMetadata& metadata);
+    
+    //fills the memoized metadata of an image ahead of getImageMetadata, recording into profiler
+    class ImageProbingJob : public Job
+    {
+    public:
+        ImageProbingJob(const std::string& path, Profiler *profiler);
+        virtual ~ImageProbingJob();
+        
+        virtual void run();
+        
+    private:
+        std::string _path;
+        Profiler *_profiler;
+    };
+}
+
+#endif
@@ -0,0 +1,193 @@
+// Copyright (c) Fabrice Robinet
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "GLTF.h"
+#ifndef WIN32
+#include <unistd.h>
+#endif
+#include "jobScheduler.h"
+
+namespace GLTF
+{
+    Job::Job() : _completed(false)
+    {
+    }
+    
+    Job::~Job()
+    {
+    }
+    
+#ifdef WIN32
+    
+    JobScheduler::JobScheduler(size_t threadsCount)
+    {
+    }
+    
+    JobScheduler::~JobScheduler()
+    {
+    }
+    
+    void JobScheduler::schedule(Job* job)
+    {
+        job->run();
+        job->_completed = true;
+    }
+    
+    void JobScheduler::waitForJob(Job* job)
+    {
+    }
+    
+    void JobScheduler::waitForAllJobs()
+    {
+    }
+    
+    size_t JobScheduler::getThreadsCount()
+    {
+        return 1;
+    }
+    
+    size_t JobScheduler::getHardwareThreadsCount()
+    {
+        return 1;
+    }
+    
+#else
+    
+    JobScheduler::JobScheduler(size_t threadsCount) :
+    _pendingJobsCount(0),
+    _shouldExit(false)
+    {
+        pthread_mutex_init(&this->_mutex, 0);
+        pthread_cond_init(&this->_jobQueuedCondition, 0);
+        pthread_cond_init(&this->_jobCompletedCondition, 0);
+        
+        if (threadsCount < 2)
+            return;
+        
+        for (size_t i = 0 ; i < threadsCount ; i++) {
+            pthread_t thread;
+            if (pthread_create(&thread, 0, JobScheduler::_workerThreadEntryPoint, this) != 0) {
+                printf("WARNING: could only start %d threads out of %d\n", (int)i, (int)threadsCount);
+                break;
+            }
+            this->_threads.push_back(thread);
+        }
+
+    }
+    
+    JobScheduler::~JobScheduler()
+    {
+        this->waitForAllJobs();
+        
+        pthread_mutex_lock(&this->_mutex);
+        this->_shouldExit = true;
+        pthread_cond_broadcast(&this->_jobQueuedCondition);
+        pthread_mutex_unlock(&this->_mutex);
+        
+        for (size_t i = 0 ; i < this->_threads.size() ; i++) {
+            pthread_join(this->_threads[i], 0);
+        }
+        
+        pthread_cond_destroy(&this->_jobCompletedCondition);
+        pthread_cond_destroy(&this->_jobQueuedCondition);
+        pthread_mutex_destroy(&this->_mutex);
+    }
+    
+    void* JobScheduler::_workerThreadEntryPoint(void* scheduler)
+    {
+        ((JobScheduler*)scheduler)->_workerThreadLoop();
+        return 0;
+    }
+    
+    void JobScheduler::_workerThreadLoop()
+    {
+        pthread_mutex_lock(&this->_mutex);
+        for (;;) {
+            while (this->_queuedJobs.empty() && !this->_shouldExit) {
+                pthread_cond_wait(&this->_jobQueuedCondition, &this->_mutex);
+            }
+            if (this->_queuedJobs.empty())
+                break;
+            
+            Job* job = this->_queuedJobs.front();
+            this->_queuedJobs.pop_front();
+            pthread_mutex_unlock(&this->_mutex);
+            
+            job->run();
+            
+            pthread_mutex_lock(&this->_mutex);
+            job->_completed = true;
+            this->_pendingJobsCount--;
+            pthread_cond_broadcast(&this->_jobCompletedCondition);
+        }
+        pthread_mutex_unlock(&this->_mutex);
+    }
+    
+    void JobScheduler::schedule(Job* job)
+    {
+        job->_completed = false;
+        
+        if (this->_threads.size() == 0) {
+            job->run();
+            job->_completed = true;
+            return;
+        }
+        
+        pthread_mutex_lock(&this->_mutex);
+        this->_queuedJobs.push_back(job);
+        this->_pendingJobsCount++;
+        pthread_cond_signal(&this->_jobQueuedCondition);
+        pthread_mutex_unlock(&this->_mutex);
+    }
+    
+    void JobScheduler::waitForJob(Job* job)
+    {
+        pthread_mutex_lock(&this->_mutex);
+        while (!job->_completed) {
+            pthread_cond_wait(&this->_jobCompletedCondition, &this->_mutex);
+        }
+        pthread_mutex_unlock(&this->_mutex);
+    }
+    
+    void JobScheduler::waitForAllJobs()
+    {
+        pthread_mutex_lock(&this->_mutex);
+        while (this->_pendingJobsCount > 0) {
+            pthread_cond_wait(&this->_jobCompletedCondition, &this->_mutex);
+        }
+        pthread_mutex_unlock(&this->_mutex);
+    }
+    
+    size_t JobScheduler::getThreadsCount()
+    {
+        return this->_threads.size() > 0 ? this->_threads.size() : 1;
+    }
+    
+    size_t JobScheduler::getHardwareThreadsCount()
+    {
+        long count = sysconf(_SC_NPROCESSORS_ONLN);
+        return count > 0 ? (size_t)count : 1;
+    }
+    
+#endif
+}
@@ -0,0 +1,88 @@
+// Copyright (c) Fabrice Robinet
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __JOB_SCHEDULER_H__
+#define __JOB_SCHEDULER_H__
+
+#ifndef WIN32
+#include <pthread.h>
+#endif
+
+namespace GLTF
+{
+    /*
+        A unit of work executed by a JobScheduler.
+        The scheduler doesn't own the jobs, they have to stay alive until they have been waited for.
+     */
+    class Job {
+    public:
+        Job();
+        virtual ~Job();
+        
+        virtual void run() = 0;
+        
+    private:
+        friend class JobScheduler;
+        bool _completed;
+    };
+    
+    /*
+        Fixed size pool of worker threads running the scheduled jobs in FIFO order.
+        With less than 2 threads, jobs are simply run by schedule() on the calling thread.
+        WIN32 builds always take this synchronous path for now.
+     */
+    class JobScheduler {
+    private:
+        JobScheduler(const JobScheduler&);
+        JobScheduler& operator=(const JobScheduler&);
+    public:
+        JobScheduler(size_t threadsCount);
+        virtual ~JobScheduler();
+        
+        void schedule(Job* job);
+        
+        //blocks until job completed, job must have been scheduled on this scheduler
+        void waitForJob(Job* job);
+        void waitForAllJobs();
+        
+        size_t getThreadsCount();
+        
+        static size_t getHardwareThreadsCount();
+        
+    private:
+#ifndef WIN32
+        static void* _workerThreadEntryPoint(void* scheduler);
+        void _workerThreadLoop();
+        
+        std::vector <pthread_t> _threads;
+        std::list <Job*> _queuedJobs;
+        size_t _pendingJobsCount;
+        bool _shouldExit;
+        pthread_mutex_t _mutex;
+        pthread_cond_t _jobQueuedCondition;
+        pthread_cond_t _jobCompletedCondition;
+#endif
+    };
+}
+
+#endif
@@ -0,0 +1,156 @@
+// Copyright (c) Fabrice Robinet
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "GLTF.h"
+#include <math.h>
+#include "keyframeHelpers.h"
+
+using namespace std::tr1;
+using namespace std;
+
+namespace GLTF
+{
+    //a segment skips at most this many keys, this bounds the cost of the interpolation checks on long linear runs
+    static const size_t kMaxSkippedKeys = 256;
+    
+    static void __AxisAngleToQuaternion(const double *axisAngle, double *quaternion)
+    {
+        double length = sqrt(axisAngle[0] * axisAngle[0] + axisAngle[1] * axisAngle[1] + axisAngle[2] * axisAngle[2]);
+        if (length == 0) {
+            quaternion[0] = quaternion[1] = quaternion[2] = 0;
+            quaternion[3] = 1;
+            return;
+        }
+        double s = sin(axisAngle[3] * 0.5) / length;
+        quaternion[0] = axisAngle[0] * s;
+        quaternion[1] = axisAngle[1] * s;
+        quaternion[2] = axisAngle[2] * s;
+        quaternion[3] = cos(axisAngle[3] * 0.5);
+    }
+    
+    //keys are compared in the space of the metric: as is for distances, as quaternions for axis angles
+    static void __ConvertToMetricSpace(const double *values, size_t componentsCount, KeyframeMetric metric, double *converted)
+    {
+        if (metric == AXIS_ANGLE_KEYFRAME_METRIC) {
+            __AxisAngleToQuaternion(values, converted);
+        } else {
+            for (size_t j = 0 ; j < componentsCount ; j++) {
+                converted[j] = values[j];
+            }
+        }
+    }
+    
+    static size_t __MetricSpaceComponentsCount(size_t componentsCount, KeyframeMetric metric)
+    {
+        return (metric == AXIS_ANGLE_KEYFRAME_METRIC) ? 4 : componentsCount;
+    }
+    
+    static double __MetricSpaceDistance(const double *a, const double *b, size_t componentsCount, KeyframeMetric metric)
+    {
+        if (metric == AXIS_ANGLE_KEYFRAME_METRIC) {
+            //q and -q are the same rotation
+            double cosHalfAngle = fabs(a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3]);
+            return 2. * acos(std::min(cosHalfAngle, 1.));
+        }
+        double squaredDistance = 0;
+        for (size_t j = 0 ; j < componentsCount ; j++) {
+            squaredDistance += (a[j] - b[j]) * (a[j] - b[j]);
+        }
+        return sqrt(squaredDistance);
+    }
+    
+    //true if linear interpolation between the keys first and last reproduces all the keys in between within tolerance
+    static bool __SegmentIsWithinTolerance(const float *times, const float *values, const double *convertedKeys,
+                                           size_t first, size_t last, size_t componentsCount,
+                                           KeyframeMetric metric, double tolerance)
+    {
+        size_t convertedComponentsCount = __MetricSpaceComponentsCount(componentsCount, metric);
+        const float *firstValues = values + (first * componentsCount);
+        const float *lastValues = values + (last * componentsCount);
+        double duration = (double)times[last] - (double)times[first];
+        double interpolated[4];
+        double convertedInterpolated[4];
+        
+        for (size_t i = first + 1 ; i < last ; i++) {
+            //keys sharing a time are steps, interpolation does not go through them
+            double u = (duration > 0) ? ((double)times[i] - (double)times[first]) / duration : 0;
+            for (size_t j = 0 ; j < componentsCount ; j++) {
+                interpolated[j] = firstValues[j] + (lastValues[j] - firstValues[j]) * u;
+            }
+            __ConvertToMetricSpace(interpolated, componentsCount, metric, convertedInterpolated);
+            if (__MetricSpaceDistance(convertedInterpolated, convertedKeys + (i * convertedComponentsCount), convertedComponentsCount, metric) > tolerance)
+                return false;
+        }
+        return true;
+    }
+    
+    void reduceKeyframes(const float *times, const float *values, size_t count, size_t componentsCount,
+                         KeyframeMetric metric, double tolerance, std::vector <unsigned int> &keptKeys)
+    {
+        keptKeys.clear();
+        if (count == 0)
+            return;
+        keptKeys.push_back(0);
+        
+        size_t convertedComponentsCount = __MetricSpaceComponentsCount(componentsCount, metric);
+        std::vector <double> convertedKeys(count * convertedComponentsCount);
+        double key[4];
+        for (size_t i = 0 ; i < count ; i++) {
+            for (size_t j = 0 ; j < componentsCount ; j++) {
+                key[j] = values[(i * componentsCount) + j];
+            }
+            __ConvertToMetricSpace(key, componentsCount, metric, &convertedKeys[i * convertedComponentsCount]);
+        }
+        
+        size_t firstVaryingKey = 1;
+        while ((firstVaryingKey < count) &&
+               (__MetricSpaceDistance(&convertedKeys[0], &convertedKeys[firstVaryingKey * convertedComponentsCount], convertedComponentsCount, metric) <= tolerance)) {
+            firstVaryingKey++;
+        }
+        if (firstVaryingKey == count)
+            return;
+        
+        //greedily extends each segment as long as it reproduces the keys it skips
+        size_t anchor = 0;
+        size_t last = 1;
+        while (last < (count - 1)) {
+            if (((last - anchor) <= kMaxSkippedKeys) &&
+                __SegmentIsWithinTolerance(times, values, &convertedKeys[0], anchor, last + 1, componentsCount, metric, tolerance)) {
+                last++;
+                continue;
+            }
+            keptKeys.push_back((unsigned int)last);
+            anchor = last;
+            last = anchor + 1;
+        }
+        keptKeys.push_back((unsigned int)(count - 1));
+    }
+    
+    void gatherKeyframes(const float *values, size_t componentsCount, const std::vector <unsigned int> &keptKeys, float *destination)
+    {
+        for (size_t i = 0 ; i < keptKeys.size() ; i++) {
+            memcpy(destination + (i * componentsCount), values + (keptKeys[i] * componentsCount), componentsCount * sizeof(float));
+        }
+    }
+}
@@ -0,0 +1,50 @@
+// Copyright (c) Fabrice Robinet
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef __KEYFRAME_HELPERS__
+#define __KEYFRAME_HELPERS__
+
+namespace GLTF
+{
+    typedef enum {
+        //euclidean distance between the values of keys, for translations and scales
+        DISTANCE_KEYFRAME_METRIC,
+        //angle in radians between the rotations of keys stored as axis (x,y,z) and angle
+        AXIS_ANGLE_KEYFRAME_METRIC
+    } KeyframeMetric;
+    
+    /*
+        Selects the keys of a linearly interpolated channel that are needed to reproduce all its keys within tolerance.
+        A channel has count keys at increasing times, each with componentsCount packed floats (1 to 4).
+        The first key is always kept. When every key is within tolerance of it the channel is constant and it is the only one kept,
+        otherwise the last key is kept too. The indices of the kept keys are written in increasing order to keptKeys.
+     */
+    void reduceKeyframes(const float *times, const float *values, size_t count, size_t componentsCount,
+                         KeyframeMetric metric, double tolerance, std::vector <unsigned int> &keptKeys);
+    
+    //copies the componentsCount floats of the kept keys to destination, packed
+    void gatherKeyframes(const float *values, size_t componentsCount, const std::vector <unsigned int> &keptKeys, float *destination);
+}
+
+#endif
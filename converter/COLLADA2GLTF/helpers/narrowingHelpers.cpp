@@ -0,0 +1,154 @@
+// Copyright (c) Fabrice Robinet
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "GLTF.h"
+#include "narrowingHelpers.h"
+#include "boundsHelpers.h"
+
+/*
+    SSE2 is part of x86-64, its kernel is built in and always used there. The AVX kernel is compiled for AVX only,
+    and selected at runtime on processors that run the AVX2 bounds kernel.
+ */
+#if defined(__x86_64__) || defined(_M_X64)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#define GLTF_NARROWING_SSE2 1
+#if (_MSC_VER >= 1700)
+#define GLTF_NARROWING_AVX 1
+#endif
+#define GLTF_TARGET_AVX
+#elif defined(__clang__) || (defined(__GNUC__) && ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 9))))
+#include <immintrin.h>
+#define GLTF_NARROWING_SSE2 1
+#define GLTF_NARROWING_AVX 1
+#define GLTF_TARGET_AVX __attribute__((target("avx")))
+#endif
+#endif
+
+using namespace std::tr1;
+using namespace std;
+
+namespace GLTF
+{
+    //packed vectors are converted in blocks of 12 doubles, a multiple of 1, 2, 3 and 4 components, so that offsets repeat the same way in each block
+    static const size_t kNarrowingBlockLength = 12;
+    
+    void computeDoublesCentroid(const double *source, size_t count, size_t componentsPerAttribute, double *centroid)
+    {
+        double sums[4] = { 0, 0, 0, 0 };
+        size_t counts[4] = { 0, 0, 0, 0 };
+        
+        for (size_t i = 0 ; i < count ; i++) {
+            const double *vector = source + (i * componentsPerAttribute);
+            for (size_t j = 0 ; j < componentsPerAttribute ; j++) {
+                double value = vector[j];
+                if (value == value) {
+                    sums[j] += value;
+                    counts[j]++;
+                }
+            }
+        }
+        
+        for (size_t j = 0 ; j < componentsPerAttribute ; j++) {
+            centroid[j] = (counts[j] > 0) ? sums[j] / (double)counts[j] : 0;
+        }
+    }
+    
+    static void __NarrowDoublesScalar(const double *source, size_t first, size_t last, const double *offsets, float *destination)
+    {
+        for (size_t i = first ; i < last ; i++) {
+            destination[i] = (float)(source[i] - offsets[i % kNarrowingBlockLength]);
+        }
+    }
+    
+#if GLTF_NARROWING_SSE2
+    static size_t __NarrowDoublesSSE2(const double *source, size_t valuesCount, const double *offsets, float *destination)
+    {
+        size_t blocksLength = valuesCount - (valuesCount % kNarrowingBlockLength);
+        __m128d offsets0 = _mm_loadu_pd(offsets), offsets1 = _mm_loadu_pd(offsets + 2), offsets2 = _mm_loadu_pd(offsets + 4);
+        __m128d offsets3 = _mm_loadu_pd(offsets + 6), offsets4 = _mm_loadu_pd(offsets + 8), offsets5 = _mm_loadu_pd(offsets + 10);
+        
+        for (size_t i = 0 ; i < blocksLength ; i += kNarrowingBlockLength) {
+            __m128 v0 = _mm_cvtpd_ps(_mm_sub_pd(_mm_loadu_pd(source + i), offsets0));
+            __m128 v1 = _mm_cvtpd_ps(_mm_sub_pd(_mm_loadu_pd(source + i + 2), offsets1));
+            __m128 v2 = _mm_cvtpd_ps(_mm_sub_pd(_mm_loadu_pd(source + i + 4), offsets2));
+            __m128 v3 = _mm_cvtpd_ps(_mm_sub_pd(_mm_loadu_pd(source + i + 6), offsets3));
+            __m128 v4 = _mm_cvtpd_ps(_mm_sub_pd(_mm_loadu_pd(source + i + 8), offsets4));
+            __m128 v5 = _mm_cvtpd_ps(_mm_sub_pd(_mm_loadu_pd(source + i + 10), offsets5));
+            //each conversion fills the 2 low floats
+            _mm_storeu_ps(destination + i, _mm_movelh_ps(v0, v1));
+            _mm_storeu_ps(destination + i + 4, _mm_movelh_ps(v2, v3));
+            _mm_storeu_ps(destination + i + 8, _mm_movelh_ps(v4, v5));
+        }
+        
+        return blocksLength;
+    }
+#endif
+    
+#if GLTF_NARROWING_AVX
+    GLTF_TARGET_AVX
+    static size_t __NarrowDoublesAVX(const double *source, size_t valuesCount, const double *offsets, float *destination)
+    {
+        size_t blocksLength = valuesCount - (valuesCount % kNarrowingBlockLength);
+        __m256d offsets0 = _mm256_loadu_pd(offsets), offsets1 = _mm256_loadu_pd(offsets + 4), offsets2 = _mm256_loadu_pd(offsets + 8);
+        
+        for (size_t i = 0 ; i < blocksLength ; i += kNarrowingBlockLength) {
+            _mm_storeu_ps(destination + i, _mm256_cvtpd_ps(_mm256_sub_pd(_mm256_loadu_pd(source + i), offsets0)));
+            _mm_storeu_ps(destination + i + 4, _mm256_cvtpd_ps(_mm256_sub_pd(_mm256_loadu_pd(source + i + 4), offsets1)));
+            _mm_storeu_ps(destination + i + 8, _mm256_cvtpd_ps(_mm256_sub_pd(_mm256_loadu_pd(source + i + 8), offsets2)));
+        }
+        _mm256_zeroupper();
+        
+        return blocksLength;
+    }
+#endif
+    
+#if GLTF_NARROWING_AVX
+    //selected during static initialization, so that it is never written once threads are running
+    static const bool kUseAVXNarrowing = isBoundsKernelSupported(AVX2_BOUNDS_KERNEL);
+#endif
+    
+    void narrowDoublesToFloats(const double *source, size_t count, size_t componentsPerAttribute, const double *offset, float *destination)
+    {
+        assert((componentsPerAttribute >= 1) && (componentsPerAttribute <= 4));
+        
+        double offsets[kNarrowingBlockLength];
+        for (size_t i = 0 ; i < kNarrowingBlockLength ; i++) {
+            offsets[i] = offset ? offset[i % componentsPerAttribute] : 0;
+        }
+        
+        size_t valuesCount = count * componentsPerAttribute;
+        size_t convertedCount = 0;
+#if GLTF_NARROWING_AVX
+        if (kUseAVXNarrowing)
+            convertedCount = __NarrowDoublesAVX(source, valuesCount, offsets, destination);
+#endif
+#if GLTF_NARROWING_SSE2
+        if (convertedCount == 0)
+            convertedCount = __NarrowDoublesSSE2(source, valuesCount, offsets, destination);
+#endif
+        __NarrowDoublesScalar(source, convertedCount, valuesCount, offsets, destination);
+    }
+}
@@ -0,0 +1,41 @@
+// Copyright (c) Fabrice Robinet
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef __NARROWING_HELPERS__
+#define __NARROWING_HELPERS__
+
+namespace GLTF
+{
+    //per component mean of count vectors of componentsPerAttribute doubles (1 to 4), NaN values are ignored
+    void computeDoublesCentroid(const double *source, size_t count, size_t componentsPerAttribute, double *centroid);
+    
+    /*
+        Converts count vectors of componentsPerAttribute packed doubles (1 to 4) to packed floats.
+        If offset is not 0, its componentsPerAttribute values are subtracted before the conversion, in double precision.
+        Runs with SSE2 or AVX on x86 processors supporting them, the results are the same as the scalar conversion.
+     */
+    void narrowDoublesToFloats(const double *source, size_t count, size_t componentsPerAttribute, const double *offset, float *destination);
+}
+
+#endif
@@ -0,0 +1,307 @@
+// Copyright (c) Fabrice Robinet
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "GLTF.h"
+#include "profiler.h"
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <time.h>
+#endif
+
+#if defined(__APPLE__)
+#include <malloc/malloc.h>
+#elif defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+using namespace std::tr1;
+using namespace std;
+
+namespace GLTF
+{
+#ifdef WIN32
+    static __declspec(thread) Profiler *__currentProfiler = 0;
+#else
+    static __thread Profiler *__currentProfiler = 0;
+#endif
+    
+    static const char* const kPhaseNames[PHASES_COUNT] = {
+        "parsing",
+        "geometries",
+        "triangulation",
+        "welding",
+        "splitting",
+        "simplification",
+        "meshBuffers",
+        "materials",
+        "shaders",
+        "imageProbing",
+        "animations",
+        "nodes",
+        "bufferAssembly",
+        "serialization"
+    };
+    
+    static const char* const kCounterNames[COUNTERS_COUNT] = {
+        "geometries",
+        "meshes",
+        "triangles",
+        "verticesBeforeWelding",
+        "verticesAfterWelding",
+        "images",
+        "animations",
+        "techniqueCacheHits",
+        "techniqueCacheMisses"
+    };
+    
+    //wall clock time in seconds
+    static double __WallClockTime()
+    {
+#ifdef WIN32
+        LARGE_INTEGER frequency, counter;
+        QueryPerformanceFrequency(&frequency);
+        QueryPerformanceCounter(&counter);
+        return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+        struct timeval tv;
+        gettimeofday(&tv, 0);
+        return (double)tv.tv_sec + ((double)tv.tv_usec * 1e-6);
+#endif
+    }
+    
+    //CPU time of the calling thread in seconds, or of the process where threads can't be told apart
+    static double __ThreadCPUTime()
+    {
+#ifdef WIN32
+        FILETIME creationTime, exitTime, kernelTime, userTime;
+        GetThreadTimes(GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime);
+        ULARGE_INTEGER kernel, user;
+        kernel.LowPart = kernelTime.dwLowDateTime;
+        kernel.HighPart = kernelTime.dwHighDateTime;
+        user.LowPart = userTime.dwLowDateTime;
+        user.HighPart = userTime.dwHighDateTime;
+        return (double)(kernel.QuadPart + user.QuadPart) * 1e-7;
+#elif defined(CLOCK_THREAD_CPUTIME_ID)
+        struct timespec ts;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+        return (double)ts.tv_sec + ((double)ts.tv_nsec * 1e-9);
+#else
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return (double)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) + ((double)(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6);
+#endif
+    }
+    
+    static double __ProcessCPUTime()
+    {
+#ifdef WIN32
+        FILETIME creationTime, exitTime, kernelTime, userTime;
+        GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime);
+        ULARGE_INTEGER kernel, user;
+        kernel.LowPart = kernelTime.dwLowDateTime;
+        kernel.HighPart = kernelTime.dwHighDateTime;
+        user.LowPart = userTime.dwLowDateTime;
+        user.HighPart = userTime.dwHighDateTime;
+        return (double)(kernel.QuadPart + user.QuadPart) * 1e-7;
+#else
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return (double)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) + ((double)(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6);
+#endif
+    }
+    
+    //bytes of heap in use by the process, 0 where the allocator can't tell
+    static size_t __HeapBytesInUse()
+    {
+#if defined(__APPLE__)
+        malloc_statistics_t statistics;
+        malloc_zone_statistics(0, &statistics);
+        return statistics.size_in_use;
+#elif defined(__GLIBC__) && ((__GLIBC__ > 2) || (__GLIBC_MINOR__ >= 33))
+        struct mallinfo2 info = mallinfo2();
+        return info.uordblks + info.hblkhd;
+#elif defined(__GLIBC__)
+        struct mallinfo info = mallinfo();
+        return (size_t)(unsigned int)info.uordblks + (size_t)(unsigned int)info.hblkhd;
+#else
+        return 0;
+#endif
+    }
+    
+    //peak resident set size of the process in bytes, 0 where it is not available
+    static size_t __PeakRSS()
+    {
+#ifdef WIN32
+        return 0;
+#else
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+        return (size_t)usage.ru_maxrss;
+#else
+        return (size_t)usage.ru_maxrss * 1024;
+#endif
+#endif
+    }
+    
+    //--------------------------------------------------------------------
+    Profiler::Profiler()
+    {
+        memset(this->_phases, 0, sizeof(this->_phases));
+        memset(this->_counters, 0, sizeof(this->_counters));
+#ifndef WIN32
+        pthread_mutex_init(&this->_mutex, 0);
+#endif
+        this->_start.wallTime = __WallClockTime();
+        this->_start.cpuTime = __ProcessCPUTime();
+        this->_start.heapBytes = __HeapBytesInUse();
+    }
+    
+    Profiler::~Profiler()
+    {
+#ifndef WIN32
+        pthread_mutex_destroy(&this->_mutex);
+#endif
+    }
+    
+    Profiler* Profiler::getCurrentProfiler()
+    {
+        return __currentProfiler;
+    }
+    
+    void Profiler::setCurrentProfiler(Profiler* profiler)
+    {
+        __currentProfiler = profiler;
+    }
+    
+    void Profiler::_lock()
+    {
+#ifndef WIN32
+        pthread_mutex_lock(&this->_mutex);
+#endif
+    }
+    
+    void Profiler::_unlock()
+    {
+#ifndef WIN32
+        pthread_mutex_unlock(&this->_mutex);
+#endif
+    }
+    
+    void Profiler::count(ProfilerCounter counter, size_t value)
+    {
+        Profiler *profiler = __currentProfiler;
+        if (!profiler)
+            return;
+        profiler->_lock();
+        profiler->_counters[counter] += value;
+        profiler->_unlock();
+    }
+    
+    void Profiler::_takeSample(Sample *sample)
+    {
+        sample->wallTime = __WallClockTime();
+        sample->cpuTime = __ThreadCPUTime();
+        sample->heapBytes = __HeapBytesInUse();
+    }
+    
+    void Profiler::_addPhase(ProfilerPhase phase, const Sample& start)
+    {
+        Sample end;
+        _takeSample(&end);
+        size_t peakRSS = __PeakRSS();
+        
+        this->_lock();
+        PhaseRecord& record = this->_phases[phase];
+        record.callsCount++;
+        record.wallTime += end.wallTime - start.wallTime;
+        record.cpuTime += end.cpuTime - start.cpuTime;
+        record.heapGrowthBytes += (double)end.heapBytes - (double)start.heapBytes;
+        record.peakRSS = std::max(record.peakRSS, peakRSS);
+        this->_unlock();
+    }
+    
+    shared_ptr <JSONObject> Profiler::createReport()
+    {
+        shared_ptr <JSONObject> report(new JSONObject());
+        
+        this->_lock();
+        
+        report->setDouble("wallTime", __WallClockTime() - this->_start.wallTime);
+        report->setDouble("cpuTime", __ProcessCPUTime() - this->_start.cpuTime);
+        report->setDouble("heapGrowthBytes", (double)__HeapBytesInUse() - (double)this->_start.heapBytes);
+        report->setDouble("peakRSS", (double)__PeakRSS());
+        
+        shared_ptr <JSONObject> phases(new JSONObject());
+        for (size_t i = 0 ; i < PHASES_COUNT ; i++) {
+            const PhaseRecord& record = this->_phases[i];
+            if (record.callsCount == 0)
+                continue;
+            shared_ptr <JSONObject> phase(new JSONObject());
+            phase->setUnsignedInt32("calls", (unsigned int)record.callsCount);
+            phase->setDouble("wallTime", record.wallTime);
+            phase->setDouble("cpuTime", record.cpuTime);
+            phase->setDouble("heapGrowthBytes", record.heapGrowthBytes);
+            phase->setDouble("peakRSS", (double)record.peakRSS);
+            phases->setValue(kPhaseNames[i], phase);
+        }
+        report->setValue("phases", phases);
+        
+        shared_ptr <JSONObject> counters(new JSONObject());
+        for (size_t i = 0 ; i < COUNTERS_COUNT ; i++) {
+            counters->setUnsignedInt32(kCounterNames[i], (unsigned int)this->_counters[i]);
+        }
+        report->setValue("counters", counters);
+        
+        this->_unlock();
+        
+        return report;
+    }
+    
+    //--------------------------------------------------------------------
+    ProfilerScope::ProfilerScope(ProfilerPhase phase) :
+    _profiler(__currentProfiler),
+    _phase(phase)
+    {
+        if (this->_profiler)
+            Profiler::_takeSample(&this->_start);
+    }
+    
+    ProfilerScope::~ProfilerScope()
+    {
+        this->end();
+    }
+    
+    void ProfilerScope::end()
+    {
+        if (this->_profiler) {
+            this->_profiler->_addPhase(this->_phase, this->_start);
+            this->_profiler = 0;
+        }
+    }
+}
@@ -0,0 +1,140 @@
+// Copyright (c) Fabrice Robinet
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+#ifndef WIN32
+#include <pthread.h>
+#endif
+
+namespace GLTF
+{
+    typedef enum {
+        PARSING_PHASE = 0,
+        GEOMETRIES_PHASE,
+        TRIANGULATION_PHASE,
+        WELDING_PHASE,
+        SPLITTING_PHASE,
+        SIMPLIFICATION_PHASE,
+        MESH_BUFFERS_PHASE,
+        MATERIALS_PHASE,
+        SHADERS_PHASE,
+        IMAGE_PROBING_PHASE,
+        ANIMATIONS_PHASE,
+        NODES_PHASE,
+        BUFFER_ASSEMBLY_PHASE,
+        SERIALIZATION_PHASE,
+        PHASES_COUNT
+    } ProfilerPhase;
+    
+    typedef enum {
+        GEOMETRIES_COUNTER = 0,
+        MESHES_COUNTER,
+        TRIANGLES_COUNTER,
+        VERTICES_BEFORE_WELDING_COUNTER,
+        VERTICES_AFTER_WELDING_COUNTER,
+        IMAGES_COUNTER,
+        ANIMATIONS_COUNTER,
+        TECHNIQUE_CACHE_HITS_COUNTER,
+        TECHNIQUE_CACHE_MISSES_COUNTER,
+        COUNTERS_COUNT
+    } ProfilerCounter;
+    
+    /*
+        Accumulates, per phase of a conversion, the wall time, the CPU time of the threads running it, the growth of the heap and the peak RSS,
+        along with counters about the converted content.
+        Phases nest (e.g welding runs within geometries when jobs run inline), the times of a phase include its nested phases.
+        Heap growth is the difference of the bytes in use at the end and at the start of a phase, allocations freed within the phase do not show.
+        It is process wide: phases running concurrently on other threads (mesh conversion jobs) show up in it too.
+        Each thread records into its current profiler, so helpers can be instrumented without being given one. A thread without
+        current profiler records nothing, profiling costs a thread local read when disabled.
+     */
+    class Profiler {
+    private:
+        Profiler(const Profiler&);
+        Profiler& operator=(const Profiler&);
+    public:
+        Profiler();
+        virtual ~Profiler();
+        
+        //profiler that ProfilerScope and count() record into, for the calling thread
+        static Profiler* getCurrentProfiler();
+        static void setCurrentProfiler(Profiler* profiler);
+        
+        static void count(ProfilerCounter counter, size_t value);
+        
+        shared_ptr <JSONObject> createReport();
+        
+    private:
+        friend class ProfilerScope;
+        
+        typedef struct {
+            double wallTime;
+            double cpuTime;
+            size_t heapBytes;
+        } Sample;
+        
+        typedef struct {
+            size_t callsCount;
+            double wallTime;
+            double cpuTime;
+            double heapGrowthBytes;
+            size_t peakRSS;
+        } PhaseRecord;
+        
+        static void _takeSample(Sample *sample);
+        void _addPhase(ProfilerPhase phase, const Sample& start);
+        void _lock();
+        void _unlock();
+        
+    private:
+        Sample _start;
+        PhaseRecord _phases[PHASES_COUNT];
+        size_t _counters[COUNTERS_COUNT];
+#ifndef WIN32
+        pthread_mutex_t _mutex;
+#endif
+    };
+    
+    //records the time and memory spent from its construction to its destruction into the current profiler of the thread, if any
+    class ProfilerScope {
+    private:
+        ProfilerScope(const ProfilerScope&);
+        ProfilerScope& operator=(const ProfilerScope&);
+    public:
+        ProfilerScope(ProfilerPhase phase);
+        ~ProfilerScope();
+        
+        //records the phase now instead of at destruction, for phases that don't end with a block
+        void end();
+        
+    private:
+        Profiler *_profiler;
+        ProfilerPhase _phase;
+        Profiler::Sample _start;
+    };
+}
+
+#endif
@@ -0,0 +1,223 @@
+// Copyright (c) Fabrice Robinet
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "GLTF.h"
+#include <math.h>
+#include <float.h>
+#include "quantizationHelpers.h"
+
+using namespace std::tr1;
+using namespace std;
+
+namespace GLTF
+{
+    static const unsigned int kMinQuantizationBits = 2;
+    static const unsigned int kMaxQuantizationBits = 16;
+    
+    static unsigned int __ClampBits(unsigned int bits)
+    {
+        return std::min(std::max(bits, kMinQuantizationBits), kMaxQuantizationBits);
+    }
+    
+    //NaN values are stored as 0
+    static inline double __QuantizeValue(double value, double minValue, double maxValue)
+    {
+        if (!(value == value))
+            return 0;
+        return std::min(std::max(floor(value + 0.5), minValue), maxValue);
+    }
+    
+    static void __SetQuantizedBuffer(GLTFMeshAttribute *meshAttribute, void *data, ComponentType componentType, size_t componentsPerAttribute, size_t componentByteLength)
+    {
+        size_t byteStride = componentsPerAttribute * componentByteLength;
+        meshAttribute->setBufferView(createBufferViewWithAllocatedBuffer(data, 0, byteStride * meshAttribute->getCount(), true));
+        meshAttribute->setComponentType(componentType);
+        meshAttribute->setComponentsPerAttribute(componentsPerAttribute);
+        meshAttribute->setByteStride(byteStride);
+        meshAttribute->setNormalized(true);
+    }
+    
+    static void __ComputeLinearQuantization(double min, double max, bool isSigned, double typeMaxValue, double maxValue,
+                                            double *decodeOffset, double *encodeScale, double *decodeScale)
+    {
+        double range = isSigned ? (max - min) * 0.5 : (max - min);
+        *decodeOffset = isSigned ? (min + max) * 0.5 : min;
+        *encodeScale = (range > 0) ? maxValue / range : 0;
+        *decodeScale = range * typeMaxValue / maxValue;
+    }
+    
+    /*
+        Signed types span [-max, max] around the center of the bounds, unsigned ones span [0, max] from the minimum.
+        Using less bits than the type holds keeps the range symmetric and the values multiple of the same step.
+     */
+    template <typename T>
+    static void __QuantizeLinearly(GLTFMeshAttribute *meshAttribute, ComponentType componentType, unsigned int bits)
+    {
+        size_t componentsPerAttribute = meshAttribute->getComponentsPerAttribute();
+        size_t count = meshAttribute->getCount();
+        bool isSigned = (componentType == SHORT);
+        double typeMaxValue = isSigned ? 32767. : 65535.;
+        double maxValue = isSigned ? (double)((1 << (bits - 1)) - 1) : (double)((1 << bits) - 1);
+        double minValue = isSigned ? -maxValue : 0;
+        
+        meshAttribute->computeMinMax();
+        const double *min = meshAttribute->getMin();
+        const double *max = meshAttribute->getMax();
+        
+        double decodeOffset[4], decodeScale[4], encodeScale[4];
+        for (size_t j = 0 ; j < componentsPerAttribute ; j++) {
+            //only NaN values
+            if (min[j] > max[j])
+                return;
+            __ComputeLinearQuantization(min[j], max[j], isSigned, typeMaxValue, maxValue, &decodeOffset[j], &encodeScale[j], &decodeScale[j]);
+        }
+        
+        const unsigned char *sourceData = (const unsigned char*)meshAttribute->getBufferView()->getBufferDataByApplyingOffset();
+        size_t sourceByteStride = meshAttribute->getByteStride();
+        T *quantizedData = (T*)malloc(count * componentsPerAttribute * sizeof(T));
+        for (size_t i = 0 ; i < count ; i++) {
+            const float *vector = (const float*)(sourceData + (i * sourceByteStride));
+            for (size_t j = 0 ; j < componentsPerAttribute ; j++) {
+                double value = ((double)vector[j] - decodeOffset[j]) * encodeScale[j];
+                quantizedData[(i * componentsPerAttribute) + j] = (T)__QuantizeValue(value, minValue, maxValue);
+            }
+        }
+        
+        __SetQuantizedBuffer(meshAttribute, quantizedData, componentType, componentsPerAttribute, sizeof(T));
+        meshAttribute->setDecodeTransform(decodeOffset, decodeScale, componentsPerAttribute);
+    }
+    
+    //folds the unit sphere onto the octahedron |x| + |y| + |z| = 1, then the lower half over the upper one, giving 2 components in [-1, 1]
+    template <typename T>
+    static void __QuantizeOctahedrally(GLTFMeshAttribute *meshAttribute, ComponentType componentType, unsigned int bits)
+    {
+        size_t count = meshAttribute->getCount();
+        double typeMaxValue = (componentType == BYTE) ? 127. : 32767.;
+        double maxValue = (double)((1 << (bits - 1)) - 1);
+        
+        const unsigned char *sourceData = (const unsigned char*)meshAttribute->getBufferView()->getBufferDataByApplyingOffset();
+        size_t sourceByteStride = meshAttribute->getByteStride();
+        T *quantizedData = (T*)malloc(count * 2 * sizeof(T));
+        for (size_t i = 0 ; i < count ; i++) {
+            const float *normal = (const float*)(sourceData + (i * sourceByteStride));
+            double x = normal[0], y = normal[1], z = normal[2];
+            double length = fabs(x) + fabs(y) + fabs(z);
+            double u = 0, v = 0;
+            //null (or NaN) normals end up as (0, 0, 1)
+            if (length > 0) {
+                u = x / length;
+                v = y / length;
+                if (z < 0) {
+                    double foldedU = (1 - fabs(v)) * ((u >= 0) ? 1 : -1);
+                    double foldedV = (1 - fabs(u)) * ((v >= 0) ? 1 : -1);
+                    u = foldedU;
+                    v = foldedV;
+                }
+            }
+            quantizedData[(i * 2)] = (T)__QuantizeValue(u * maxValue, -maxValue, maxValue);
+            quantizedData[(i * 2) + 1] = (T)__QuantizeValue(v * maxValue, -maxValue, maxValue);
+        }
+        
+        __SetQuantizedBuffer(meshAttribute, quantizedData, componentType, 2, sizeof(T));
+        
+        double decodeOffset[2] = { 0, 0 };
+        double decodeScale[2] = { typeMaxValue / maxValue, typeMaxValue / maxValue };
+        meshAttribute->setDecodeTransform(decodeOffset, decodeScale, 2);
+        meshAttribute->setOctahedralEncoding(true);
+    }
+    
+    void quantizeMeshAttributes(GLTFMesh *mesh, unsigned int positionBits, unsigned int normalBits, unsigned int texcoordBits)
+    {
+        vector <GLTF::Semantic> allSemantics = mesh->allSemantics();
+        for (size_t i = 0 ; i < allSemantics.size() ; i++) {
+            GLTF::Semantic semantic = allSemantics[i];
+            IndexSetToMeshAttributeHashmap& indexSetToMeshAttribute = mesh->getMeshAttributesForSemantic(semantic);
+            IndexSetToMeshAttributeHashmap::const_iterator meshAttributeIterator;
+            for (meshAttributeIterator = indexSetToMeshAttribute.begin() ; meshAttributeIterator != indexSetToMeshAttribute.end() ; meshAttributeIterator++) {
+                shared_ptr <GLTFMeshAttribute> meshAttribute = (*meshAttributeIterator).second;
+                size_t componentsPerAttribute = meshAttribute->getComponentsPerAttribute();
+                if ((meshAttribute->getComponentType() != GLTF::FLOAT) || (meshAttribute->getCount() == 0) ||
+                    (componentsPerAttribute < 1) || (componentsPerAttribute > 4))
+                    continue;
+                
+                switch (semantic) {
+                    case GLTF::POSITION:
+                        if (positionBits != 0)
+                            __QuantizeLinearly<short>(meshAttribute.get(), GLTF::SHORT, __ClampBits(positionBits));
+                        break;
+                    case GLTF::NORMAL:
+                        if ((normalBits != 0) && (componentsPerAttribute == 3)) {
+                            if (__ClampBits(normalBits) <= 8) {
+                                __QuantizeOctahedrally<signed char>(meshAttribute.get(), GLTF::BYTE, __ClampBits(normalBits));
+                            } else {
+                                __QuantizeOctahedrally<short>(meshAttribute.get(), GLTF::SHORT, __ClampBits(normalBits));
+                            }
+                        }
+                        break;
+                    case GLTF::TEXCOORD:
+                        if (texcoordBits != 0)
+                            __QuantizeLinearly<unsigned short>(meshAttribute.get(), GLTF::UNSIGNED_SHORT, __ClampBits(texcoordBits));
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+    
+    void quantizeFloats(const float *values, size_t count, size_t componentsCount, unsigned int bits,
+                        short *quantized, double *decodeOffset, double *decodeScale)
+    {
+        bits = __ClampBits(bits);
+        double maxValue = (double)((1 << (bits - 1)) - 1);
+        
+        double min[4], max[4], encodeScale[4];
+        for (size_t j = 0 ; j < componentsCount ; j++) {
+            min[j] = DBL_MAX;
+            max[j] = -DBL_MAX;
+        }
+        for (size_t i = 0 ; i < count ; i++) {
+            for (size_t j = 0 ; j < componentsCount ; j++) {
+                double value = values[(i * componentsCount) + j];
+                if (value < min[j])
+                    min[j] = value;
+                if (value > max[j])
+                    max[j] = value;
+            }
+        }
+        for (size_t j = 0 ; j < componentsCount ; j++) {
+            //only NaN values
+            if (min[j] > max[j])
+                min[j] = max[j] = 0;
+            __ComputeLinearQuantization(min[j], max[j], true, 32767., maxValue, &decodeOffset[j], &encodeScale[j], &decodeScale[j]);
+        }
+        
+        for (size_t i = 0 ; i < count ; i++) {
+            for (size_t j = 0 ; j < componentsCount ; j++) {
+                double value = ((double)values[(i * componentsCount) + j] - decodeOffset[j]) * encodeScale[j];
+                quantized[(i * componentsCount) + j] = (short)__QuantizeValue(value, -maxValue, maxValue);
+            }
+        }
+    }
+}
@@ -0,0 +1,47 @@
+// Copyright (c) Fabrice Robinet
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef __QUANTIZATION_HELPERS__
+#define __QUANTIZATION_HELPERS__
+
+namespace GLTF
+{
+    /*
+        Replaces the float attributes of mesh by normalized integers, bits counts are in [2, 16] and 0 keeps the semantic as floats:
+        - positions become SHORT, spanning the bounds of each component
+        - normals are octahedron encoded into 2 BYTE (up to 8 bits) or 2 SHORT
+        - texcoords become UNSIGNED_SHORT, spanning the bounds of each component
+        The decode transform set on each attribute restores the original values, up to the quantization error.
+     */
+    void quantizeMeshAttributes(GLTFMesh *mesh, unsigned int positionBits, unsigned int normalBits, unsigned int texcoordBits);
+    
+    /*
+        Quantizes count vectors of componentsCount packed floats (1 to 4) to shorts read as normalized, using bits in [2, 16],
+        each component spanning its bounds. Writes the decode transform of each component to decodeOffset and decodeScale.
+     */
+    void quantizeFloats(const float *values, size_t count, size_t componentsCount, unsigned int bits,
+                        short *quantized, double *decodeOffset, double *decodeScale);
+}
+
+#endif
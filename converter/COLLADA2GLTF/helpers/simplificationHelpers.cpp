@@ -0,0 +1,553 @@
+// Copyright (c) Fabrice Robinet
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "GLTF.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <queue>
+#include "simplificationHelpers.h"
+#include "geometryHelpers.h"
+#include "profiler.h"
+
+using namespace rapidjson;
+using namespace std::tr1;
+using namespace std;
+
+namespace GLTF
+{
+    //seams and borders are kept in place by planes orthogonal to the surface going through their edges, weighted this much more than the surface
+    static const double kSeamWeight = 10.;
+    //a collapse may not turn a remaining triangle by more than 60 degrees
+    static const double kMinNormalsCosine = 0.5;
+    //nor make it a sliver: twice its area over the sum of its squared edges lengths is ~0.29 for an equilateral triangle
+    static const double kMinTriangleQuality = 0.01;
+    
+    static const unsigned int kNoVertex = 0xFFFFFFFF;
+    
+    //symmetric 4x4 matrix of the squared distances to a set of planes
+    typedef struct {
+        double a00, a01, a02, a03, a11, a12, a13, a22, a23, a33;
+    } Quadric;
+    
+    static void __AddPlaneToQuadric(Quadric *quadric, const double *normal, double distance, double weight)
+    {
+        double a = normal[0], b = normal[1], c = normal[2], d = distance;
+        quadric->a00 += weight * a * a; quadric->a01 += weight * a * b; quadric->a02 += weight * a * c; quadric->a03 += weight * a * d;
+        quadric->a11 += weight * b * b; quadric->a12 += weight * b * c; quadric->a13 += weight * b * d;
+        quadric->a22 += weight * c * c; quadric->a23 += weight * c * d;
+        quadric->a33 += weight * d * d;
+    }
+    
+    static void __AddQuadric(Quadric *quadric, const Quadric &other)
+    {
+        quadric->a00 += other.a00; quadric->a01 += other.a01; quadric->a02 += other.a02; quadric->a03 += other.a03;
+        quadric->a11 += other.a11; quadric->a12 += other.a12; quadric->a13 += other.a13;
+        quadric->a22 += other.a22; quadric->a23 += other.a23;
+        quadric->a33 += other.a33;
+    }
+    
+    static double __QuadricError(const Quadric &q, const double *p)
+    {
+        double x = p[0], y = p[1], z = p[2];
+        double error = (q.a00 * x * x) + (2 * q.a01 * x * y) + (2 * q.a02 * x * z) + (2 * q.a03 * x) +
+                       (q.a11 * y * y) + (2 * q.a12 * y * z) + (2 * q.a13 * y) +
+                       (q.a22 * z * z) + (2 * q.a23 * z) +
+                       q.a33;
+        return fabs(error);
+    }
+    
+    static void __Cross(const double *u, const double *v, double *result)
+    {
+        result[0] = (u[1] * v[2]) - (u[2] * v[1]);
+        result[1] = (u[2] * v[0]) - (u[0] * v[2]);
+        result[2] = (u[0] * v[1]) - (u[1] * v[0]);
+    }
+    
+    static double __Dot(const double *u, const double *v)
+    {
+        return (u[0] * v[0]) + (u[1] * v[1]) + (u[2] * v[2]);
+    }
+    
+    static void __TriangleNormal(const double *p0, const double *p1, const double *p2, double *normal)
+    {
+        double e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+        double e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+        __Cross(e1, e2, normal);
+    }
+    
+    static double __TriangleQuality(const double *p0, const double *p1, const double *p2, const double *normal)
+    {
+        double e0[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+        double e1[3] = { p2[0] - p1[0], p2[1] - p1[1], p2[2] - p1[2] };
+        double e2[3] = { p0[0] - p2[0], p0[1] - p2[1], p0[2] - p2[2] };
+        double edgesLength = __Dot(e0, e0) + __Dot(e1, e1) + __Dot(e2, e2);
+        return (edgesLength > 0) ? sqrt(__Dot(normal, normal)) / edgesLength : 0;
+    }
+    
+    static unsigned long long __EdgeKey(unsigned int a, unsigned int b)
+    {
+        return (a < b) ? (((unsigned long long)a << 32) | b) : (((unsigned long long)b << 32) | a);
+    }
+    
+    //how many times the edge of key appears in sortedEdges
+    static size_t __EdgeCount(const std::vector <unsigned long long> &sortedEdges, unsigned long long key)
+    {
+        std::pair <std::vector <unsigned long long>::const_iterator, std::vector <unsigned long long>::const_iterator> range;
+        range = std::equal_range(sortedEdges.begin(), sortedEdges.end(), key);
+        return range.second - range.first;
+    }
+    
+    typedef struct {
+        unsigned int bits[3];
+        unsigned int vertex;
+    } PositionKey;
+    
+    static bool __PositionKeyIsLess(const PositionKey &a, const PositionKey &b)
+    {
+        for (size_t i = 0 ; i < 3 ; i++) {
+            if (a.bits[i] != b.bits[i])
+                return a.bits[i] < b.bits[i];
+        }
+        return a.vertex < b.vertex;
+    }
+    
+    typedef struct {
+        double cost;
+        unsigned int from, to;
+        unsigned int fromVersion, toVersion;
+    } Collapse;
+    
+    //std::priority_queue puts the largest first, the cheapest collapse has to
+    struct __CollapseCostIsGreater {
+        bool operator()(const Collapse &a, const Collapse &b) const { return a.cost > b.cost; }
+    };
+    
+    /*
+        Vertices are collapsed by position: a position gathers the vertices sharing it, more than one means the position is on an attribute seam.
+        Moving position from onto position to replaces each vertex of from by a vertex of to it has an edge with, this way attributes are never mixed across a seam.
+     */
+    class Simplifier {
+    public:
+        Simplifier(const float *positions, size_t positionsByteStride, size_t verticesCount, const std::vector <unsigned int> &corners) :
+        _corners(corners),
+        _trianglesCount(corners.size() / 3)
+        {
+            this->_weldPositions(positions, positionsByteStride, verticesCount);
+            
+            size_t trianglesCount = this->_trianglesCount;
+            size_t positionsCount = this->_positions.size() / 3;
+            this->_isTriangleAlive.assign(trianglesCount, true);
+            this->_positionTriangles.resize(positionsCount);
+            this->_versions.assign(positionsCount, 0);
+            this->_isRemoved.assign(positionsCount, false);
+            this->_isBorder.assign(positionsCount, false);
+            Quadric zero = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+            this->_quadrics.assign(positionsCount, zero);
+            
+            std::vector <unsigned long long> vertexEdges;
+            vertexEdges.reserve(trianglesCount * 3);
+            this->_positionEdges.reserve(trianglesCount * 3);
+            for (size_t t = 0 ; t < trianglesCount ; t++) {
+                for (size_t k = 0 ; k < 3 ; k++) {
+                    unsigned int vertex = this->_corners[(t * 3) + k];
+                    unsigned int nextVertex = this->_corners[(t * 3) + ((k + 1) % 3)];
+                    vertexEdges.push_back(__EdgeKey(vertex, nextVertex));
+                    this->_positionEdges.push_back(__EdgeKey(this->_vertexPosition[vertex], this->_vertexPosition[nextVertex]));
+                    this->_positionTriangles[this->_vertexPosition[vertex]].push_back((unsigned int)t);
+                }
+            }
+            std::sort(vertexEdges.begin(), vertexEdges.end());
+            std::sort(this->_positionEdges.begin(), this->_positionEdges.end());
+            
+            for (size_t t = 0 ; t < trianglesCount ; t++) {
+                double normal[3];
+                this->_normal(t, kNoVertex, 0, normal);
+                double length = sqrt(__Dot(normal, normal));
+                if (length == 0)
+                    continue;
+                double unitNormal[3] = { normal[0] / length, normal[1] / length, normal[2] / length };
+                
+                for (size_t k = 0 ; k < 3 ; k++) {
+                    unsigned int vertex = this->_corners[(t * 3) + k];
+                    unsigned int nextVertex = this->_corners[(t * 3) + ((k + 1) % 3)];
+                    unsigned int position = this->_vertexPosition[vertex];
+                    unsigned int nextPosition = this->_vertexPosition[nextVertex];
+                    const double *p = &this->_positions[position * 3];
+                    
+                    //the area weighted plane of the triangle
+                    __AddPlaneToQuadric(&this->_quadrics[position], unitNormal, -__Dot(unitNormal, p), length * 0.5);
+                    
+                    //edges used by a single triangle are either on a seam (used once for each side) or on a border
+                    if ((position != nextPosition) && (__EdgeCount(vertexEdges, __EdgeKey(vertex, nextVertex)) == 1)) {
+                        const double *nextP = &this->_positions[nextPosition * 3];
+                        double edge[3] = { nextP[0] - p[0], nextP[1] - p[1], nextP[2] - p[2] };
+                        double edgeNormal[3];
+                        __Cross(edge, unitNormal, edgeNormal);
+                        double edgeNormalLength = sqrt(__Dot(edgeNormal, edgeNormal));
+                        if (edgeNormalLength > 0) {
+                            double unitEdgeNormal[3] = { edgeNormal[0] / edgeNormalLength, edgeNormal[1] / edgeNormalLength, edgeNormal[2] / edgeNormalLength };
+                            double weight = __Dot(edge, edge) * kSeamWeight;
+                            __AddPlaneToQuadric(&this->_quadrics[position], unitEdgeNormal, -__Dot(unitEdgeNormal, p), weight);
+                            __AddPlaneToQuadric(&this->_quadrics[nextPosition], unitEdgeNormal, -__Dot(unitEdgeNormal, p), weight);
+                        }
+                        if (__EdgeCount(this->_positionEdges, __EdgeKey(position, nextPosition)) == 1) {
+                            this->_isBorder[position] = true;
+                            this->_isBorder[nextPosition] = true;
+                        }
+                    }
+                }
+            }
+        }
+        
+        //returns the count of triangles left
+        size_t simplify(size_t targetTrianglesCount)
+        {
+            size_t aliveTrianglesCount = this->_trianglesCount;
+            
+            for (size_t i = 0 ; i < this->_positionEdges.size() ; i++) {
+                if ((i > 0) && (this->_positionEdges[i] == this->_positionEdges[i - 1]))
+                    continue;
+                unsigned int position = (unsigned int)(this->_positionEdges[i] >> 32);
+                unsigned int nextPosition = (unsigned int)(this->_positionEdges[i] & 0xFFFFFFFF);
+                if (position != nextPosition) {
+                    this->_pushCollapse(position, nextPosition);
+                    this->_pushCollapse(nextPosition, position);
+                }
+            }
+            
+            std::vector <unsigned int> remap;
+            while ((aliveTrianglesCount > targetTrianglesCount) && !this->_collapses.empty()) {
+                Collapse collapse = this->_collapses.top();
+                this->_collapses.pop();
+                
+                if (this->_isRemoved[collapse.from] || this->_isRemoved[collapse.to])
+                    continue;
+                //the collapses around a position are pushed again each time it changes
+                if ((collapse.fromVersion != this->_versions[collapse.from]) || (collapse.toVersion != this->_versions[collapse.to]))
+                    continue;
+                if (!this->_canCollapse(collapse.from, collapse.to, remap))
+                    continue;
+                
+                aliveTrianglesCount -= this->_collapse(collapse.from, collapse.to, remap);
+            }
+            
+            return aliveTrianglesCount;
+        }
+        
+        bool isTriangleAlive(size_t triangle) { return this->_isTriangleAlive[triangle]; }
+        const unsigned int* getTriangle(size_t triangle) { return &this->_corners[triangle * 3]; }
+        
+    private:
+        //gives an ID to each distinct position, compared bit by bit
+        void _weldPositions(const float *positions, size_t positionsByteStride, size_t verticesCount)
+        {
+            std::vector <PositionKey> keys(verticesCount);
+            for (size_t i = 0 ; i < verticesCount ; i++) {
+                memcpy(keys[i].bits, (const unsigned char*)positions + (i * positionsByteStride), sizeof(float) * 3);
+                keys[i].vertex = (unsigned int)i;
+            }
+            std::sort(keys.begin(), keys.end(), __PositionKeyIsLess);
+            
+            this->_vertexPosition.resize(verticesCount);
+            this->_positionVertices.resize(verticesCount);
+            for (size_t i = 0 ; i < verticesCount ; i++) {
+                if ((i == 0) || (memcmp(keys[i].bits, keys[i - 1].bits, sizeof(keys[i].bits)) != 0)) {
+                    const float *position = (const float*)keys[i].bits;
+                    this->_positions.push_back(position[0]);
+                    this->_positions.push_back(position[1]);
+                    this->_positions.push_back(position[2]);
+                    this->_positionFirstVertex.push_back((unsigned int)i);
+                }
+                this->_positionVertices[i] = keys[i].vertex;
+                this->_vertexPosition[keys[i].vertex] = (unsigned int)(this->_positionFirstVertex.size() - 1);
+            }
+            this->_positionFirstVertex.push_back((unsigned int)verticesCount);
+        }
+        
+        //normal of triangle, with the vertices at position from moved to position to (unless from is kNoVertex). Returns its quality
+        double _normal(size_t triangle, unsigned int from, unsigned int to, double *normal)
+        {
+            const double *p[3];
+            for (size_t k = 0 ; k < 3 ; k++) {
+                unsigned int position = this->_vertexPosition[this->_corners[(triangle * 3) + k]];
+                p[k] = &this->_positions[((position == from) ? to : position) * 3];
+            }
+            __TriangleNormal(p[0], p[1], p[2], normal);
+            return __TriangleQuality(p[0], p[1], p[2], normal);
+        }
+        
+        bool _triangleHasPosition(size_t triangle, unsigned int position)
+        {
+            const unsigned int *corners = &this->_corners[triangle * 3];
+            return (this->_vertexPosition[corners[0]] == position) || (this->_vertexPosition[corners[1]] == position) || (this->_vertexPosition[corners[2]] == position);
+        }
+        
+        void _pushCollapse(unsigned int from, unsigned int to)
+        {
+            Collapse collapse;
+            collapse.cost = __QuadricError(this->_quadrics[from], &this->_positions[to * 3]);
+            collapse.from = from;
+            collapse.to = to;
+            collapse.fromVersion = this->_versions[from];
+            collapse.toVersion = this->_versions[to];
+            this->_collapses.push(collapse);
+        }
+        
+        /*
+            Checks the seam, border and flip constraints.
+            On success, remap holds for each vertex of from the vertex of to replacing it (kNoVertex if the vertex is not used anymore).
+         */
+        bool _canCollapse(unsigned int from, unsigned int to, std::vector <unsigned int> &remap)
+        {
+            const std::vector <unsigned int> &triangles = this->_positionTriangles[from];
+            unsigned int firstVertex = this->_positionFirstVertex[from];
+            unsigned int verticesCount = this->_positionFirstVertex[from + 1] - firstVertex;
+            remap.assign(verticesCount, kNoVertex);
+            std::vector <unsigned char> &isVertexUsed = this->_isVertexUsed;
+            isVertexUsed.assign(verticesCount, 0);
+            size_t sharedTrianglesCount = 0;
+            
+            for (size_t i = 0 ; i < triangles.size() ; i++) {
+                size_t triangle = triangles[i];
+                if (!this->_isTriangleAlive[triangle])
+                    continue;
+                const unsigned int *corners = &this->_corners[triangle * 3];
+                
+                if (this->_triangleHasPosition(triangle, to)) {
+                    sharedTrianglesCount++;
+                    //the vertex of from is replaced by the vertex of to it is connected to
+                    for (size_t k = 0 ; k < 3 ; k++) {
+                        if (this->_vertexPosition[corners[k]] != from)
+                            continue;
+                        for (size_t j = 0 ; j < 3 ; j++) {
+                            if (this->_vertexPosition[corners[j]] == to) {
+                                unsigned int slot = this->_vertexSlot(corners[k], from);
+                                if (remap[slot] == kNoVertex)
+                                    remap[slot] = corners[j];
+                            }
+                        }
+                    }
+                } else {
+                    double before[3], after[3];
+                    double qualityBefore = this->_normal(triangle, kNoVertex, 0, before);
+                    double qualityAfter = this->_normal(triangle, from, to, after);
+                    double dot = __Dot(before, after);
+                    if (dot <= kMinNormalsCosine * sqrt(__Dot(before, before) * __Dot(after, after)))
+                        return false;
+                    if ((qualityAfter < kMinTriangleQuality) && (qualityAfter < qualityBefore))
+                        return false;
+                }
+                for (size_t k = 0 ; k < 3 ; k++) {
+                    if (this->_vertexPosition[corners[k]] == from)
+                        isVertexUsed[this->_vertexSlot(corners[k], from)] = 1;
+                }
+            }
+            
+            if (sharedTrianglesCount == 0)
+                return false;
+            //a border position only moves along its border
+            if (this->_isBorder[from] && (sharedTrianglesCount != 1))
+                return false;
+            //every vertex still used needs a vertex to go to, otherwise its attributes would be lost
+            for (unsigned int i = 0 ; i < verticesCount ; i++) {
+                if (isVertexUsed[i] && (remap[i] == kNoVertex))
+                    return false;
+            }
+            return true;
+        }
+        
+        unsigned int _vertexSlot(unsigned int vertex, unsigned int position)
+        {
+            unsigned int first = this->_positionFirstVertex[position];
+            unsigned int last = this->_positionFirstVertex[position + 1];
+            for (unsigned int i = first ; i < last ; i++) {
+                if (this->_positionVertices[i] == vertex)
+                    return i - first;
+            }
+            return 0;
+        }
+        
+        //returns the count of triangles removed
+        size_t _collapse(unsigned int from, unsigned int to, const std::vector <unsigned int> &remap)
+        {
+            size_t removedTrianglesCount = 0;
+            std::vector <unsigned int> &triangles = this->_positionTriangles[from];
+            std::vector <unsigned int> &toTriangles = this->_positionTriangles[to];
+            
+            //drop the dead triangles of to while at it
+            size_t aliveCount = 0;
+            for (size_t i = 0 ; i < toTriangles.size() ; i++) {
+                if (this->_isTriangleAlive[toTriangles[i]])
+                    toTriangles[aliveCount++] = toTriangles[i];
+            }
+            toTriangles.resize(aliveCount);
+            
+            for (size_t i = 0 ; i < triangles.size() ; i++) {
+                size_t triangle = triangles[i];
+                if (!this->_isTriangleAlive[triangle])
+                    continue;
+                
+                if (this->_triangleHasPosition(triangle, to)) {
+                    this->_isTriangleAlive[triangle] = false;
+                    removedTrianglesCount++;
+                    continue;
+                }
+                
+                unsigned int *corners = &this->_corners[triangle * 3];
+                for (size_t k = 0 ; k < 3 ; k++) {
+                    if (this->_vertexPosition[corners[k]] == from)
+                        corners[k] = remap[this->_vertexSlot(corners[k], from)];
+                }
+                toTriangles.push_back((unsigned int)triangle);
+            }
+            
+            this->_isRemoved[from] = true;
+            __AddQuadric(&this->_quadrics[to], this->_quadrics[from]);
+            this->_versions[to]++;
+            
+            //the quadric of to changed, the collapses around it are pushed again with their new costs
+            this->_neighbors.clear();
+            for (size_t i = 0 ; i < toTriangles.size() ; i++) {
+                const unsigned int *corners = &this->_corners[toTriangles[i] * 3];
+                for (size_t k = 0 ; k < 3 ; k++) {
+                    unsigned int position = this->_vertexPosition[corners[k]];
+                    if (position != to)
+                        this->_neighbors.push_back(position);
+                }
+            }
+            std::sort(this->_neighbors.begin(), this->_neighbors.end());
+            this->_neighbors.erase(std::unique(this->_neighbors.begin(), this->_neighbors.end()), this->_neighbors.end());
+            for (size_t i = 0 ; i < this->_neighbors.size() ; i++) {
+                this->_pushCollapse(this->_neighbors[i], to);
+                this->_pushCollapse(to, this->_neighbors[i]);
+            }
+            
+            std::vector <unsigned int>().swap(triangles);
+            return removedTrianglesCount;
+        }
+        
+    private:
+        std::vector <unsigned int> _corners;
+        size_t _trianglesCount;
+        std::vector <double> _positions;
+        std::vector <unsigned int> _vertexPosition;
+        //vertices of position p are _positionVertices[_positionFirstVertex[p]] to _positionVertices[_positionFirstVertex[p + 1] - 1]
+        std::vector <unsigned int> _positionFirstVertex;
+        std::vector <unsigned int> _positionVertices;
+        std::vector <std::vector <unsigned int> > _positionTriangles;
+        std::vector <unsigned long long> _positionEdges;
+        std::vector <Quadric> _quadrics;
+        std::vector <unsigned int> _versions;
+        std::vector <bool> _isRemoved;
+        std::vector <bool> _isBorder;
+        std::vector <bool> _isTriangleAlive;
+        std::vector <unsigned int> _neighbors;
+        std::vector <unsigned char> _isVertexUsed;
+        std::priority_queue <Collapse, std::vector <Collapse>, __CollapseCostIsGreater> _collapses;
+    };
+    
+    shared_ptr <GLTFMesh> createSimplifiedMesh(GLTFMesh *sourceMesh, double ratio)
+    {
+        ProfilerScope profilerScope(SIMPLIFICATION_PHASE);
+        
+        IndexSetToMeshAttributeHashmap& positionAttributes = sourceMesh->getMeshAttributesForSemantic(POSITION);
+        if (positionAttributes.count(0) == 0)
+            return shared_ptr <GLTFMesh> ();
+        shared_ptr <GLTFMeshAttribute> positionAttribute = positionAttributes[0];
+        if ((positionAttribute->getComponentType() != FLOAT) || (positionAttribute->getComponentsPerAttribute() != 3) || !positionAttribute->getBufferView())
+            return shared_ptr <GLTFMesh> ();
+        const float *positions = (const float*)positionAttribute->getBufferView()->getBufferDataByApplyingOffset();
+        size_t verticesCount = positionAttribute->getCount();
+        
+        //the triangles of all the primitives are simplified together, they share the vertices
+        PrimitiveVector primitives = sourceMesh->getPrimitives();
+        std::vector <unsigned int> corners;
+        std::vector <size_t> primitivesFirstTriangle;
+        for (size_t i = 0 ; i < primitives.size() ; i++) {
+            primitivesFirstTriangle.push_back(corners.size() / 3);
+            if (primitives[i]->getType() != "TRIANGLES")
+                continue;
+            shared_ptr <GLTFIndices> uniqueIndices = primitives[i]->getUniqueIndices();
+            const unsigned int *indices = (const unsigned int*)uniqueIndices->getBufferView()->getBufferDataByApplyingOffset();
+            size_t indicesCount = uniqueIndices->getCount() - (uniqueIndices->getCount() % 3);
+            for (size_t k = 0 ; k < indicesCount ; k++) {
+                if (indices[k] >= verticesCount)
+                    return shared_ptr <GLTFMesh> ();
+            }
+            corners.insert(corners.end(), indices, indices + indicesCount);
+        }
+        primitivesFirstTriangle.push_back(corners.size() / 3);
+        
+        size_t trianglesCount = corners.size() / 3;
+        if (trianglesCount == 0)
+            return shared_ptr <GLTFMesh> ();
+        
+        Simplifier simplifier(positions, positionAttribute->getByteStride(), verticesCount, corners);
+        size_t simplifiedTrianglesCount = simplifier.simplify((size_t)(trianglesCount * std::max(ratio, 0.)));
+        if ((simplifiedTrianglesCount == trianglesCount) || (simplifiedTrianglesCount == 0))
+            return shared_ptr <GLTFMesh> ();
+        
+        shared_ptr <GLTFMesh> simplifiedMesh(new GLTFMesh());
+        simplifiedMesh->setID(sourceMesh->getID());
+        simplifiedMesh->setName(sourceMesh->getName());
+        vector <GLTF::Semantic> allSemantics = sourceMesh->allSemantics();
+        for (size_t i = 0 ; i < allSemantics.size() ; i++) {
+            simplifiedMesh->setMeshAttributesForSemantic(allSemantics[i], sourceMesh->getMeshAttributesForSemantic(allSemantics[i]));
+        }
+        
+        for (size_t i = 0 ; i < primitives.size() ; i++) {
+            shared_ptr <GLTFIndices> uniqueIndices = primitives[i]->getUniqueIndices();
+            const unsigned int *indices = (const unsigned int*)uniqueIndices->getBufferView()->getBufferDataByApplyingOffset();
+            unsigned int *simplifiedIndices = 0;
+            size_t simplifiedIndicesCount = 0;
+            
+            if (primitives[i]->getType() == "TRIANGLES") {
+                simplifiedIndices = (unsigned int*)malloc(sizeof(unsigned int) * uniqueIndices->getCount());
+                for (size_t t = primitivesFirstTriangle[i] ; t < primitivesFirstTriangle[i + 1] ; t++) {
+                    if (!simplifier.isTriangleAlive(t))
+                        continue;
+                    memcpy(simplifiedIndices + simplifiedIndicesCount, simplifier.getTriangle(t), sizeof(unsigned int) * 3);
+                    simplifiedIndicesCount += 3;
+                }
+                if (simplifiedIndicesCount == 0) {
+                    free(simplifiedIndices);
+                    continue;
+                }
+            } else {
+                //the mesh owns its indices, other primitives get a copy
+                simplifiedIndicesCount = uniqueIndices->getCount();
+                simplifiedIndices = (unsigned int*)malloc(sizeof(unsigned int) * simplifiedIndicesCount);
+                memcpy(simplifiedIndices, indices, sizeof(unsigned int) * simplifiedIndicesCount);
+            }
+            
+            shared_ptr <GLTFBufferView> indicesBufferView = createBufferViewWithAllocatedBuffer(simplifiedIndices, 0, simplifiedIndicesCount * sizeof(unsigned int), true);
+            shared_ptr <GLTFPrimitive> simplifiedPrimitive(new GLTFPrimitive(*primitives[i]));
+            simplifiedPrimitive->setIndices(shared_ptr <GLTFIndices> (new GLTFIndices(indicesBufferView, simplifiedIndicesCount)));
+            simplifiedMesh->appendPrimitive(simplifiedPrimitive);
+        }
+        
+        return simplifiedMesh;
+    }
+}
@@ -0,0 +1,41 @@
+// Copyright (c) Fabrice Robinet
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef __SIMPLIFICATION_HELPERS__
+#define __SIMPLIFICATION_HELPERS__
+
+namespace GLTF
+{
+    /*
+        Simplifies the TRIANGLES primitives of a mesh down to about ratio (0 to 1) of their triangles, other primitives are copied as they are.
+        The mesh must have unified indices (i.e comes from createUnifiedIndexesMeshFromMesh).
+        Uses quadric error metrics (Garland & Heckbert, "Surface Simplification Using Quadric Error Metrics") with half edge collapses:
+        the vertices kept are a subset of the source ones, so the returned mesh shares the attributes of sourceMesh.
+        Vertices on attribute seams (same position, different attributes) only collapse along their seam, vertices on borders along their border.
+        Returns an empty pointer if no triangle could be removed.
+     */
+    shared_ptr <GLTFMesh> createSimplifiedMesh(GLTFMesh *sourceMesh, double ratio);
+}
+
+#endif
@@ -0,0 +1,322 @@
+// Copyright (c) Fabrice Robinet
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "GLTF.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "vertexCacheHelpers.h"
+
+using namespace rapidjson;
+using namespace std::tr1;
+using namespace std;
+
+namespace GLTF
+{
+    //Tom Forsyth, "Linear-Speed Vertex Cache Optimisation"
+    //http://home.comcast.net/~tom_forsyth/papers/fast_vert_cache_opt.html
+    //The constants below are the ones recommended in the paper.
+    static const int kVertexCacheSize = 32;
+    static const float kCacheDecayPower = 1.5f;
+    static const float kLastTriangleScore = 0.75f;
+    static const float kValenceBoostScale = 2.0f;
+    static const float kValenceBoostPower = 0.5f;
+    static const unsigned int kMaxPrecomputedValence = 64;
+    static const unsigned int kNoTriangle = 0xFFFFFFFF;
+    
+    //cache used to compute ACMR, mimics a typical GPU post-transform FIFO
+    static const unsigned int kACMRCacheSize = 32;
+    
+    float computeACMR(const unsigned int *indices, size_t indicesCount, size_t vertexCount, unsigned int cacheSize)
+    {
+        size_t trianglesCount = indicesCount / 3;
+        if (trianglesCount == 0)
+            return 0;
+        
+        //for each vertex, keeps the miss count at which it entered the cache (0: never)
+        size_t *cacheTimeStamps = (size_t*)calloc(vertexCount, sizeof(size_t));
+        size_t missesCount = 0;
+        
+        for (size_t i = 0 ; i < trianglesCount * 3 ; i++) {
+            unsigned int index = indices[i];
+            if ((cacheTimeStamps[index] == 0) || ((missesCount - cacheTimeStamps[index]) >= cacheSize)) {
+                missesCount++;
+                cacheTimeStamps[index] = missesCount;
+            }
+        }
+        
+        free(cacheTimeStamps);
+        
+        return (float)missesCount / (float)trianglesCount;
+    }
+    
+    static float __ComputeVertexScore(int cachePosition, unsigned int remainingValence)
+    {
+        if (remainingValence == 0) {
+            //no triangle left for this vertex, it should not be considered anymore
+            return -1.0f;
+        }
+        
+        float score = 0;
+        if (cachePosition >= 0) {
+            if (cachePosition < 3) {
+                //the vertex was used by the last triangle, whatever the order of its vertices
+                score = kLastTriangleScore;
+            } else {
+                const float scaler = 1.0f / (kVertexCacheSize - 3);
+                score = 1.0f - (cachePosition - 3) * scaler;
+                score = powf(score, kCacheDecayPower);
+            }
+        }
+        
+        //boost vertices with few triangles left, so that we get rid of lone triangles instead of leaving them for later
+        score += kValenceBoostScale * powf((float)remainingValence, -kValenceBoostPower);
+        
+        return score;
+    }
+    
+    typedef struct {
+        float cacheScores[kVertexCacheSize];
+        float valenceScores[kMaxPrecomputedValence];
+    } VertexScoresTable;
+    
+    static void __BuildVertexScoresTable(VertexScoresTable *table)
+    {
+        for (int i = 0 ; i < kVertexCacheSize ; i++) {
+            table->cacheScores[i] = __ComputeVertexScore(i, 1) - __ComputeVertexScore(-1, 1);
+        }
+        for (unsigned int i = 0 ; i < kMaxPrecomputedValence ; i++) {
+            table->valenceScores[i] = __ComputeVertexScore(-1, i);
+        }
+    }
+    
+    static float __VertexScore(const VertexScoresTable *table, int cachePosition, unsigned int remainingValence)
+    {
+        if (remainingValence == 0)
+            return -1.0f;
+        
+        float score = (remainingValence < kMaxPrecomputedValence) ? table->valenceScores[remainingValence] : __ComputeVertexScore(-1, remainingValence);
+        if (cachePosition >= 0)
+            score += table->cacheScores[cachePosition];
+        
+        return score;
+    }
+    
+    void optimizeTrianglesForVertexCache(const unsigned int *indices, size_t indicesCount, size_t vertexCount, unsigned int *destination)
+    {
+        unsigned int trianglesCount = (unsigned int)(indicesCount / 3);
+        if (trianglesCount == 0)
+            return;
+        
+        VertexScoresTable scoresTable;
+        __BuildVertexScoresTable(&scoresTable);
+        
+        //build vertex -> triangles adjacency, all lists are stored contiguously in adjacency
+        unsigned int *remainingValences = (unsigned int*)calloc(vertexCount, sizeof(unsigned int));
+        unsigned int *adjacencyOffsets = (unsigned int*)malloc(sizeof(unsigned int) * (vertexCount + 1));
+        unsigned int *adjacency = (unsigned int*)malloc(sizeof(unsigned int) * trianglesCount * 3);
+        
+        for (size_t i = 0 ; i < trianglesCount * 3 ; i++) {
+            remainingValences[indices[i]]++;
+        }
+        adjacencyOffsets[0] = 0;
+        for (size_t i = 0 ; i < vertexCount ; i++) {
+            adjacencyOffsets[i + 1] = adjacencyOffsets[i] + remainingValences[i];
+            remainingValences[i] = 0;
+        }
+        for (unsigned int i = 0 ; i < trianglesCount ; i++) {
+            for (unsigned int k = 0 ; k < 3 ; k++) {
+                unsigned int index = indices[(i * 3) + k];
+                adjacency[adjacencyOffsets[index] + remainingValences[index]] = i;
+                remainingValences[index]++;
+            }
+        }
+        
+        int *cachePositions = (int*)malloc(sizeof(int) * vertexCount);
+        float *vertexScores = (float*)malloc(sizeof(float) * vertexCount);
+        for (size_t i = 0 ; i < vertexCount ; i++) {
+            cachePositions[i] = -1;
+            vertexScores[i] = __VertexScore(&scoresTable, -1, remainingValences[i]);
+        }
+        
+        bool *emittedTriangles = (bool*)calloc(trianglesCount, sizeof(bool));
+        unsigned int bestTriangle = kNoTriangle;
+        float bestScore = -1;
+        for (unsigned int i = 0 ; i < trianglesCount ; i++) {
+            const unsigned int *triangle = indices + (i * 3);
+            float score = vertexScores[triangle[0]] + vertexScores[triangle[1]] + vertexScores[triangle[2]];
+            if (score > bestScore) {
+                bestScore = score;
+                bestTriangle = i;
+            }
+        }
+        
+        //the 3 extra slots hold the vertices pushed out of the cache by the last triangle, their scores have to be updated too
+        unsigned int cache[kVertexCacheSize + 3];
+        unsigned int newCache[kVertexCacheSize + 3];
+        int cacheCount = 0;
+        unsigned int nextCandidate = 0;
+        
+        for (unsigned int emittedCount = 0 ; emittedCount < trianglesCount ; emittedCount++) {
+            if (bestTriangle == kNoTriangle) {
+                //nothing in the cache can help, pick the next remaining triangle. nextCandidate only moves forward which keeps this linear
+                while (emittedTriangles[nextCandidate])
+                    nextCandidate++;
+                bestTriangle = nextCandidate;
+            }
+            
+            const unsigned int *triangle = indices + (bestTriangle * 3);
+            memcpy(destination + (emittedCount * 3), triangle, sizeof(unsigned int) * 3);
+            emittedTriangles[bestTriangle] = true;
+            
+            //remove the triangle from the adjacency of its vertices
+            for (unsigned int k = 0 ; k < 3 ; k++) {
+                unsigned int index = triangle[k];
+                unsigned int *triangles = adjacency + adjacencyOffsets[index];
+                unsigned int valence = remainingValences[index];
+                for (unsigned int j = 0 ; j < valence ; j++) {
+                    if (triangles[j] == bestTriangle) {
+                        triangles[j] = triangles[valence - 1];
+                        remainingValences[index]--;
+                        break;
+                    }
+                }
+            }
+            
+            //the vertices of the emitted triangle go in front of the cache, followed by the previous content (LRU)
+            int newCacheCount = 0;
+            for (unsigned int k = 0 ; k < 3 ; k++) {
+                unsigned int index = triangle[k];
+                bool alreadyInCache = false;
+                for (int j = 0 ; j < newCacheCount ; j++) {
+                    if (newCache[j] == index) {
+                        alreadyInCache = true;
+                        break;
+                    }
+                }
+                if (!alreadyInCache)
+                    newCache[newCacheCount++] = index;
+            }
+            for (int j = 0 ; j < cacheCount ; j++) {
+                unsigned int index = cache[j];
+                if ((index != triangle[0]) && (index != triangle[1]) && (index != triangle[2]))
+                    newCache[newCacheCount++] = index;
+            }
+            
+            //update vertices scores, vertices out of the cache get their position reset
+            for (int j = 0 ; j < newCacheCount ; j++) {
+                unsigned int index = newCache[j];
+                cachePositions[index] = (j < kVertexCacheSize) ? j : -1;
+                vertexScores[index] = __VertexScore(&scoresTable, cachePositions[index], remainingValences[index]);
+            }
+            
+            //update the scores of the triangles touched by the cache and pick the best one for the next iteration
+            bestTriangle = kNoTriangle;
+            bestScore = -1;
+            for (int j = 0 ; j < newCacheCount ; j++) {
+                unsigned int index = newCache[j];
+                const unsigned int *triangles = adjacency + adjacencyOffsets[index];
+                for (unsigned int t = 0 ; t < remainingValences[index] ; t++) {
+                    unsigned int triangleIndex = triangles[t];
+                    const unsigned int *candidate = indices + (triangleIndex * 3);
+                    float score = vertexScores[candidate[0]] + vertexScores[candidate[1]] + vertexScores[candidate[2]];
+                    if (score > bestScore) {
+                        bestScore = score;
+                        bestTriangle = triangleIndex;
+                    }
+                }
+            }
+            
+            cacheCount = newCacheCount < kVertexCacheSize ? newCacheCount : kVertexCacheSize;
+            memcpy(cache, newCache, sizeof(unsigned int) * cacheCount);
+        }
+        
+        free(emittedTriangles);
+        free(vertexScores);
+        free(cachePositions);
+        free(adjacency);
+        free(adjacencyOffsets);
+        free(remainingValences);
+    }
+    
+    bool optimizeMeshForVertexCache(GLTFMesh *mesh)
+    {
+        PrimitiveVector primitives = mesh->getPrimitives();
+        size_t primitivesCount = primitives.size();
+        size_t vertexCount = 0;
+        size_t trianglesCount = 0;
+        
+        //all primitives of a unified mesh index the same vertices, find how many there are.
+        for (size_t i = 0 ; i < primitivesCount ; i++) {
+            shared_ptr <GLTFIndices> uniqueIndices = primitives[i]->getUniqueIndices();
+            unsigned int *indices = (unsigned int*)uniqueIndices->getBufferView()->getBufferDataByApplyingOffset();
+            size_t indicesCount = uniqueIndices->getCount();
+            for (size_t k = 0 ; k < indicesCount ; k++) {
+                if (indices[k] >= vertexCount)
+                    vertexCount = indices[k] + 1;
+            }
+        }
+        
+        if (vertexCount == 0)
+            return false;
+        
+        double missesBefore = 0;
+        double missesAfter = 0;
+        
+        for (size_t i = 0 ; i < primitivesCount ; i++) {
+            shared_ptr <GLTFPrimitive> primitive = primitives[i];
+            if (primitive->getType() != "TRIANGLES")
+                continue;
+            
+            shared_ptr <GLTFIndices> uniqueIndices = primitive->getUniqueIndices();
+            unsigned int *indices = (unsigned int*)uniqueIndices->getBufferView()->getBufferDataByApplyingOffset();
+            size_t indicesCount = uniqueIndices->getCount();
+            size_t primitiveTrianglesCount = indicesCount / 3;
+            if (primitiveTrianglesCount == 0)
+                continue;
+            
+            unsigned int *optimizedIndices = (unsigned int*)malloc(sizeof(unsigned int) * indicesCount);
+            //keep a possible trailing incomplete triangle as is
+            memcpy(optimizedIndices, indices, sizeof(unsigned int) * indicesCount);
+            optimizeTrianglesForVertexCache(indices, indicesCount, vertexCount, optimizedIndices);
+            
+            missesBefore += computeACMR(indices, indicesCount, vertexCount, kACMRCacheSize) * primitiveTrianglesCount;
+            missesAfter += computeACMR(optimizedIndices, indicesCount, vertexCount, kACMRCacheSize) * primitiveTrianglesCount;
+            trianglesCount += primitiveTrianglesCount;
+            
+            memcpy(indices, optimizedIndices, sizeof(unsigned int) * indicesCount);
+            free(optimizedIndices);
+        }
+        
+        if (trianglesCount > 0) {
+            printf("[vertex cache] mesh:%s triangles:%d ACMR:%.3f -> %.3f\n",
+                   mesh->getID().c_str(),
+                   (int)trianglesCount,
+                   missesBefore / trianglesCount,
+                   missesAfter / trianglesCount);
+        }
+        
+        return true;
+    }
+}
@@ -0,0 +1,49 @@
+// Copyright (c) Fabrice Robinet
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef __VERTEX_CACHE_HELPERS__
+#define __VERTEX_CACHE_HELPERS__
+
+namespace GLTF
+{
+    /*
+        Average Cache Miss Ratio: count of vertices transformed per triangle, simulating a FIFO post-transform cache of cacheSize entries.
+        Goes from 3 (no reuse at all) to ~0.5 (ideal for a regular grid).
+     */
+    float computeACMR(const unsigned int *indices, size_t indicesCount, size_t vertexCount, unsigned int cacheSize);
+    
+    /*
+        Reorders the triangles given in indices to improve the post-transform vertex cache hit rate and writes them in destination.
+        The vertices are left untouched. Implements Tom Forsyth "Linear-Speed Vertex Cache Optimisation".
+     */
+    void optimizeTrianglesForVertexCache(const unsigned int *indices, size_t indicesCount, size_t vertexCount, unsigned int *destination);
+    
+    /*
+        Applies optimizeTrianglesForVertexCache to all the TRIANGLES primitives of a mesh.
+        The mesh must have unified indices (i.e comes from createUnifiedIndexesMeshFromMesh).
+     */
+    bool optimizeMeshForVertexCache(GLTFMesh *mesh);
+}
+
+#endif
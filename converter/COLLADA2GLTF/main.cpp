@@ -35,9 +35,10 @@
 #include "GLTFConverterContext.h"
 
 #include "COLLADA2GLTFWriter.h"
+#include "BatchConverter.h"
 
 #define STDOUT_OUTPUT 0
-#define OPTIONS_COUNT 5
+#define OPTIONS_COUNT 18
 
 typedef struct {
     const char* name;
@@ -54,6 +55,19 @@ static const OptionDescriptor options[] = {
 	{ "a",              required_argument,  "-a -> export animations, argument [bool], default:true" },
 	{ "i",              no_argument,        "-i -> invert-transparency, argument [bool], default:false" },
 	{ "d",              no_argument,        "-d -> export pass details to be able to regenerate shaders and states" },
+	{ "c",              no_argument,        "-c -> reorder triangles to optimize the post-transform vertex cache, default:false" },
+	{ "j",              required_argument,  "-j -> count of threads converting geometries, or files in batch mode, argument [integer], default:count of processors" },
+	{ "b",              no_argument,        "-b -> batch mode, converts all the inputs following the options: .dae files, directories (searched recursively) or manifests listing one input per line" },
+	{ "s",              no_argument,        "-s -> stream the JSON, sections are written as they are serialized instead of building the whole document first, default:false" },
+	{ "w",              required_argument,  "-w -> maximum width of indices in bits, argument [integer]: 16 (larger meshes are split) or 32 (meshes are not split). Each primitive gets the narrowest of unsigned byte, short or int indices addressing its vertices, default:16" },
+	{ "q",              required_argument,  "-q -> quantize attributes, argument [string] bits of positions,normals,texcoords (2 to 16, 0 keeps floats), e.g. 14,10,12, default:0,0,0" },
+	{ "l",              no_argument,        "-l -> interleave the attributes of each mesh in a single vertex buffer, default:false" },
+	{ "p",              no_argument,        "-p -> profile, writes the wall time, CPU time and memory spent per phase and counts of the converted content to [output].profile.json, default:false" },
+	{ "r",              no_argument,        "-r -> recenter double precision positions around their centroid before converting them to floats, nodes instancing a recentered mesh get a child node translated by its centroid, default:false" },
+	{ "L",              required_argument,  "-L -> levels of detail, argument [string] percentages of triangles kept by each level, e.g. 50,25,10. They are written as extra meshes listed in the extras of the nodes, default:none" },
+	{ "k",              required_argument,  "-k -> reduce animation keys, argument [string] tolerances of translations,rotations (degrees),scales, e.g. 0.001,0.1,0.001. Keys that linear interpolation reproduces within them are dropped, default:none" },
+	{ "Q",              required_argument,  "-Q -> quantize animations, argument [integer] bits of translations, rotations and scales (2 to 16, 0 keeps floats), stored as shorts spanning the range of each channel, default:0" },
+	{ "C",              required_argument,  "-C -> technique cache, argument [string] directory where generated techniques are kept for later conversions, shaders are named after their content so that identical ones are shared, default:none" },
 	{ "h",              no_argument,        "-h -> help" }
 };
 
@@ -79,36 +93,43 @@ static void dumpHelpMessage() {
     printf("%s\n", helpMessage.c_str());
 }
 
-static std::string replacePathExtensionWithJSON(const std::string& inputFile)
-{
-    COLLADABU::URI inputFileURI(inputFile.c_str());
-    
-    std::string pathDir = inputFileURI.getPathDir();
-    std::string fileBase = inputFileURI.getPathFileBase();
-    
-    return pathDir + fileBase + ".json";
-}
-
-static bool processArgs(int argc, char * const * argv, GLTF::GLTFConverterContext *converterArgs) {
+static bool processArgs(int argc, char * const * argv, GLTF::GLTFConverterContext *converterArgs, std::vector <std::string> *batchInputs) {
 	int ch;
     std::string file;
     std::string output;
     bool hasOutputPath = false;
     bool hasInputPath = false;
+    bool batchMode = false;
 
     converterArgs->invertTransparency = false;
     converterArgs->exportAnimations = true;
     converterArgs->exportPassDetails = false;
+    converterArgs->optimizeVertexCache = false;
+    converterArgs->streamJSON = false;
+    converterArgs->maxIndicesWidth = 16;
+    converterArgs->positionQuantizationBits = 0;
+    converterArgs->normalQuantizationBits = 0;
+    converterArgs->texcoordQuantizationBits = 0;
+    converterArgs->interleaveAttributes = false;
+    converterArgs->profile = false;
+    converterArgs->recenterDoublePositions = false;
+    converterArgs->reduceKeyframes = false;
+    converterArgs->animationQuantizationBits = 0;
+    converterArgs->translationTolerance = 0;
+    converterArgs->rotationTolerance = 0;
+    converterArgs->scaleTolerance = 0;
+    converterArgs->techniqueCacheDirectory = "";
+    converterArgs->threadsCount = (unsigned int)GLTF::JobScheduler::getHardwareThreadsCount();
 
     buildOptions();
     
     if (argc == 2) {
         converterArgs->inputFilePath = argv[1];
-        converterArgs->outputFilePath = replacePathExtensionWithJSON(converterArgs->inputFilePath);
+        converterArgs->outputFilePath = GLTF::replacePathExtensionWithJSON(converterArgs->inputFilePath);
         return true;
     }
     
-    while ((ch = getopt_long(argc, argv, "f:o:a:ihd", opt_options, 0)) != -1) {
+    while ((ch = getopt_long(argc, argv, "f:o:a:ihdcj:bsw:q:lprL:k:Q:C:", opt_options, 0)) != -1) {
         switch (ch) {
             case 'h':
                 dumpHelpMessage();
@@ -118,7 +139,7 @@ static bool processArgs(int argc, char * const * argv, GLTF::GLTFConverterContex
                 hasInputPath = true;
 				break;
             case 'o':
-                converterArgs->outputFilePath = replacePathExtensionWithJSON(optarg);
+                converterArgs->outputFilePath = GLTF::replacePathExtensionWithJSON(optarg);
                 hasOutputPath = true;
 				break;
             case 'i':
@@ -130,6 +151,89 @@ static bool processArgs(int argc, char * const * argv, GLTF::GLTFConverterContex
             case 'd':
                 converterArgs->exportPassDetails = true;
                 printf("[option] export pass details\n");
+                break;
+            case 'c':
+                converterArgs->optimizeVertexCache = true;
+                printf("[option] optimize vertex cache\n");
+                break;
+            case 'j':
+                converterArgs->threadsCount = (unsigned int)atoi(optarg);
+                printf("[option] threads:%d\n", converterArgs->threadsCount);
+                break;
+            case 'b':
+                batchMode = true;
+                printf("[option] batch\n");
+                break;
+            case 's':
+                converterArgs->streamJSON = true;
+                printf("[option] stream JSON\n");
+                break;
+            case 'w':
+                converterArgs->maxIndicesWidth = (unsigned int)atoi(optarg);
+                if ((converterArgs->maxIndicesWidth != 16) && (converterArgs->maxIndicesWidth != 32)) {
+                    printf("ERROR: -w expects 16 or 32, got:%s\n", optarg);
+                    dumpHelpMessage();
+                    return false;
+                }
+                printf("[option] indices width:%d\n", converterArgs->maxIndicesWidth);
+                break;
+            case 'q':
+                if (sscanf(optarg, "%u,%u,%u", &converterArgs->positionQuantizationBits, &converterArgs->normalQuantizationBits, &converterArgs->texcoordQuantizationBits) != 3) {
+                    printf("ERROR: -q expects the bits of positions,normals,texcoords, got:%s\n", optarg);
+                    dumpHelpMessage();
+                    return false;
+                }
+                printf("[option] quantization bits positions:%d normals:%d texcoords:%d\n",
+                       converterArgs->positionQuantizationBits, converterArgs->normalQuantizationBits, converterArgs->texcoordQuantizationBits);
+                break;
+            case 'l':
+                converterArgs->interleaveAttributes = true;
+                printf("[option] interleave attributes\n");
+                break;
+            case 'p':
+                converterArgs->profile = true;
+                printf("[option] profile\n");
+                break;
+            case 'L': {
+                const char *percentages = optarg;
+                char *end = 0;
+                converterArgs->levelsOfDetailRatios.clear();
+                while (*percentages) {
+                    double percentage = strtod(percentages, &end);
+                    if (end == percentages)
+                        break;
+                    if ((percentage > 0) && (percentage < 100))
+                        converterArgs->levelsOfDetailRatios.push_back(percentage / 100.);
+                    percentages = (*end == ',') ? end + 1 : end;
+                }
+                std::sort(converterArgs->levelsOfDetailRatios.begin(), converterArgs->levelsOfDetailRatios.end(), std::greater<double>());
+                printf("[option] levels of detail:%d\n", (int)converterArgs->levelsOfDetailRatios.size());
+                break;
+            }
+            case 'r':
+                converterArgs->recenterDoublePositions = true;
+                printf("[option] recenter double positions\n");
+                break;
+            case 'Q':
+                converterArgs->animationQuantizationBits = (unsigned int)atoi(optarg);
+                printf("[option] animation quantization bits:%d\n", converterArgs->animationQuantizationBits);
+                break;
+            case 'k': {
+                double rotationToleranceInDegrees = 0;
+                converterArgs->reduceKeyframes = true;
+                if (sscanf(optarg, "%lf,%lf,%lf", &converterArgs->translationTolerance, &rotationToleranceInDegrees, &converterArgs->scaleTolerance) != 3) {
+                    printf("ERROR: -k expects the tolerances of translations,rotations,scales, got:%s\n", optarg);
+                    dumpHelpMessage();
+                    return false;
+                }
+                converterArgs->rotationTolerance = rotationToleranceInDegrees * 0.0174532925;
+                printf("[option] reduce keyframes tolerances translations:%g rotations:%g scales:%g\n",
+                       converterArgs->translationTolerance, rotationToleranceInDegrees, converterArgs->scaleTolerance);
+                break;
+            }
+            case 'C':
+                converterArgs->techniqueCacheDirectory = optarg;
+                printf("[option] technique cache:%s\n", converterArgs->techniqueCacheDirectory.c_str());
                 break;
                 
 			case 0:
@@ -137,13 +241,26 @@ static bool processArgs(int argc, char * const * argv, GLTF::GLTFConverterContex
 		}
 	}
     
+    if (batchMode) {
+        if (hasInputPath)
+            batchInputs->push_back(converterArgs->inputFilePath);
+        for (int i = optind ; i < argc ; i++) {
+            batchInputs->push_back(argv[i]);
+        }
+        if (batchInputs->size() == 0) {
+            dumpHelpMessage();
+            return false;
+        }
+        return true;
+    }
+    
     if (!hasInputPath) {
         dumpHelpMessage();
         return false;
     }
     
     if (!hasOutputPath) {
-        converterArgs->outputFilePath = replacePathExtensionWithJSON(converterArgs->inputFilePath);
+        converterArgs->outputFilePath = GLTF::replacePathExtensionWithJSON(converterArgs->inputFilePath);
     }
         
     return true;
@@ -151,8 +268,20 @@ static bool processArgs(int argc, char * const * argv, GLTF::GLTFConverterContex
 
 int main (int argc, char * const argv[]) {
     GLTF::GLTFConverterContext converterArgs;
+    std::vector <std::string> batchInputs;
     
-    if (processArgs(argc, argv, &converterArgs)) {
+    if (processArgs(argc, argv, &converterArgs, &batchInputs)) {
+        if (batchInputs.size() > 0) {
+            GLTF::BatchConverter batchConverter(converterArgs);
+            bool inputsAreValid = true;
+            for (size_t i = 0 ; i < batchInputs.size() ; i++) {
+                inputsAreValid &= batchConverter.addInput(batchInputs[i]);
+            }
+            //exit code is non zero as soon as one input could not be read or one file failed to convert
+            size_t failedFilesCount = batchConverter.run(converterArgs.threadsCount);
+            return (inputsAreValid && (failedFilesCount == 0)) ? 0 : 1;
+        }
+        
 #if !STDOUT_OUTPUT
         FILE* fd = fopen(converterArgs.outputFilePath.c_str(), "w");
         if (fd) {
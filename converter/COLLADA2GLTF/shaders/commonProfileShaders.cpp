@@ -26,68 +26,14 @@
 
 #include "../GLTFConverterContext.h"
 #include "commonProfileShaders.h"
-#ifndef WIN32
-#include "png.h"
-#endif
+#include "techniqueCache.h"
+#include "../helpers/jobScheduler.h"
+#include "../helpers/profiler.h"
+#include "../helpers/imageHelpers.h"
 using namespace std;
 
 namespace GLTF
 {
-#define PNGSIGSIZE 8
-    #ifndef WIN32
-    void userReadData(png_structp pngPtr, png_bytep data, png_size_t length) {
-        ((std::istream*)png_get_io_ptr(pngPtr))->read((char*)data, length);
-    }
-#endif
-    //thanks to piko3d.com libpng tutorial here
-    static bool imageHasAlpha(const char *path)
-    {
-#ifndef WIN32
-        bool hasAlpha = false;
-        std::ifstream source;
-        
-        source.open(path, ios::in | ios::binary);
-        
-        png_byte pngsig[PNGSIGSIZE];
-        int isPNG = 0;
-        source.read((char*)pngsig, PNGSIGSIZE);
-        if (!source.good())
-            return false;
-        isPNG = png_sig_cmp(pngsig, 0, PNGSIGSIZE) == 0;
-        if (isPNG) {
-            png_structp pngPtr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-            if (pngPtr) {
-                png_infop infoPtr = png_create_info_struct(pngPtr);
-                if (infoPtr) {
-                    png_set_read_fn(pngPtr,(png_voidp)&source, userReadData);
-                    png_set_sig_bytes(pngPtr, PNGSIGSIZE);
-                    png_read_info(pngPtr, infoPtr);
-                    png_uint_32 color_type = png_get_color_type(pngPtr, infoPtr);
-                    switch (color_type) {
-                        case PNG_COLOR_TYPE_RGB_ALPHA:
-                            hasAlpha =  true;
-                            break;
-                        case PNG_COLOR_TYPE_GRAY_ALPHA:
-                            hasAlpha = true;
-                            break;
-                        default:
-                            break;
-                    }
-                    
-                    png_destroy_read_struct(&pngPtr, (png_infopp)0, (png_infopp)0);
-                }
-            }
-        }
-        
-        source.close();
-        
-        return hasAlpha;
-#else
-		return false;
-#endif
-    }
-    
-    
     //Not yet implemented for everything
     static bool slotIsContributingToLighting(const std::string &slot, shared_ptr <JSONObject> inputParameters) {
         if (inputParameters->contains(slot)) {
@@ -142,7 +88,9 @@ namespace GLTF
                 
                 COLLADABU::URI inputURI(context.inputFilePath.c_str());
                 std::string imageFullPath = inputURI.getPathDir() + imagePath;
-                if (imageHasAlpha(imageFullPath.c_str()))
+                //usually probed already, while the document was loading
+                ImageMetadata imageMetadata;
+                if (getImageMetadata(imageFullPath, imageMetadata) && imageMetadata.hasAlpha)
                     return false;
             }
         }
@@ -199,30 +147,48 @@ namespace GLTF
      */
     
     
-    static std::string typeForSemanticAttribute(const std::string& semantic) {
-        static std::map<std::string , std::string> typeForSemanticAttribute;
+    typedef std::map<std::string , std::string> StringToStringMap;
+    
+    /*
+        The lookup tables below are built during static initialization and only read afterwards,
+        since several conversions may run concurrently in batch mode.
+     */
+    static std::string __LookupString(const StringToStringMap& map, const std::string& key) {
+        StringToStringMap::const_iterator it = map.find(key);
+        return (it != map.end()) ? it->second : "";
+    }
+    
+    static StringToStringMap __BuildTypeForSemanticAttribute() {
+        StringToStringMap typeForSemanticAttribute;
+        
+        typeForSemanticAttribute["POSITION"] = "FLOAT_VEC3";
+        typeForSemanticAttribute["NORMAL"] = "FLOAT_VEC3";
+        typeForSemanticAttribute["REFLECTIVE"] = "FLOAT_VEC2";
+        return typeForSemanticAttribute;
+    }
+    
+    static StringToStringMap __BuildTypeForSemanticUniform() {
+        StringToStringMap typeForSemanticUniform;
         
+        typeForSemanticUniform["WORLDVIEWINVERSETRANSPOSE"] = "FLOAT_MAT3"; //typically the normal matrix
+        typeForSemanticUniform["WORLDVIEW"] = "FLOAT_MAT4"; 
+        typeForSemanticUniform["PROJECTION"] = "FLOAT_MAT4"; 
+        return typeForSemanticUniform;
+    }
+    
+    static const StringToStringMap kTypeForSemanticAttribute = __BuildTypeForSemanticAttribute();
+    static const StringToStringMap kTypeForSemanticUniform = __BuildTypeForSemanticUniform();
+    
+    static std::string typeForSemanticAttribute(const std::string& semantic) {
         if (semantic.find("TEXCOORD") != string::npos) {
             return "FLOAT_VEC2";
         }
         
-        if (typeForSemanticAttribute.empty()) {
-            typeForSemanticAttribute["POSITION"] = "FLOAT_VEC3";
-            typeForSemanticAttribute["NORMAL"] = "FLOAT_VEC3";
-            typeForSemanticAttribute["REFLECTIVE"] = "FLOAT_VEC2";
-        }
-        return typeForSemanticAttribute[semantic];
+        return __LookupString(kTypeForSemanticAttribute, semantic);
     }
 
     static std::string typeForSemanticUniform(const std::string& semantic) {
-        static std::map<std::string , std::string> typeForSemanticUniform;
-        
-        if (typeForSemanticUniform.empty()) {
-            typeForSemanticUniform["WORLDVIEWINVERSETRANSPOSE"] = "FLOAT_MAT3"; //typically the normal matrix
-            typeForSemanticUniform["WORLDVIEW"] = "FLOAT_MAT4"; 
-            typeForSemanticUniform["PROJECTION"] = "FLOAT_MAT4"; 
-        }
-        return typeForSemanticUniform[semantic];
+        return __LookupString(kTypeForSemanticUniform, semantic);
     }
 
     static std::string buildSlotHash(shared_ptr<JSONObject> &parameters, std::string slot) {
@@ -274,12 +240,16 @@ namespace GLTF
             shadersObject->setValue(shaderId, shaderObject);
             shaderObject->setString("path", path);
             
-            //also write the file on disk
+            //also write the file on disk, content addressed shaders may already be there from another conversion
             std::string shaderString = context.shaderIdToShaderString[shaderId];
             if (shaderString.size() > 0) {
                 COLLADABU::URI outputURI(context.outputFilePath);
                 std::string shaderPath =  outputURI.getPathDir() + path;
-                GLTF::GLTFUtils::writeData(shaderPath, "w",(unsigned char*)shaderString.c_str(), shaderString.size());
+                if (!writeFileIfChanged(shaderPath, shaderString)) {
+                    // FIXME: report error
+                    printf("WARNING: cannot write shader %s\n", shaderPath.c_str());
+                    return false;
+                }
                 
                 printf("[shader]: %s\n", shaderPath.c_str());
             }
@@ -312,7 +282,34 @@ namespace GLTF
         return states;
     }
     
-    typedef std::map<std::string , std::string > TechniqueHashToTechniqueID;
+    static StringToStringMap __BuildGLSLTypeForGLType() {
+        StringToStringMap GLSLTypeForGLType;
+        
+        GLSLTypeForGLType["FLOAT"] = "float";
+        GLSLTypeForGLType["FLOAT_VEC2"] = "vec2";
+        GLSLTypeForGLType["FLOAT_VEC3"] = "vec3";
+        GLSLTypeForGLType["FLOAT_VEC4"] = "vec4";
+        
+        GLSLTypeForGLType["FLOAT_MAT2"] = "mat2";
+        GLSLTypeForGLType["FLOAT_MAT3"] = "mat3";
+        GLSLTypeForGLType["FLOAT_MAT4"] = "mat4";
+        
+        GLSLTypeForGLType["INT"] = "int";
+        GLSLTypeForGLType["INT_VEC2"] = "ivec";
+        GLSLTypeForGLType["INT_VEC3"] = "ivec3";
+        GLSLTypeForGLType["INT_VEC4"] = "ivec4";
+        
+        GLSLTypeForGLType["BOOL"] = "bool";
+        GLSLTypeForGLType["BOOL_VEC2"] = "bvec2";
+        GLSLTypeForGLType["BOOL_VEC3"] = "bvec3";
+        GLSLTypeForGLType["BOOL_VEC4"] = "bvec4";
+        
+        GLSLTypeForGLType["SAMPLER_2D"] = "sampler2D";
+        GLSLTypeForGLType["SAMPLER_CUBE"] = "samplerCube";
+        return GLSLTypeForGLType;
+    }
+    
+    static const StringToStringMap kGLSLTypeForGLType = __BuildGLSLTypeForGLType();
     
     /*
     static size_t __GetSetIndex(const std::string &semantic) {
@@ -344,32 +341,7 @@ namespace GLTF
         }
         
         static std::string GLSLTypeForGLType(const std::string &glType) {
-            static std::map<std::string , std::string> GLSLTypeForGLType;
-            
-            if (GLSLTypeForGLType.empty()) {
-                GLSLTypeForGLType["FLOAT"] = "float";
-                GLSLTypeForGLType["FLOAT_VEC2"] = "vec2";
-                GLSLTypeForGLType["FLOAT_VEC3"] = "vec3";
-                GLSLTypeForGLType["FLOAT_VEC4"] = "vec4";
-                
-                GLSLTypeForGLType["FLOAT_MAT2"] = "mat2";
-                GLSLTypeForGLType["FLOAT_MAT3"] = "mat3";
-                GLSLTypeForGLType["FLOAT_MAT4"] = "mat4";
-                
-                GLSLTypeForGLType["INT"] = "int";
-                GLSLTypeForGLType["INT_VEC2"] = "ivec";
-                GLSLTypeForGLType["INT_VEC3"] = "ivec3";
-                GLSLTypeForGLType["INT_VEC4"] = "ivec4";
-                
-                GLSLTypeForGLType["BOOL"] = "bool";
-                GLSLTypeForGLType["BOOL_VEC2"] = "bvec2";
-                GLSLTypeForGLType["BOOL_VEC3"] = "bvec3";
-                GLSLTypeForGLType["BOOL_VEC4"] = "bvec4";
-                
-                GLSLTypeForGLType["SAMPLER_2D"] = "sampler2D";
-                GLSLTypeForGLType["SAMPLER_CUBE"] = "samplerCube";
-            }
-            return GLSLTypeForGLType[glType];
+            return __LookupString(kGLSLTypeForGLType, glType);
         }
         
         void _addDeclaration(std::string qualifier, std::string symbol, std::string type) {
@@ -817,6 +789,39 @@ namespace GLTF
         
     };
     
+    //techniqueHash leaves out what doesn't tell techniques of a file apart, a technique shared across files is told apart by all it is generated from
+    static std::string __BuildTechniqueCacheKey(const std::string &lightingModel,
+                                                const std::string &techniqueHash,
+                                                shared_ptr<JSONObject> values,
+                                                std::map<std::string , std::string > &texcoordBindings) {
+        std::string key = "lightingModel:" + lightingModel + "\n" + techniqueHash + "\n";
+        
+        vector <std::string> slots = values->getAllKeys();
+        for (size_t i = 0 ; i < slots.size() ; i++) {
+            shared_ptr <JSONValue> value = values->getValue(slots[i]);
+            if (value->getType() == OBJECT)
+                key += "value:" + slots[i] + ":" + static_pointer_cast <JSONObject> (value)->getString("type") + "\n";
+        }
+        
+        std::map<std::string , std::string >::const_iterator texcoordIterator;
+        for (texcoordIterator = texcoordBindings.begin() ; texcoordIterator != texcoordBindings.end() ; texcoordIterator++) {
+            key += "texcoord:" + texcoordIterator->first + ":" + texcoordIterator->second + "\n";
+        }
+        
+        return key;
+    }
+    
+    //a program of the same shaders, so that techniques differing only by their states share it
+    static std::string __FindProgramID(shared_ptr <JSONObject> programsObject, const std::string &shaderVS, const std::string &shaderFS) {
+        vector <std::string> programIDs = programsObject->getAllKeys();
+        for (size_t i = 0 ; i < programIDs.size() ; i++) {
+            shared_ptr <JSONObject> program = programsObject->getObject(programIDs[i]);
+            if ((program->getString("vertexShader") == shaderVS) && (program->getString("fragmentShader") == shaderFS))
+                return programIDs[i];
+        }
+        return "";
+    }
+    
     std::string getReferenceTechniqueID(const std::string &lightingModel,
                                         shared_ptr<JSONObject> values,
                                         shared_ptr<JSONObject> techniqueExtras,
@@ -827,7 +832,7 @@ namespace GLTF
         shared_ptr <JSONObject> techniquesObject = context.root->createObjectIfNeeded("techniques");
         std::string techniqueHash = buildTechniqueHash(values, techniqueExtras, context);
 
-        static TechniqueHashToTechniqueID techniqueHashToTechniqueID;
+        TechniqueHashToTechniqueID& techniqueHashToTechniqueID = context._techniqueHashToTechniqueID;
         if (techniqueHashToTechniqueID.count(techniqueHash) == 0) {
             techniqueHashToTechniqueID[techniqueHash] = "technique" + GLTFUtils::toString(techniqueHashToTechniqueID.size());
         }
@@ -836,9 +841,6 @@ namespace GLTF
         if (techniquesObject->contains(techniqueID))
             return techniqueID;
         
-        GLTF::Technique glTFTechnique(lightingModel, techniqueID, values, techniqueExtras, texcoordBindings, context);
-        GLTF::Pass *glTFPass = glTFTechnique.getPass();
-        
         std::string passName("defaultPass");
         //if the technique has not been serialized, first thing create the default pass for this technique
         shared_ptr <GLTF::JSONObject> pass(new GLTF::JSONObject());
@@ -846,40 +848,80 @@ namespace GLTF
         shared_ptr <GLTF::JSONObject> states = createStatesForTechnique(values, techniqueExtras, context);
         pass->setValue("states", states);
         
-        GLSLProgram* glTFProgram = glTFPass->instanceProgram();
-        GLSLShader* vs = glTFProgram->vertexShader();
-        GLSLShader* fs = glTFProgram->fragmentShader();
-        
+        //details are built from the generated pass, the cache is only used without them
+        bool useTechniqueCache = (context.techniqueCacheDirectory.size() > 0) && !context.exportPassDetails;
+        std::string techniqueCacheKey;
+        CachedTechnique cachedTechnique;
+        if (useTechniqueCache) {
+            techniqueCacheKey = __BuildTechniqueCacheKey(lightingModel, techniqueHash, values, texcoordBindings);
+        }
+        
+        if (useTechniqueCache && loadCachedTechnique(context.techniqueCacheDirectory, techniqueCacheKey, cachedTechnique)) {
+            Profiler::count(TECHNIQUE_CACHE_HITS_COUNTER, 1);
+        } else {
+            GLTF::Technique glTFTechnique(lightingModel, techniqueID, values, techniqueExtras, texcoordBindings, context);
+            GLTF::Pass *glTFPass = glTFTechnique.getPass();
+            GLSLProgram* glTFProgram = glTFPass->instanceProgram();
+            
+            cachedTechnique.vertexShaderSource = glTFProgram->vertexShader()->source();
+            cachedTechnique.fragmentShaderSource = glTFProgram->fragmentShader()->source();
+            cachedTechnique.parameters = glTFTechnique.parameters();
+            cachedTechnique.attributes = glTFProgram->attributes();
+            cachedTechnique.uniforms = glTFProgram->uniforms();
+            
+            if (useTechniqueCache) {
+                Profiler::count(TECHNIQUE_CACHE_MISSES_COUNTER, 1);
+                if (!storeCachedTechnique(context.techniqueCacheDirectory, techniqueCacheKey, cachedTechnique)) {
+                    printf("WARNING: cannot write technique to cache %s\n", context.techniqueCacheDirectory.c_str());
+                }
+            }
+            
+            if (context.exportPassDetails) {
+                shared_ptr <JSONObject> details = glTFPass->getDetails(lightingModel, values, techniqueExtras, texcoordBindings, context);
+                pass->setValue("details", details);
+            }
+        }
         
-        //create shader name made of the input file name to avoid file name conflicts
-        COLLADABU::URI outputFileURI(context.outputFilePath.c_str());
-        std::string shaderBaseId = outputFileURI.getPathFileBase()+GLTFUtils::toString(context.shaderIdToShaderString.size());
-        std::string shaderFS = shaderBaseId + "FS";
-        std::string shaderVS = shaderBaseId + "VS";
+        std::string shaderFS, shaderVS;
+        if (context.techniqueCacheDirectory.size() > 0) {
+            //named after their content, identical shaders of any conversion end up in the same file
+            shaderVS = "shader_" + hashString(cachedTechnique.vertexShaderSource) + "VS";
+            shaderFS = "shader_" + hashString(cachedTechnique.fragmentShaderSource) + "FS";
+        } else {
+            //create shader name made of the input file name to avoid file name conflicts
+            COLLADABU::URI outputFileURI(context.outputFilePath.c_str());
+            std::string shaderBaseId = outputFileURI.getPathFileBase()+GLTFUtils::toString(context.shaderIdToShaderString.size());
+            shaderFS = shaderBaseId + "FS";
+            shaderVS = shaderBaseId + "VS";
+        }
         
-        context.shaderIdToShaderString[shaderVS] = vs->source();
-        context.shaderIdToShaderString[shaderFS] = fs->source();
+        context.shaderIdToShaderString[shaderVS] = cachedTechnique.vertexShaderSource;
+        context.shaderIdToShaderString[shaderFS] = cachedTechnique.fragmentShaderSource;
         
         writeShaderIfNeeded(shaderVS, context);
         writeShaderIfNeeded(shaderFS, context);
         
         shared_ptr <JSONObject> programsObject = context.root->createObjectIfNeeded("programs");
-        std::string programID = "program_" + GLTFUtils::toString(programsObject->getKeysCount());
-        shared_ptr <GLTF::JSONObject> program(new GLTF::JSONObject());
+        std::string programID = __FindProgramID(programsObject, shaderVS, shaderFS);
+        if (programID.size() == 0) {
+            programID = "program_" + GLTFUtils::toString(programsObject->getKeysCount());
+            shared_ptr <GLTF::JSONObject> program(new GLTF::JSONObject());
+            programsObject->setValue(programID, program);
+            
+            program->setString("vertexShader", shaderVS);
+            program->setString("fragmentShader", shaderFS);
+        }
+        
         shared_ptr <GLTF::JSONObject> instanceProgram(new GLTF::JSONObject());
         
-        instanceProgram->setValue("uniforms", glTFProgram->uniforms());
-        instanceProgram->setValue("attributes", glTFProgram->attributes());
+        instanceProgram->setValue("uniforms", cachedTechnique.uniforms);
+        instanceProgram->setValue("attributes", cachedTechnique.attributes);
         pass->setValue("instanceProgram", instanceProgram);
         instanceProgram->setString("program", programID);
-        programsObject->setValue(programID, program);
-        
-        program->setString("vertexShader", shaderVS);
-        program->setString("fragmentShader", shaderFS);
         
         shared_ptr<JSONObject> referenceTechnique(new JSONObject());
         
-        referenceTechnique->setValue("parameters", glTFTechnique.parameters());
+        referenceTechnique->setValue("parameters", cachedTechnique.parameters);
         referenceTechnique->setString("pass", passName);
         
         shared_ptr <GLTF::JSONObject> passes = referenceTechnique->createObjectIfNeeded("passes");
@@ -887,11 +929,6 @@ namespace GLTF
         passes->setValue(passName, pass);
         techniquesObject->setValue(techniqueID, referenceTechnique);
         
-        if (context.exportPassDetails) {
-            shared_ptr <JSONObject> details = glTFPass->getDetails(lightingModel, values, techniqueExtras, texcoordBindings, context);
-            pass->setValue("details", details);
-        }
-        
         return techniqueID;
-    }    
+    }
 }
\ No newline at end of file
@@ -0,0 +1,279 @@
+// Copyright (c) Fabrice Robinet
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "GLTF.h"
+#include "techniqueCache.h"
+#include "../helpers/blobIndex.h"
+
+#include <errno.h>
+#ifdef WIN32
+#include <windows.h>
+#include <direct.h>
+#include <process.h>
+#else
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace GLTF
+{
+    //entries written with another version are ignored. Bump it whenever the GLSL generated for the common profile changes.
+    static const char* const kTechniqueCacheHeader = "glTF-technique-cache 1";
+    static const char* const kTechniqueCacheExtension = ".technique";
+    
+    static volatile long __temporaryFilesCount = 0;
+    
+    std::string hashString(const std::string& data)
+    {
+        char hexadecimal[17];
+        unsigned long long hash = hashBytes((const unsigned char*)data.c_str(), data.size());
+        sprintf(hexadecimal, "%016llx", hash);
+        return hexadecimal;
+    }
+    
+    static bool __ReadFile(const std::string& path, std::string& data)
+    {
+        FILE* fd = fopen(path.c_str(), "rb");
+        if (!fd)
+            return false;
+        
+        char buffer[4096];
+        size_t readCount;
+        data.clear();
+        while ((readCount = fread(buffer, 1, sizeof(buffer), fd)) > 0) {
+            data.append(buffer, readCount);
+        }
+        bool succeeded = ferror(fd) == 0;
+        fclose(fd);
+        
+        return succeeded;
+    }
+    
+    static std::string __TemporaryPath(const std::string& path)
+    {
+        //unique among the threads of this process, the process ID takes care of other processes
+#ifdef WIN32
+        int processID = _getpid();
+        long index = InterlockedIncrement(&__temporaryFilesCount);
+#else
+        int processID = (int)getpid();
+        long index = __sync_add_and_fetch(&__temporaryFilesCount, 1);
+#endif
+        return path + "." + GLTFUtils::toString(processID) + "." + GLTFUtils::toString(index) + ".tmp";
+    }
+    
+    static bool __WriteFileAtomically(const std::string& path, const std::string& data)
+    {
+        std::string temporaryPath = __TemporaryPath(path);
+        FILE* fd = fopen(temporaryPath.c_str(), "wb");
+        if (!fd)
+            return false;
+        
+        bool succeeded = fwrite(data.c_str(), 1, data.size(), fd) == data.size();
+        succeeded &= fclose(fd) == 0;
+        
+        if (succeeded) {
+#ifdef WIN32
+            succeeded = MoveFileExA(temporaryPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+            succeeded = rename(temporaryPath.c_str(), path.c_str()) == 0;
+#endif
+        }
+        if (!succeeded)
+            remove(temporaryPath.c_str());
+        
+        return succeeded;
+    }
+    
+    bool writeFileIfChanged(const std::string& path, const std::string& data)
+    {
+        std::string existingData;
+        if (__ReadFile(path, existingData) && (existingData == data))
+            return true;
+        
+        return __WriteFileAtomically(path, data);
+    }
+    
+    static std::string __PathForKey(const std::string& directory, const std::string& key)
+    {
+        std::string separator = (directory.size() > 0) && (directory[directory.size() - 1] == '/') ? "" : "/";
+        return directory + separator + hashString(key) + kTechniqueCacheExtension;
+    }
+    
+    static bool __CreateDirectoryIfNeeded(const std::string& directory)
+    {
+#ifdef WIN32
+        return (_mkdir(directory.c_str()) == 0) || (errno == EEXIST);
+#else
+        return (mkdir(directory.c_str(), 0777) == 0) || (errno == EEXIST);
+#endif
+    }
+    
+    //---- entries ---------------------------------------------------------------
+    /*
+        Entries are text, one record per line. Strings that may span several lines are written as their length followed by their bytes:
+        
+        glTF-technique-cache 1
+        key 42
+        <key>
+        parameter <parameterID> <type> [semantic]
+        attribute <symbol> <parameterID>
+        uniform <symbol> <parameterID>
+        vertexShader 512
+        <source>
+        fragmentShader 768
+        <source>
+     */
+    
+    static void __AppendBlock(std::string& entry, const std::string& name, const std::string& block)
+    {
+        entry += name + " " + GLTFUtils::toString(block.size()) + "\n";
+        entry += block + "\n";
+    }
+    
+    static void __AppendBindings(std::string& entry, const std::string& name, shared_ptr <JSONObject> bindings)
+    {
+        vector <std::string> symbols = bindings->getAllKeys();
+        for (size_t i = 0 ; i < symbols.size() ; i++) {
+            entry += name + " " + symbols[i] + " " + bindings->getString(symbols[i]) + "\n";
+        }
+    }
+    
+    static bool __ReadLine(const std::string& entry, size_t *position, std::string& line)
+    {
+        if (*position >= entry.size())
+            return false;
+        
+        size_t end = entry.find('\n', *position);
+        if (end == string::npos)
+            return false;
+        line = entry.substr(*position, end - *position);
+        *position = end + 1;
+        
+        return true;
+    }
+    
+    static bool __ReadBlock(const std::string& entry, size_t *position, size_t length, std::string& block)
+    {
+        if ((*position + length + 1 > entry.size()) || (entry[*position + length] != '\n'))
+            return false;
+        
+        block = entry.substr(*position, length);
+        *position += length + 1;
+        
+        return true;
+    }
+    
+    bool loadCachedTechnique(const std::string& directory, const std::string& key, CachedTechnique& technique)
+    {
+        std::string entry;
+        if (!__ReadFile(__PathForKey(directory, key), entry))
+            return false;
+        
+        size_t position = 0;
+        std::string line;
+        if (!__ReadLine(entry, &position, line) || (line != kTechniqueCacheHeader))
+            return false;
+        
+        shared_ptr <JSONObject> parameters(new JSONObject());
+        shared_ptr <JSONObject> attributes(new JSONObject());
+        shared_ptr <JSONObject> uniforms(new JSONObject());
+        std::string storedKey, vertexShaderSource, fragmentShaderSource;
+        bool hasKey = false, hasVertexShader = false, hasFragmentShader = false;
+        
+        while (__ReadLine(entry, &position, line)) {
+            std::istringstream record(line);
+            std::string name, first, second, third;
+            record >> name >> first >> second >> third;
+            
+            if ((name == "key") || (name == "vertexShader") || (name == "fragmentShader")) {
+                std::string block;
+                if (!__ReadBlock(entry, &position, (size_t)atol(first.c_str()), block))
+                    return false;
+                if (name == "key") {
+                    storedKey = block;
+                    hasKey = true;
+                } else if (name == "vertexShader") {
+                    vertexShaderSource = block;
+                    hasVertexShader = true;
+                } else {
+                    fragmentShaderSource = block;
+                    hasFragmentShader = true;
+                }
+            } else if ((name == "parameter") && (second.size() > 0)) {
+                shared_ptr <JSONObject> parameter(new JSONObject());
+                if (third.size() > 0)
+                    parameter->setString("semantic", third);
+                parameter->setString("type", second);
+                parameters->setValue(first, parameter);
+            } else if ((name == "attribute") && (second.size() > 0)) {
+                attributes->setString(first, second);
+            } else if ((name == "uniform") && (second.size() > 0)) {
+                uniforms->setString(first, second);
+            } else {
+                return false;
+            }
+        }
+        
+        //a different key with the same hash
+        if (!hasKey || (storedKey != key) || !hasVertexShader || !hasFragmentShader)
+            return false;
+        
+        technique.vertexShaderSource = vertexShaderSource;
+        technique.fragmentShaderSource = fragmentShaderSource;
+        technique.parameters = parameters;
+        technique.attributes = attributes;
+        technique.uniforms = uniforms;
+        
+        return true;
+    }
+    
+    bool storeCachedTechnique(const std::string& directory, const std::string& key, const CachedTechnique& technique)
+    {
+        if (!__CreateDirectoryIfNeeded(directory))
+            return false;
+        
+        std::string entry = std::string(kTechniqueCacheHeader) + "\n";
+        __AppendBlock(entry, "key", key);
+        
+        vector <std::string> parameterIDs = technique.parameters->getAllKeys();
+        for (size_t i = 0 ; i < parameterIDs.size() ; i++) {
+            shared_ptr <JSONObject> parameter = technique.parameters->getObject(parameterIDs[i]);
+            entry += "parameter " + parameterIDs[i] + " " + parameter->getString("type");
+            if (parameter->contains("semantic"))
+                entry += " " + parameter->getString("semantic");
+            entry += "\n";
+        }
+        __AppendBindings(entry, "attribute", technique.attributes);
+        __AppendBindings(entry, "uniform", technique.uniforms);
+        
+        __AppendBlock(entry, "vertexShader", technique.vertexShaderSource);
+        __AppendBlock(entry, "fragmentShader", technique.fragmentShaderSource);
+        
+        return __WriteFileAtomically(__PathForKey(directory, key), entry);
+    }
+}
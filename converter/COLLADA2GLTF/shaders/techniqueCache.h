@@ -0,0 +1,62 @@
+// Copyright (c) Fabrice Robinet
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef __TECHNIQUE_CACHE_H__
+#define __TECHNIQUE_CACHE_H__
+
+namespace GLTF
+{
+    /*
+        What a conversion needs from a generated technique to write it: the sources of its shaders,
+        its parameters and the symbols its program binds to them. Parameters hold a type and an optional semantic,
+        attributes and uniforms map a symbol to a parameter.
+     */
+    typedef struct {
+        std::string vertexShaderSource;
+        std::string fragmentShaderSource;
+        shared_ptr <JSONObject> parameters;
+        shared_ptr <JSONObject> attributes;
+        shared_ptr <JSONObject> uniforms;
+    } CachedTechnique;
+    
+    /*
+        A technique cache is a directory shared by conversions, possibly running in several processes at once.
+        Each technique is a file named after a hash of its key, the key is stored in the file as well so that colliding hashes are told apart.
+        Files are written under a temporary name then renamed, a reader finds either a complete entry or none.
+     */
+    
+    //returns false if directory has no entry for key or if the entry can't be read, technique is left untouched then
+    bool loadCachedTechnique(const std::string& directory, const std::string& key, CachedTechnique& technique);
+    
+    //creates directory if needed, returns false if the entry could not be written
+    bool storeCachedTechnique(const std::string& directory, const std::string& key, const CachedTechnique& technique);
+    
+    //16 hexadecimal digits of hashBytes, usable in file names
+    std::string hashString(const std::string& data);
+    
+    //writes data to path unless the file there already holds exactly data, returns false if it could not be written
+    bool writeFileIfChanged(const std::string& path, const std::string& data);
+}
+
+#endif
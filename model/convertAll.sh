@@ -1 +1 @@
-find . -name '*.dae' -exec collada2gltf {} \;
\ No newline at end of file
+collada2gltf -b .